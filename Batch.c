@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "batch.h"
+#include "engine.h"
+#include "binarydata.h"
+#include "jsonarena.h"
+#include "cJSON.h"
+
+#define BATCH_MAX_CONNS 4
+#define BATCH_POLL_MS 100
+
+typedef struct nova_batch
+{
+    FILE *out;
+    int failed;
+} nova_batch;
+
+typedef struct nova_batch_req
+{
+    nova_batch *batch;
+    long line;
+} nova_batch_req;
+
+/* called in an arena scope, which takes the record and its printed line back at its end */
+static void batch_emit(nova_batch *batch, cJSON *record)
+{
+    char *out = cJSON_PrintUnformatted(record);
+    if (out)
+    {
+        fputs(out, batch->out);
+        fputc('\n', batch->out);
+    }
+}
+
+static void batch_error(nova_batch *batch, long line, const char *error)
+{
+    cJSON *record = cJSON_CreateObject();
+    cJSON_AddNumberToObject(record, "line", line);
+    cJSON_AddFalseToObject(record, "ok");
+    cJSON_AddStringToObject(record, "error", error);
+    batch_emit(batch, record);
+    batch->failed++;
+}
+
+// 响应与附件按JSON原样嵌入, 非法JSON退化为字符串
+static void batch_add_json(cJSON *record, const char *name, const char *json)
+{
+    cJSON *item = cJSON_Parse(json);
+    if (item == NULL)
+    {
+        item = cJSON_CreateString(json);
+    }
+    cJSON_AddItemToObject(record, name, item);
+}
+
+static void batch_done(nova_engine *eng, int status, nova_resp *resp, void *udata)
+{
+    nova_batch_req *req = udata;
+    nova_batch *batch = req->batch;
+    nova_json_mark mark = nova_json_arena_begin();
+    cJSON *record, *root, *item;
+
+    (void)eng;
+    if (status == NOVA_REQ_TIMEOUT)
+    {
+        batch_error(batch, req->line, "timeout");
+    }
+    else if (status == NOVA_REQ_EXCEPTION)
+    {
+        /* type, name and message of the TApplicationException go along, the run goes on */
+        record = cJSON_CreateObject();
+        cJSON_AddNumberToObject(record, "line", req->line);
+        cJSON_AddFalseToObject(record, "ok");
+        cJSON_AddStringToObject(record, "error", "exception");
+        root = cJSON_Parse(resp->json);
+        if ((item = cJSON_DetachItemFromObject(root, "exception")))
+        {
+            cJSON_AddItemToObject(record, "exception", item);
+        }
+        batch_emit(batch, record);
+        batch->failed++;
+    }
+    else if (status != NOVA_REQ_OK)
+    {
+        batch_error(batch, req->line, "call failed");
+    }
+    else
+    {
+        record = cJSON_CreateObject();
+        cJSON_AddNumberToObject(record, "line", req->line);
+        cJSON_AddTrueToObject(record, "ok");
+        batch_add_json(record, "response", resp->json);
+        if (resp->attach && strcmp(resp->attach, "{}") != 0)
+        {
+            batch_add_json(record, "attach", resp->attach);
+        }
+        batch_emit(batch, record);
+    }
+
+    nova_json_arena_end(mark);
+    free(req);
+}
+
+/*
+ * parse one input line and queue it, malformed lines are reported right away.
+ * the request tree and its printed args live in one arena scope
+ */
+static void batch_submit(nova_engine *eng, nova_batch *batch, char *buf, long line)
+{
+    nova_json_mark mark = nova_json_arena_begin();
+    cJSON *root, *method, *args, *attach;
+    char *service = NULL;
+    char *method_name = NULL;
+    char *json_args = NULL;
+    char *json_attach = NULL;
+    const char *error = NULL;
+    nova_batch_req *req;
+
+    root = cJSON_Parse(buf);
+    if (root == NULL || !cJSON_IsObject(root))
+    {
+        batch_error(batch, line, "invalid request JSON");
+        nova_json_arena_end(mark);
+        return;
+    }
+
+    method = cJSON_GetObjectItem(root, "method");
+    args = cJSON_GetObjectItem(root, "args");
+    attach = cJSON_GetObjectItem(root, "attach");
+
+    if (!cJSON_IsString(method) || !nova_split_method(method->valuestring, &service, &method_name))
+    {
+        error = "invalid method, expect service.method";
+    }
+    else if (args && !cJSON_IsObject(args))
+    {
+        error = "invalid args, expect object";
+    }
+    else if (attach && !cJSON_IsObject(attach))
+    {
+        error = "invalid attach, expect object";
+    }
+    else
+    {
+        json_args = args ? nova_generic_args(args) : strdup("{}");
+        json_attach = attach ? cJSON_PrintUnformatted(attach) : strdup("{}");
+
+        req = malloc(sizeof(nova_batch_req));
+        if (req == NULL || json_args == NULL || json_attach == NULL)
+        {
+            free(req);
+            error = "out of memory";
+        }
+        else
+        {
+            req->batch = batch;
+            req->line = line;
+            if (!nova_engine_submit(eng, service, method_name, json_args, json_attach, batch_done, req))
+            {
+                free(req);
+                error = "submit failed";
+            }
+        }
+    }
+
+    if (error)
+    {
+        batch_error(batch, line, error);
+    }
+
+    free(service);
+    free(method_name);
+    cJSON_free(json_args);
+    cJSON_free(json_attach);
+    nova_json_arena_end(mark);
+}
+
+static int blank_line(const char *buf)
+{
+    while (*buf == ' ' || *buf == '\t' || *buf == '\r' || *buf == '\n')
+    {
+        buf++;
+    }
+    return *buf == 0;
+}
+
+int nova_batch_run(nova_client *cli, FILE *in, FILE *out, int concurrency, int backend)
+{
+    nova_engine *eng;
+    nova_batch batch;
+    char *buf = NULL;
+    size_t cap = 0;
+    long line = 0;
+    int eof = 0;
+
+    if (concurrency <= 0)
+    {
+        concurrency = 1;
+    }
+
+    eng = nova_engine_create(cli, concurrency < BATCH_MAX_CONNS ? concurrency : BATCH_MAX_CONNS, backend);
+    if (eng == NULL)
+    {
+        fprintf(stderr, "ERROR, fail to create nova engine\n");
+        return SW_ERR;
+    }
+
+    batch.out = out;
+    batch.failed = 0;
+
+    while (!eof || nova_engine_inflight(eng) > 0)
+    {
+        while (!eof && nova_engine_inflight(eng) < concurrency)
+        {
+            if (getline(&buf, &cap, in) < 0)
+            {
+                eof = 1;
+                break;
+            }
+            line++;
+            if (!blank_line(buf))
+            {
+                batch_submit(eng, &batch, buf, line);
+            }
+        }
+
+        if (nova_engine_inflight(eng) > 0)
+        {
+            nova_engine_poll(eng, BATCH_POLL_MS);
+        }
+        fflush(out);
+    }
+
+    free(buf);
+    nova_engine_destroy(eng);
+    return batch.failed == 0 ? SW_OK : SW_ERR;
+}
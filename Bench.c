@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "bench.h"
+#include "engine.h"
+#include "histogram.h"
+#include "binarydata.h"
+
+#define BENCH_MAX_CONNS 16
+#define BENCH_POLL_MS 100
+
+typedef struct nova_bench
+{
+    uint64_t ok;
+    uint64_t errors;
+    uint64_t exceptions; /* answered, but with a TApplicationException */
+    uint64_t timeouts;
+    nova_histogram *latency; /* us */
+} nova_bench;
+
+// 请求开始时间直接放在udata里, 避免每次调用分配上下文
+static void bench_done(nova_engine *eng, int status, nova_resp *resp, void *udata)
+{
+    nova_bench *bench = eng->data;
+
+    (void)resp;
+    if (status == NOVA_REQ_OK)
+    {
+        bench->ok++;
+        nova_hist_record(bench->latency, nova_now_us() - (int64_t)(intptr_t)udata);
+    }
+    else if (status == NOVA_REQ_EXCEPTION)
+    {
+        bench->exceptions++;
+    }
+    else if (status == NOVA_REQ_TIMEOUT)
+    {
+        bench->timeouts++;
+    }
+    else
+    {
+        bench->errors++;
+    }
+}
+
+static void bench_report(nova_bench *bench, const nova_engine *eng, uint64_t sent, int64_t elapsed, FILE *out)
+{
+    const nova_engine_stats *stats = &eng->stats;
+    double seconds = elapsed / 1000000.0;
+
+    fprintf(out, "requests: %llu, ok: %llu, errors: %llu, exceptions: %llu, timeouts: %llu\n",
+            (unsigned long long)sent,
+            (unsigned long long)bench->ok,
+            (unsigned long long)bench->errors,
+            (unsigned long long)bench->exceptions,
+            (unsigned long long)bench->timeouts);
+    fprintf(out, "elapsed: %.3fs, throughput: %.1f req/s\n",
+            seconds, seconds > 0 ? bench->ok / seconds : 0);
+    // 引擎自己的计数, 同一负载下 epoll 与 io_uring 的系统调用次数可以直接比较
+    fprintf(out, "engine(%s): submitted: %llu, completed: %llu, failed: %llu, timeouts: %llu, exceptions: %llu, "
+                 "syscalls: %llu (%.2f per call)\n",
+            eng->backend == NOVA_ENGINE_URING ? "io_uring" : "epoll",
+            (unsigned long long)stats->submitted,
+            (unsigned long long)stats->completed,
+            (unsigned long long)stats->failed,
+            (unsigned long long)stats->timeouts,
+            (unsigned long long)stats->exceptions,
+            (unsigned long long)stats->syscalls,
+            stats->submitted > 0 ? (double)stats->syscalls / stats->submitted : 0);
+    nova_hist_print(bench->latency, out);
+}
+
+int nova_bench_run(nova_client *cli,
+                   const char *service, const char *method,
+                   const char *json_args, const char *json_attach,
+                   const nova_bench_opts *opts, FILE *out)
+{
+    nova_engine *eng;
+    nova_bench bench;
+    nova_buf frame = {0};
+    int concurrency = opts->concurrency > 0 ? opts->concurrency : 1;
+    int64_t start, now, due, end;
+    uint64_t sent = 0;
+    int done = 0;
+    int accepted;
+    int wait;
+
+    if (opts->requests <= 0 && opts->duration <= 0)
+    {
+        fprintf(stderr, "ERROR, bench needs a request count or a duration\n");
+        return SW_ERR;
+    }
+
+    // 只打包一次, 每次发送前仅改写seq_no
+    accepted = cli->compress.accepted;
+    if (!nova_client_encode(cli, &frame, 0, service, method, json_args, json_attach))
+    {
+        return SW_ERR;
+    }
+
+    eng = nova_engine_create(cli, concurrency < BENCH_MAX_CONNS ? concurrency : BENCH_MAX_CONNS, opts->backend);
+    if (eng == NULL)
+    {
+        fprintf(stderr, "ERROR, fail to create nova engine\n");
+        nova_buf_free(&frame);
+        return SW_ERR;
+    }
+
+    memset(&bench, 0, sizeof(bench));
+    bench.latency = nova_hist_create();
+    if (bench.latency == NULL)
+    {
+        nova_engine_destroy(eng);
+        nova_buf_free(&frame);
+        return SW_ERR;
+    }
+    eng->data = &bench;
+
+    start = nova_now_us();
+    end = opts->duration > 0 ? start + (int64_t)opts->duration * 1000000 : INT64_MAX;
+
+    for (;;)
+    {
+        now = nova_now_us();
+        if (!done && (now >= end || (opts->requests > 0 && sent >= (uint64_t)opts->requests)))
+        {
+            done = 1;
+        }
+        if (done && nova_engine_inflight(eng) == 0)
+        {
+            break;
+        }
+
+        due = now;
+        while (!done && nova_engine_inflight(eng) < concurrency &&
+               (opts->requests <= 0 || sent < (uint64_t)opts->requests))
+        {
+            if (opts->rate > 0)
+            {
+                /*
+                 * open loop, calls are scheduled at fixed intervals from the start and latency
+                 * counts from the scheduled time, so a stalled server is not hidden by sending late
+                 */
+                due = start + (int64_t)(sent * 1000000 / opts->rate);
+                if (due > now)
+                {
+                    break;
+                }
+            }
+
+            /* the first replies may show the server reads compressed calls, the frame is packed once more */
+            if (accepted != cli->compress.accepted)
+            {
+                accepted = cli->compress.accepted;
+                frame.len = 0;
+                if (!nova_client_encode(cli, &frame, 0, service, method, json_args, json_attach))
+                {
+                    bench.errors++;
+                    break;
+                }
+            }
+
+            sent++;
+            if (!nova_engine_submit_frame(eng, frame.data, frame.len, bench_done, (void *)(intptr_t)due))
+            {
+                bench.errors++;
+                break;
+            }
+        }
+
+        wait = BENCH_POLL_MS;
+        if (!done && due > now)
+        {
+            wait = (int)((due - now + 999) / 1000);
+        }
+        if (!done && end != INT64_MAX && (end - now) / 1000 < wait)
+        {
+            wait = (int)((end - now + 999) / 1000);
+        }
+        nova_engine_poll(eng, wait);
+    }
+
+    bench_report(&bench, eng, sent, nova_now_us() - start, out);
+    if (opts->hist_path && !nova_hist_save(bench.latency, opts->hist_path))
+    {
+        bench.errors++;
+    }
+
+    nova_engine_destroy(eng);
+    nova_hist_destroy(bench.latency);
+    nova_buf_free(&frame);
+    return bench.errors == 0 && bench.exceptions == 0 && bench.timeouts == 0 ? SW_OK : SW_ERR;
+}
@@ -4,41 +4,35 @@
 #include <stdlib.h>
 #include "binarydata.h"
 
-int swReadI64(const uchar_t* pData, int64_t *pValue)
+/* 导出的符号, 和头文件里的内联版本同一实现; 括号避免被同名宏展开 */
+int (swReadI64)(const uchar_t* pData, int64_t *pValue)
 {
-    *pValue = ((uint64_t)pData[0] << 56) | ((uint64_t)pData[1] << 48) | ((uint64_t)pData[2] << 40) |((uint64_t)pData[3] << 32)|(pData[4] << 24) |(pData[5] << 16) | (pData[6] << 8) | pData[7];
-
-    return SW_OK;
+    return swInlineReadI64(pData, pValue);
 }
 
-int swReadI32(const uchar_t* pData, int32_t *pValue)
+int (swReadI32)(const uchar_t* pData, int32_t *pValue)
 {
-    *pValue = (pData[0] << 24) | (pData[1] << 16) | (pData[2] << 8) | pData[3];
-    return SW_OK;
+    return swInlineReadI32(pData, pValue);
 }
 
-int swReadU32(const uchar_t* pData, uint32_t *pValue)
+int (swReadU32)(const uchar_t* pData, uint32_t *pValue)
 {
-    *pValue = (pData[0] << 24) | (pData[1] << 16) | (pData[2] << 8) | pData[3];
-    return SW_OK;
+    return swInlineReadU32(pData, pValue);
 }
 
-int swReadI16(const uchar_t* pData, int16_t *pValue)
+int (swReadI16)(const uchar_t* pData, int16_t *pValue)
 {
-    *pValue = (pData[0] << 8) | pData[1];
-    return SW_OK;
+    return swInlineReadI16(pData, pValue);
 }
 
-int swReadU16(const uchar_t* pData, uint16_t *pValue)
+int (swReadU16)(const uchar_t* pData, uint16_t *pValue)
 {
-    *pValue = (pData[0] << 8) | pData[1];
-    return SW_OK;
+    return swInlineReadU16(pData, pValue);
 }
 
-int swReadByte(const uchar_t* pData, char* pValue)
+int (swReadByte)(const uchar_t* pData, char* pValue)
 {
-    *pValue = pData[0];
-    return SW_OK;
+    return swInlineReadByte(pData, pValue);
 }
 
 int swReadString(const uchar_t* pData, int nDataLen, char **ppStr, int* pLen)
@@ -50,7 +44,7 @@ int swReadString(const uchar_t* pData, int nDataLen, char **ppStr, int* pLen)
     if(swReadI32(pData, pLen) != SW_OK) {
         return SW_ERR;
     }
-    if (nDataLen - 4 < *pLen) {
+    if (*pLen < 0 || nDataLen - 4 < *pLen) {
         return SW_ERR;
     }
     char* pTmp = *ppStr;
@@ -69,7 +63,7 @@ int swReadString(const uchar_t* pData, int nDataLen, char **ppStr, int* pLen)
 
 int swReadBytes(const uchar_t* pData, int nDataLen, char **ppStr, int nLen)
 {
-    if (nDataLen < nLen) {
+    if (nLen < 0 || nDataLen < nLen) {
         return  SW_ERR;
     }
     char* pTmp = *ppStr;
@@ -85,55 +79,34 @@ int swReadBytes(const uchar_t* pData, int nDataLen, char **ppStr, int nLen)
     return SW_OK;
 }
 
-int swWriteI64(uchar_t* pData, int64_t nValue)
+int (swWriteI64)(uchar_t* pData, int64_t nValue)
 {
-    pData[0] = (uchar_t)(nValue >> 56);
-    pData[1] = (uchar_t)((nValue >> 48) & 0xFF);
-    pData[2] = (uchar_t)((nValue >> 40) & 0xFF);
-    pData[3] = (uchar_t)((nValue >> 32) & 0xFF);
-    pData[4] = (uchar_t)((nValue >> 24) & 0xFF);
-    pData[5] = (uchar_t)((nValue >> 16) & 0xFF);
-    pData[6] = (uchar_t)((nValue >> 8)  & 0xFF);
-    pData[7] = (uchar_t)(nValue & 0xFF);
-    return SW_OK;
+    return swInlineWriteI64(pData, nValue);
 }
 
-int swWriteI32(uchar_t* pData, int32_t nValue)
+int (swWriteI32)(uchar_t* pData, int32_t nValue)
 {
-    pData[0] = (uchar_t)(nValue >> 24);
-    pData[1] = (uchar_t)((nValue >> 16) & 0xFF);
-    pData[2] = (uchar_t)((nValue >> 8) & 0xFF);
-    pData[3] = (uchar_t)(nValue & 0xFF);
-    return SW_OK;
+    return swInlineWriteI32(pData, nValue);
 }
 
-int swWriteU32(uchar_t* pData, uint32_t nValue)
+int (swWriteU32)(uchar_t* pData, uint32_t nValue)
 {
-    pData[0] = (uchar_t)(nValue >> 24);
-    pData[1] = (uchar_t)((nValue >> 16) & 0xFF);
-    pData[2] = (uchar_t)((nValue >> 8) & 0xFF);
-    pData[3] = (uchar_t)(nValue & 0xFF);
-    return SW_OK;
+    return swInlineWriteU32(pData, nValue);
 }
 
-int swWriteI16(uchar_t* pData, int16_t nValue)
+int (swWriteI16)(uchar_t* pData, int16_t nValue)
 {
-    pData[0] = (uchar_t)(nValue >> 8);
-    pData[1] = (uchar_t)(nValue & 0xFF);
-    return SW_OK;
+    return swInlineWriteI16(pData, nValue);
 }
 
-int swWriteU16(uchar_t* pData, uint16_t nValue)
+int (swWriteU16)(uchar_t* pData, uint16_t nValue)
 {
-    pData[0] = (uchar_t)(nValue >> 8);
-    pData[1] = (uchar_t)(nValue & 0xFF);
-    return SW_OK;
+    return swInlineWriteU16(pData, nValue);
 }
 
-int swWriteByte(uchar_t* pData, char cValue)
+int (swWriteByte)(uchar_t* pData, char cValue)
 {
-    pData[0] = (char)cValue;
-    return SW_OK;
+    return swInlineWriteByte(pData, cValue);
 }
 
 int swWriteString(uchar_t* pData, const char* pStr, int nLen)
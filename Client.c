@@ -0,0 +1,696 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <errno.h>
+
+#include "client.h"
+#include "thriftgeneric.h"
+#include "nova.h"
+#include "binarydata.h"
+#include "cJSON.h"
+
+static void printbin(const char *bin, int size)
+{
+    char c = '*';
+    int count = 100;
+    int i;
+    for (i = 0; i < count; i++)
+        putchar(c);
+    puts("");
+    fwrite(bin, sizeof(char), size, stdout);
+    puts("");
+    for (i = 0; i < count; i++)
+        putchar(c);
+    puts("");
+}
+
+#define DUMP_STRUCT(sp) bin2hex((const char *)(sp), sizeof(*(sp)))
+#define DUMP_MEM(vp, n) bin2hex((const char *)(vp), (size_t)(n))
+static void bin2hex(const char *vp, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; i++)
+    {
+        printf("%02x", (unsigned char)vp[i]);
+    }
+    putchar('\n');
+}
+
+nova_client *nova_client_create(const char *host, int port, struct timeval timeout)
+{
+    nova_client *cli = calloc(1, sizeof(nova_client));
+    if (cli == NULL)
+    {
+        return NULL;
+    }
+    cli->host = host;
+    cli->port = port;
+    cli->timeout = timeout;
+    cli->pool = nova_pool_create(POOL_MAX_IDLE_PER_HOST, POOL_IDLE_TIMEOUT_MS, timeout);
+    if (cli->pool == NULL)
+    {
+        free(cli);
+        return NULL;
+    }
+    cli->compress.min_size = NOVA_COMPRESS_MIN;
+    return cli;
+}
+
+void nova_client_destroy(nova_client *cli)
+{
+    if (cli == NULL)
+    {
+        return;
+    }
+    nova_pool_destroy(cli->pool);
+    nova_decoder_free(&cli->dec);
+    nova_buf_free(&cli->send_buf);
+    nova_compressor_free(&cli->compress);
+    free(cli);
+}
+
+int nova_split_method(const char *full, char **service, char **method)
+{
+    const char *dot = strrchr(full, '.');
+    size_t service_len;
+
+    if (dot == NULL || dot == full || dot[1] == 0)
+    {
+        return SW_ERR;
+    }
+
+    service_len = dot - full;
+    *service = malloc(service_len + 1);
+    *method = strdup(dot + 1);
+    if (*service == NULL || *method == NULL)
+    {
+        free(*service);
+        free(*method);
+        return SW_ERR;
+    }
+    memcpy(*service, full, service_len);
+    (*service)[service_len] = 0;
+    return SW_OK;
+}
+
+char *nova_generic_args(cJSON *root)
+{
+    // 泛化调用参数为扁平KV结构, 非标量参数要二次打包
+    cJSON *cur = root->child;
+    cJSON *next;
+    char *packed;
+
+    while (cur)
+    {
+        next = cur->next; /* cur is freed once replaced */
+        if (cJSON_IsArray(cur) || cJSON_IsObject(cur))
+        {
+            packed = cJSON_PrintUnformatted(cur);
+            cJSON_ReplaceItemInObject(root, cur->string, cJSON_CreateString(packed));
+            cJSON_free(packed);
+        }
+
+        cur = next;
+    }
+
+    return cJSON_PrintUnformatted(root);
+}
+
+void nova_resp_free(nova_resp *resp)
+{
+    free(resp->json);
+    free(resp->attach);
+    memset(resp, 0, sizeof(*resp));
+}
+
+/* the header only borrows the names and attach, nothing to free */
+static int init_header(swNova_Header *nova_hdr,
+                       const char *service, int32_t service_len,
+                       const char *method, int32_t method_len,
+                       const char *attach, int32_t attach_len, int64_t seq_no)
+{
+    int headLen;
+
+    memset(nova_hdr, 0, sizeof(*nova_hdr));
+    nova_hdr->magic = NOVA_MAGIC;
+    nova_hdr->version = 1;
+    nova_hdr->ip = 0;
+    nova_hdr->port = 0;
+
+    nova_hdr->service_len = service_len;
+    nova_hdr->method_len = method_len;
+    nova_hdr->attach_len = attach_len;
+    headLen = NOVA_HEADER_COMMON_LEN + nova_hdr->service_len + nova_hdr->method_len + nova_hdr->attach_len;
+    if (headLen > 0x7fff)
+    {
+        fprintf(stderr, "ERROR, too large nova header as %d\n", headLen);
+        return SW_ERR;
+    }
+    nova_hdr->head_size = (int16_t)headLen;
+    nova_hdr->service_name = (char *)service;
+    nova_hdr->method_name = (char *)method;
+    nova_hdr->seq_no = seq_no;
+    nova_hdr->attach = (char *)attach;
+
+    return SW_OK;
+}
+
+static int init_generic_header(swNova_Header *nova_hdr, const char *attach, int32_t attach_len, int64_t seq_no)
+{
+    return init_header(nova_hdr, GENERIC_SERVICE, GENERIC_SERVICE_LEN, GENERIC_METHOD, GENERIC_METHOD_LEN,
+                       attach, attach_len, seq_no);
+}
+
+/* send the whole iovec, iov is consumed in place */
+static int send_iov(int sockfd, struct iovec *iov, int iovcnt)
+{
+    struct msghdr msg;
+    ssize_t send_n;
+
+    memset(&msg, 0, sizeof(msg));
+    while (iovcnt > 0)
+    {
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovcnt;
+        send_n = sendmsg(sockfd, &msg, MSG_NOSIGNAL);
+        if (send_n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("ERROR sending");
+            return SW_ERR;
+        }
+
+        while (iovcnt > 0 && (size_t)send_n >= iov->iov_len)
+        {
+            send_n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + send_n;
+            iov->iov_len -= send_n;
+        }
+    }
+    return SW_OK;
+}
+
+/* read one whole nova frame through the decoder, the prefix is checked before the body is read */
+static int recv_frame(int sockfd, nova_decoder *dec, const char **frame, int32_t *frame_len)
+{
+    const char *chunk = NULL;
+    int32_t len = 0, room;
+    char *space;
+    int ret, n;
+
+    /* reads stop at the end of this frame, the rest of the stream belongs to the next call */
+    nova_decoder_reset(dec);
+    for (;;)
+    {
+        ret = nova_decoder_feed(dec, &chunk, &len, frame, frame_len);
+        if (ret != NOVA_DECODE_MORE)
+        {
+            return ret == NOVA_DECODE_FRAME ? SW_OK : SW_ERR;
+        }
+
+        space = nova_decoder_space(dec, &room);
+        if (space == NULL)
+        {
+            fprintf(stderr, "ERROR, out of memory\n");
+            return SW_ERR;
+        }
+        n = recv(sockfd, space, room, 0);
+        if (n <= 0)
+        {
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n == 0)
+            {
+                fprintf(stderr, "ERROR receiving: connection closed by peer\n");
+            }
+            else
+            {
+                perror("ERROR receiving");
+            }
+            return SW_ERR;
+        }
+        nova_decoder_commit(dec, n);
+    }
+}
+
+int nova_pack_call_iov(const char *service, const char *method,
+                       const char *json_args, const char *json_attach,
+                       int64_t seq_no, nova_frame_iov *frame)
+{
+    swNova_Header nova_hdr;
+    int body_len;
+
+    if (!init_generic_header(&nova_hdr, json_attach, strlen(json_attach), seq_no))
+    {
+        return SW_ERR;
+    }
+
+    body_len = thrift_generic_pack_iov((int)seq_no,
+                                       service, strlen(service),
+                                       method, strlen(method),
+                                       json_args, strlen(json_args),
+                                       frame->body, frame->iov + 2);
+
+    frame->iov[0].iov_base = frame->head;
+    frame->iov[0].iov_len = swNova_pack_head(&nova_hdr, body_len, frame->head);
+    frame->iov[1].iov_base = (void *)json_attach;
+    frame->iov[1].iov_len = nova_hdr.attach_len;
+    frame->iovcnt = NOVA_FRAME_IOV;
+    frame->len = nova_hdr.head_size + body_len;
+    return SW_OK;
+}
+
+int32_t nova_frame_len(int32_t service_len, int32_t method_len, int32_t args_len, int32_t attach_len)
+{
+    return NOVA_HEADER_COMMON_LEN + GENERIC_SERVICE_LEN + GENERIC_METHOD_LEN + attach_len +
+           GENERIC_COMMON_LEN + service_len + method_len + args_len;
+}
+
+int32_t nova_encode_call(char *out, int64_t seq_no,
+                         const char *service, int32_t service_len,
+                         const char *method, int32_t method_len,
+                         const char *json_args, int32_t args_len,
+                         const char *json_attach, int32_t attach_len)
+{
+    swNova_Header nova_hdr;
+    int32_t off;
+    int body_len = GENERIC_COMMON_LEN + service_len + method_len + args_len;
+
+    if (!init_generic_header(&nova_hdr, json_attach, attach_len, seq_no))
+    {
+        return 0;
+    }
+
+    off = swNova_pack_head(&nova_hdr, body_len, out);
+    memcpy(out + off, json_attach, attach_len);
+    off += attach_len;
+    off += thrift_generic_pack_into((int)seq_no, service, service_len, method, method_len, json_args, args_len, out + off);
+    return off;
+}
+
+const thrift_method *nova_client_method(nova_client *cli, const char *service, const char *method)
+{
+    if (cli->schema == NULL)
+    {
+        return NULL;
+    }
+    return thrift_schema_find(cli->schema, service, strlen(service), method, strlen(method));
+}
+
+/* reserve the nova header in front of the thrift body, it is written once the body length is known */
+static int frame_begin(nova_buf *out, swNova_Header *nova_hdr,
+                       const char *service, const char *method,
+                       const char *json_attach, int64_t seq_no)
+{
+    return init_header(nova_hdr, service, strlen(service), method, strlen(method), json_attach, strlen(json_attach), seq_no) &&
+           nova_buf_reserve(out, out->len + nova_hdr->head_size);
+}
+
+static void frame_end(nova_buf *out, swNova_Header *nova_hdr, int32_t start)
+{
+    char *p = out->data + start;
+
+    p += swNova_pack_head(nova_hdr, out->len - start - nova_hdr->head_size, p);
+    memcpy(p, nova_hdr->attach, nova_hdr->attach_len);
+}
+
+int nova_encode_typed_buf(nova_buf *out, const thrift_method *m, int proto, int64_t seq_no,
+                          const char *json_args, const char *json_attach)
+{
+    swNova_Header nova_hdr;
+    thrift_writer w;
+    int32_t start = out->len;
+
+    if (!frame_begin(out, &nova_hdr, m->service, m->name, json_attach, seq_no))
+    {
+        return SW_ERR;
+    }
+    out->len += nova_hdr.head_size;
+    thrift_writer_init(&w, out, proto);
+    if (!thrift_encode_call(&w, m, (int32_t)seq_no, json_args))
+    {
+        out->len = start;
+        return SW_ERR;
+    }
+    frame_end(out, &nova_hdr, start);
+    return SW_OK;
+}
+
+/* append one GenericService.invoke frame in proto, binary ones take the one pass path of nova_encode_call */
+static int encode_generic_buf(nova_buf *out, int proto, int64_t seq_no,
+                              const char *service, const char *method,
+                              const char *json_args, int32_t args_len, const char *json_attach)
+{
+    swNova_Header nova_hdr;
+    thrift_writer w;
+    int32_t service_len = strlen(service);
+    int32_t method_len = strlen(method);
+    int32_t attach_len = strlen(json_attach);
+    int32_t start = out->len;
+    int32_t len;
+
+    if (proto == THRIFT_BINARY)
+    {
+        len = nova_frame_len(service_len, method_len, args_len, attach_len);
+        if (!nova_buf_reserve(out, out->len + len))
+        {
+            return SW_ERR;
+        }
+        len = nova_encode_call(out->data + out->len, seq_no,
+                               service, service_len, method, method_len,
+                               json_args, args_len, json_attach, attach_len);
+        out->len += len;
+        return len ? SW_OK : SW_ERR;
+    }
+
+    if (!frame_begin(out, &nova_hdr, GENERIC_SERVICE, GENERIC_METHOD, json_attach, seq_no))
+    {
+        return SW_ERR;
+    }
+    out->len += nova_hdr.head_size;
+    thrift_writer_init(&w, out, proto);
+    if (!thrift_generic_write(&w, (int)seq_no, service, service_len, method, method_len, json_args, args_len))
+    {
+        out->len = start;
+        return SW_ERR;
+    }
+    frame_end(out, &nova_hdr, start);
+    return SW_OK;
+}
+
+int nova_client_protocol(nova_client *cli, const thrift_method *m)
+{
+    return m && m->protocol >= 0 ? m->protocol : cli->protocol;
+}
+
+int nova_client_encode(nova_client *cli, nova_buf *out, int64_t seq_no,
+                       const char *service, const char *method,
+                       const char *json_args, const char *json_attach)
+{
+    const thrift_method *m = nova_client_method(cli, service, method);
+    int32_t args_len;
+
+    if (m)
+    {
+        return nova_encode_typed_buf(out, m, nova_client_protocol(cli, m), seq_no, json_args, json_attach);
+    }
+    /* the json string may be swapped for its compressed payload, the attachment then says so */
+    args_len = strlen(json_args);
+    if (!nova_compressor_apply(&cli->compress, &json_args, &args_len, &json_attach))
+    {
+        return SW_ERR;
+    }
+    return encode_generic_buf(out, cli->protocol, seq_no, service, method, json_args, args_len, json_attach);
+}
+
+int nova_frame_set_seq(char *frame, int32_t frame_len, int64_t seq_no)
+{
+    swNova_HeaderView view;
+
+    /* seq_no follows the method name in the nova header, the thrift seq sits in the message header */
+    if (!swNova_unpack_view(frame, frame_len, &view) ||
+        !thrift_message_set_seq(frame + view.head_size, frame_len - view.head_size, (int32_t)seq_no))
+    {
+        return SW_ERR;
+    }
+    swWriteI64((uchar *)view.method_name + view.method_len, seq_no);
+    return SW_OK;
+}
+
+int nova_frame_tpl_init(nova_frame_tpl *tpl, const char *json_attach)
+{
+    nova_frame_iov frame;
+    char *p;
+    int i;
+
+    memset(tpl, 0, sizeof(*tpl));
+    if (!nova_pack_call_iov("", "", "", json_attach, 0, &frame))
+    {
+        return SW_ERR;
+    }
+
+    /* nova header, attachment and the thrift prefix up to the service length */
+    for (i = 0; i < 3; i++)
+    {
+        tpl->head_len += frame.iov[i].iov_len;
+    }
+    tpl->head = malloc(tpl->head_len);
+    tpl->attach = strdup(json_attach);
+    if (tpl->head == NULL || tpl->attach == NULL)
+    {
+        nova_frame_tpl_free(tpl);
+        return SW_ERR;
+    }
+    for (i = 0, p = tpl->head; i < 3; i++)
+    {
+        memcpy(p, frame.iov[i].iov_base, frame.iov[i].iov_len);
+        p += frame.iov[i].iov_len;
+    }
+    tpl->head_size = (int32_t)(frame.iov[0].iov_len + frame.iov[1].iov_len);
+    return SW_OK;
+}
+
+void nova_frame_tpl_free(nova_frame_tpl *tpl)
+{
+    free(tpl->head);
+    free(tpl->attach);
+    memset(tpl, 0, sizeof(*tpl));
+}
+
+int32_t nova_frame_tpl_len(const nova_frame_tpl *tpl, int32_t service_len, int32_t method_len, int32_t args_len)
+{
+    /* method and args field headers, both stops */
+    return tpl->head_len + service_len + 7 + method_len + 7 + args_len + 2;
+}
+
+static inline char *put_string_field(char *p, uint16_t field_id, const char *str, int32_t len)
+{
+    swWriteByte((uchar *)p, TYPE_STRING);
+    swWriteU16((uchar *)p + 1, field_id);
+    swWriteI32((uchar *)p + 3, len);
+    memcpy(p + 7, str, len);
+    return p + 7 + len;
+}
+
+int32_t nova_frame_tpl_write(const nova_frame_tpl *tpl, char *out, int64_t seq_no,
+                             const char *service, int32_t service_len,
+                             const char *method, int32_t method_len,
+                             const char *json_args, int32_t args_len)
+{
+    int32_t len = nova_frame_tpl_len(tpl, service_len, method_len, args_len);
+    char *p = out + tpl->head_len;
+
+    memcpy(out, tpl->head, tpl->head_len);
+    swWriteI32((uchar *)out, len);
+    swWriteI64((uchar *)out + NOVA_SEQ_OFFSET, seq_no);
+    swWriteI32((uchar *)out + tpl->head_size + THRIFT_SEQ_OFFSET, (int32_t)seq_no);
+    swWriteI32((uchar *)p - 4, service_len);
+
+    memcpy(p, service, service_len);
+    p += service_len;
+    p = put_string_field(p, 2, method, method_len);
+    p = put_string_field(p, 3, json_args, args_len);
+    p[0] = FIELD_STOP;
+    p[1] = FIELD_STOP;
+    return len;
+}
+
+static int unpack_compressed(const swNova_HeaderView *nova_hdr, char **json, int *json_len)
+{
+    int32_t raw_len;
+    char *raw;
+    int codec = nova_attach_codec(nova_hdr->attach, nova_hdr->attach_len);
+
+    if (codec == NOVA_COMPRESS_NONE)
+    {
+        return SW_OK;
+    }
+    raw = codec < 0 ? NULL : nova_decompress_payload(codec, *json, *json_len, &raw_len);
+    if (raw == NULL)
+    {
+        fprintf(stderr, "ERROR, fail to decompress response\n");
+        return SW_ERR;
+    }
+    free(*json);
+    *json = raw;
+    *json_len = raw_len;
+    return SW_OK;
+}
+
+int nova_unpack_resp(const char *recv_buf, int32_t recv_msg_size, const thrift_schema *schema,
+                     int debug, int64_t *seq_no, nova_resp *resp)
+{
+    swNova_HeaderView nova_hdr;
+    const thrift_method *typed = NULL;
+    const char *body;
+    int32_t body_len;
+    char *resp_json = NULL;
+    int resp_json_len;
+
+    *seq_no = -1;
+    memset(resp, 0, sizeof(*resp));
+
+    if (debug)
+    {
+        DUMP_MEM(recv_buf, recv_msg_size);
+        printbin(recv_buf, recv_msg_size);
+    }
+
+    // 包头只做视图解析, 不再为服务名/方法名/附件分配内存
+    if (!swNova_unpack_view(recv_buf, recv_msg_size, &nova_hdr))
+    {
+        fprintf(stderr, "ERROR, invalid nova packet header\n");
+        printbin(recv_buf, recv_msg_size);
+        return SW_ERR;
+    }
+    *seq_no = nova_hdr.seq_no;
+
+    /* replies carry the service and method called, typed ones are decoded by their schema */
+    if (schema)
+    {
+        typed = thrift_schema_find(schema, nova_hdr.service_name, nova_hdr.service_len, nova_hdr.method_name, nova_hdr.method_len);
+    }
+    body = recv_buf + nova_hdr.head_size;
+    body_len = nova_hdr.msg_size - nova_hdr.head_size;
+    if (thrift_message_type(body, body_len) == T_EX)
+    {
+        /* decoded into an error the caller can report, the connection stays usable */
+        resp->exception = 1;
+        resp_json_len = thrift_exception_unpack(body, body_len, &resp_json);
+    }
+    else if (typed)
+    {
+        resp_json_len = thrift_decode_reply(typed, body, body_len, &resp_json);
+    }
+    else
+    {
+        resp_json_len = thrift_generic_unpack(body, body_len, &resp_json);
+    }
+    if (!resp_json_len)
+    {
+        fprintf(stderr, "ERROR, fail to unpack thrift packet\n");
+        printbin(recv_buf, recv_msg_size);
+        return SW_ERR;
+    }
+
+    /* a generic reply may come back compressed when the call offered to accept it */
+    if (!typed && !resp->exception && !unpack_compressed(&nova_hdr, &resp_json, &resp_json_len))
+    {
+        free(resp_json);
+        return SW_ERR;
+    }
+
+    /* the attachment is only copied out when there is one */
+    if (nova_hdr.attach_len > 0)
+    {
+        resp->attach = malloc(nova_hdr.attach_len + 1);
+        if (resp->attach == NULL)
+        {
+            free(resp_json);
+            return SW_ERR;
+        }
+        memcpy(resp->attach, nova_hdr.attach, nova_hdr.attach_len);
+        resp->attach[nova_hdr.attach_len] = 0;
+        resp->attach_len = nova_hdr.attach_len;
+    }
+    resp->json = resp_json;
+    resp->json_len = resp_json_len;
+    return SW_OK;
+}
+
+int nova_client_invoke(nova_client *cli,
+                       const char *service, const char *method,
+                       const char *json_args, const char *json_attach,
+                       nova_resp *resp)
+{
+    int ret = SW_ERR;
+    int reusable = 0;
+    nova_conn *conn = NULL;
+    int64_t seq_no = ++cli->seq_no;
+    int64_t resp_seq_no;
+
+    nova_frame_iov frame;
+    const thrift_method *typed = nova_client_method(cli, service, method);
+    const char *recv_buf;
+    int32_t recv_msg_size;
+    int i;
+
+    memset(resp, 0, sizeof(*resp));
+
+    if (typed || cli->protocol != THRIFT_BINARY || cli->compress.codec != NOVA_COMPRESS_NONE)
+    {
+        /* typed arguments, compact and compressed calls are encoded aside, the frame is built whole in send_buf */
+        cli->send_buf.len = 0;
+        if (!nova_client_encode(cli, &cli->send_buf, seq_no, service, method, json_args, json_attach))
+        {
+            return SW_ERR;
+        }
+        frame.iov[0].iov_base = cli->send_buf.data;
+        frame.iov[0].iov_len = cli->send_buf.len;
+        frame.iovcnt = 1;
+    }
+    /* header and thrift prefix are built on the stack, the strings are sent in place */
+    else if (!nova_pack_call_iov(service, method, json_args, json_attach, seq_no, &frame))
+    {
+        return SW_ERR;
+    }
+
+    conn = nova_pool_acquire(cli->pool, cli->host, cli->port);
+    if (conn == NULL)
+    {
+        goto done;
+    }
+
+    if (cli->debug)
+    {
+        puts("sending...");
+        for (i = 0; i < frame.iovcnt; i++)
+        {
+            DUMP_MEM(frame.iov[i].iov_base, frame.iov[i].iov_len);
+        }
+    }
+
+    if (!send_iov(conn->fd, frame.iov, frame.iovcnt))
+    {
+        goto done;
+    }
+
+    if (!recv_frame(conn->fd, &cli->dec, &recv_buf, &recv_msg_size))
+    {
+        goto done;
+    }
+
+    ret = nova_unpack_resp(recv_buf, recv_msg_size, cli->schema, cli->debug, &resp_seq_no, resp);
+    /* a whole frame answering this call was consumed, the connection is back in sync */
+    reusable = resp_seq_no == seq_no;
+    if (ret && !reusable)
+    {
+        fprintf(stderr, "ERROR, unexpected nova seq_no %lld, expected %lld\n", (long long)resp_seq_no, (long long)seq_no);
+        nova_resp_free(resp);
+        ret = SW_ERR;
+    }
+    if (ret)
+    {
+        nova_compressor_learn(&cli->compress, resp->attach, resp->attach_len);
+    }
+
+done:
+    if (conn)
+    {
+        nova_pool_release(cli->pool, conn, reusable);
+    }
+    return ret;
+}
@@ -0,0 +1,223 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compress.h"
+#ifdef NOVA_HAVE_LZ4
+#include <lz4.h>
+#endif
+#include "nova.h"
+#include "binarydata.h"
+#include "cJSON.h"
+
+static const char *codec_names[] = {NULL, "lz4"};
+
+int nova_compress_payload(nova_buf *out, int codec, const char *data, int32_t len)
+{
+#ifdef NOVA_HAVE_LZ4
+    int32_t cap = len - NOVA_COMPRESS_HEAD - 1;
+    int32_t clen;
+
+    out->len = 0;
+    if (codec != NOVA_COMPRESS_LZ4 || cap <= 0 || !nova_buf_reserve(out, NOVA_COMPRESS_HEAD + cap))
+    {
+        return SW_ERR;
+    }
+    clen = LZ4_compress_default(data, out->data + NOVA_COMPRESS_HEAD, len, cap);
+    if (clen == 0)
+    {
+        return SW_ERR;
+    }
+    swWriteI32((uchar *)out->data, len);
+    out->len = NOVA_COMPRESS_HEAD + clen;
+    return SW_OK;
+#else
+    (void)codec;
+    (void)data;
+    (void)len;
+    out->len = 0;
+    return SW_ERR;
+#endif
+}
+
+char *nova_decompress_payload(int codec, const char *data, int32_t len, int32_t *out_len)
+{
+#ifdef NOVA_HAVE_LZ4
+    int32_t raw_len;
+    char *raw;
+
+    if (codec != NOVA_COMPRESS_LZ4 || len < NOVA_COMPRESS_HEAD)
+    {
+        return NULL;
+    }
+    swReadI32((const uchar *)data, &raw_len);
+    /* an LZ4 block expands at most 255 times, a larger claim is corrupt */
+    if (raw_len < 0 || raw_len > NOVA_MAX_FRAME_SIZE || raw_len > (int64_t)(len - NOVA_COMPRESS_HEAD) * 255)
+    {
+        return NULL;
+    }
+
+    raw = malloc(raw_len + 1);
+    if (raw == NULL)
+    {
+        return NULL;
+    }
+    if (LZ4_decompress_safe(data + NOVA_COMPRESS_HEAD, raw, len - NOVA_COMPRESS_HEAD, raw_len) != raw_len)
+    {
+        free(raw);
+        return NULL;
+    }
+    raw[raw_len] = 0;
+    *out_len = raw_len;
+    return raw;
+#else
+    (void)codec;
+    (void)data;
+    (void)len;
+    (void)out_len;
+    return NULL;
+#endif
+}
+
+/* the codec named by one string field of an attachment, NOVA_COMPRESS_NONE when it is absent, -1 when it is unknown */
+static int attach_field_codec(const char *attach, int32_t attach_len, const char *field)
+{
+    cJSON *root, *item;
+    char key[32];
+    char *copy;
+    int key_len = snprintf(key, sizeof(key), "\"%s\"", field);
+    int codec = NOVA_COMPRESS_NONE;
+
+    /* attachments rarely carry it, only those that mention the key are parsed */
+    if (attach_len == 0 || memmem(attach, attach_len, key, key_len) == NULL)
+    {
+        return NOVA_COMPRESS_NONE;
+    }
+
+    copy = malloc(attach_len + 1);
+    if (copy == NULL)
+    {
+        return -1;
+    }
+    memcpy(copy, attach, attach_len);
+    copy[attach_len] = 0;
+    root = cJSON_Parse(copy);
+    free(copy);
+
+    item = cJSON_GetObjectItemCaseSensitive(root, field);
+    if (item)
+    {
+        codec = -1;
+        if (cJSON_IsString(item) && strcmp(item->valuestring, codec_names[NOVA_COMPRESS_LZ4]) == 0)
+        {
+            codec = NOVA_COMPRESS_LZ4;
+        }
+    }
+    cJSON_Delete(root);
+    return codec;
+}
+
+int nova_attach_codec(const char *attach, int32_t attach_len)
+{
+    return attach_field_codec(attach, attach_len, NOVA_ATTACH_COMPRESS);
+}
+
+int nova_attach_accepts(const char *attach, int32_t attach_len)
+{
+    int codec = attach_field_codec(attach, attach_len, NOVA_ATTACH_ACCEPT);
+
+    if (codec <= NOVA_COMPRESS_NONE)
+    {
+        codec = attach_field_codec(attach, attach_len, NOVA_ATTACH_COMPRESS);
+    }
+    return codec < 0 ? NOVA_COMPRESS_NONE : codec;
+}
+
+void nova_compressor_learn(nova_compressor *c, const char *attach, int32_t attach_len)
+{
+    if (c->codec != NOVA_COMPRESS_NONE && !c->accepted && attach_len > 0)
+    {
+        c->accepted = nova_attach_accepts(attach, attach_len) == c->codec;
+    }
+}
+
+static void compressor_reset_attach(nova_compressor *c)
+{
+    free(c->attach_src);
+    free(c->attach[0]);
+    free(c->attach[1]);
+    c->attach_src = c->attach[0] = c->attach[1] = NULL;
+}
+
+/* kept across calls, so copied out of whatever arena scope the call runs in */
+static char *print_copy(cJSON *root)
+{
+    char *json = cJSON_PrintUnformatted(root);
+    char *copy = json ? strdup(json) : NULL;
+
+    cJSON_free(json);
+    return copy;
+}
+
+/* derive both negotiating attachments from the caller's one, kept until it changes */
+static int compressor_attach(nova_compressor *c, const char *json_attach)
+{
+    cJSON *root;
+
+    compressor_reset_attach(c);
+    root = cJSON_Parse(json_attach);
+    if (!cJSON_IsObject(root))
+    {
+        fprintf(stderr, "ERROR, attachment must be a JSON object to negotiate compression: %s\n", json_attach);
+        cJSON_Delete(root);
+        return SW_ERR;
+    }
+
+    cJSON_DeleteItemFromObjectCaseSensitive(root, NOVA_ATTACH_ACCEPT);
+    cJSON_DeleteItemFromObjectCaseSensitive(root, NOVA_ATTACH_COMPRESS);
+    cJSON_AddStringToObject(root, NOVA_ATTACH_ACCEPT, codec_names[c->codec]);
+    c->attach[0] = print_copy(root);
+    cJSON_AddStringToObject(root, NOVA_ATTACH_COMPRESS, codec_names[c->codec]);
+    c->attach[1] = print_copy(root);
+    c->attach_src = strdup(json_attach);
+    cJSON_Delete(root);
+
+    if (c->attach[0] == NULL || c->attach[1] == NULL || c->attach_src == NULL)
+    {
+        compressor_reset_attach(c);
+        return SW_ERR;
+    }
+    return SW_OK;
+}
+
+int nova_compressor_apply(nova_compressor *c, const char **args, int32_t *args_len, const char **attach)
+{
+    if (c->codec == NOVA_COMPRESS_NONE)
+    {
+        return SW_OK;
+    }
+    if ((c->attach_src == NULL || strcmp(c->attach_src, *attach) != 0) && !compressor_attach(c, *attach))
+    {
+        return SW_ERR;
+    }
+
+    /* until a reply shows the server reads the codec, calls only offer to accept it */
+    if (c->accepted && *args_len >= c->min_size && nova_compress_payload(&c->buf, c->codec, *args, *args_len))
+    {
+        *args = c->buf.data;
+        *args_len = c->buf.len;
+        *attach = c->attach[1];
+    }
+    else
+    {
+        *attach = c->attach[0];
+    }
+    return SW_OK;
+}
+
+void nova_compressor_free(nova_compressor *c)
+{
+    compressor_reset_attach(c);
+    nova_buf_free(&c->buf);
+}
@@ -0,0 +1,375 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include "connpool.h"
+
+int64_t nova_now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int64_t nova_now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int timeval_ms(const struct timeval *tv)
+{
+    if (tv == NULL || (tv->tv_sec == 0 && tv->tv_usec == 0))
+    {
+        return -1;
+    }
+    return (int)(tv->tv_sec * 1000 + tv->tv_usec / 1000);
+}
+
+int nova_connect_start(const nova_addr *addr, int *connected, int *err)
+{
+    int fd = socket(addr->sa.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        *err = errno;
+        return -1;
+    }
+
+    *connected = connect(fd, (const struct sockaddr *)&addr->sa, addr->len) == 0;
+    if (!*connected && errno != EINPROGRESS)
+    {
+        *err = errno;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int socket_connect(nova_dns *dns, const char *host, int port, const struct timeval *timeout)
+{
+    nova_addr addrs[NOVA_DNS_MAX_ADDRS];
+    struct pollfd pfds[NOVA_DNS_MAX_ADDRS];
+    int timeout_ms = timeval_ms(timeout);
+    int64_t now = nova_now_ms();
+    int64_t deadline = timeout_ms < 0 ? INT64_MAX : now + timeout_ms;
+    int64_t next_attempt = now;
+    int count, next = 0, pending = 0;
+    int sockfd = -1;
+    int connected = 0;
+    int last_err = ETIMEDOUT;
+    int err, wait, n, i;
+    socklen_t len;
+
+    count = nova_dns_resolve(dns, host, port, addrs, NOVA_DNS_MAX_ADDRS, timeout_ms);
+    if (count == 0)
+    {
+        fprintf(stderr, "ERROR, no such host as %s\n", host);
+        return -1;
+    }
+
+    /*
+     * Happy Eyeballs (RFC 8305): a new attempt starts every CONNECT_ATTEMPT_DELAY_MS
+     * or as soon as the previous one fails, the first to connect wins
+     */
+    while (sockfd < 0)
+    {
+        now = nova_now_ms();
+        if (next < count && (pending == 0 || now >= next_attempt))
+        {
+            pfds[pending].fd = nova_connect_start(&addrs[next++], &connected, &last_err);
+            next_attempt = now + CONNECT_ATTEMPT_DELAY_MS;
+            if (pfds[pending].fd >= 0)
+            {
+                if (connected)
+                {
+                    sockfd = pfds[pending].fd;
+                    break;
+                }
+                pfds[pending].events = POLLOUT;
+                pending++;
+            }
+            continue;
+        }
+        if (pending == 0 || now >= deadline)
+        {
+            break;
+        }
+
+        wait = deadline - now > INT32_MAX ? -1 : (int)(deadline - now);
+        if (next < count && (wait < 0 || next_attempt - now < wait))
+        {
+            wait = (int)(next_attempt - now);
+        }
+        n = poll(pfds, pending, wait);
+        if (n < 0 && errno != EINTR)
+        {
+            last_err = errno;
+            break;
+        }
+
+        for (i = 0; n > 0 && i < pending; i++)
+        {
+            if (!pfds[i].revents)
+            {
+                continue;
+            }
+            err = 0;
+            len = sizeof(err);
+            if (getsockopt(pfds[i].fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+            {
+                err = errno;
+            }
+            if (err == 0)
+            {
+                sockfd = pfds[i].fd;
+                pfds[i] = pfds[--pending];
+                break;
+            }
+            last_err = err;
+            close(pfds[i].fd);
+            pfds[i--] = pfds[--pending];
+            next_attempt = now; /* do not wait out the delay after a failure */
+        }
+    }
+
+    for (i = 0; i < pending; i++)
+    {
+        close(pfds[i].fd);
+    }
+
+    if (sockfd < 0)
+    {
+        fprintf(stderr, "ERROR connecting %s:%d: %s\n", host, port, strerror(last_err));
+        nova_dns_invalidate(dns, host);
+        return -1;
+    }
+
+    /* callers expect a blocking socket */
+    fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL) & ~O_NONBLOCK);
+    nova_connect_ready(sockfd, timeout);
+    return sockfd;
+}
+
+void nova_connect_ready(int fd, const struct timeval *timeout)
+{
+    int on = 1;
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+    if (timeout)
+    {
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, (const char *)timeout, sizeof(struct timeval));
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (const char *)timeout, sizeof(struct timeval));
+    }
+}
+
+nova_pool *nova_pool_create(int max_idle, int64_t idle_timeout, struct timeval timeout)
+{
+    nova_pool *pool = calloc(1, sizeof(nova_pool));
+    if (pool == NULL)
+    {
+        return NULL;
+    }
+    pool->max_idle = max_idle > 0 ? max_idle : POOL_MAX_IDLE_PER_HOST;
+    pool->idle_timeout = idle_timeout > 0 ? idle_timeout : POOL_IDLE_TIMEOUT_MS;
+    pool->timeout = timeout;
+    nova_dns_init(&pool->dns, NOVA_DNS_TTL_MS);
+    return pool;
+}
+
+static void conn_close(nova_conn *conn)
+{
+    close(conn->fd);
+    free(conn);
+}
+
+void nova_pool_destroy(nova_pool *pool)
+{
+    nova_pool_host *ph, *ph_next;
+    nova_conn *conn, *conn_next;
+
+    if (pool == NULL)
+    {
+        return;
+    }
+
+    for (ph = pool->hosts; ph; ph = ph_next)
+    {
+        ph_next = ph->next;
+        for (conn = ph->idle; conn; conn = conn_next)
+        {
+            conn_next = conn->next;
+            conn_close(conn);
+        }
+        free(ph->host);
+        free(ph);
+    }
+    nova_dns_free(&pool->dns);
+    free(pool);
+}
+
+static nova_pool_host *pool_host(nova_pool *pool, const char *host, int port)
+{
+    nova_pool_host *ph;
+
+    for (ph = pool->hosts; ph; ph = ph->next)
+    {
+        if (ph->port == port && strcmp(ph->host, host) == 0)
+        {
+            return ph;
+        }
+    }
+
+    ph = calloc(1, sizeof(nova_pool_host));
+    if (ph == NULL)
+    {
+        return NULL;
+    }
+    ph->host = strdup(host);
+    if (ph->host == NULL)
+    {
+        free(ph);
+        return NULL;
+    }
+    ph->port = port;
+    ph->next = pool->hosts;
+    pool->hosts = ph;
+    return ph;
+}
+
+int nova_conn_alive(nova_conn *conn)
+{
+    char c;
+    ssize_t n;
+
+    n = recv(conn->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n >= 0)
+    {
+        /* 0: closed by peer, >0: bytes nobody asked for, the stream is out of sync */
+        return 0;
+    }
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+nova_conn *nova_pool_idle(nova_pool *pool, const char *host, int port)
+{
+    nova_pool_host *ph;
+    nova_conn *conn;
+
+    nova_pool_evict(pool);
+
+    ph = pool_host(pool, host, port);
+    if (ph == NULL)
+    {
+        fprintf(stderr, "ERROR, fail to alloc pool host\n");
+        return NULL;
+    }
+
+    while ((conn = ph->idle))
+    {
+        ph->idle = conn->next;
+        ph->idle_count--;
+        conn->next = NULL;
+        if (nova_conn_alive(conn))
+        {
+            return conn;
+        }
+        conn_close(conn);
+    }
+    return NULL;
+}
+
+nova_conn *nova_pool_wrap(nova_pool *pool, const char *host, int port, int fd)
+{
+    nova_pool_host *ph = pool_host(pool, host, port);
+    nova_conn *conn = ph ? calloc(1, sizeof(nova_conn)) : NULL;
+
+    if (conn == NULL)
+    {
+        fprintf(stderr, "ERROR, fail to alloc pool conn\n");
+        return NULL;
+    }
+    conn->fd = fd;
+    conn->host = ph;
+    return conn;
+}
+
+nova_conn *nova_pool_acquire(nova_pool *pool, const char *host, int port)
+{
+    nova_conn *conn;
+    int fd;
+
+    conn = nova_pool_idle(pool, host, port);
+    if (conn)
+    {
+        return conn;
+    }
+
+    fd = socket_connect(&pool->dns, host, port, &pool->timeout);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    conn = nova_pool_wrap(pool, host, port, fd);
+    if (conn == NULL)
+    {
+        close(fd);
+    }
+    return conn;
+}
+
+void nova_pool_release(nova_pool *pool, nova_conn *conn, int reusable)
+{
+    nova_pool_host *ph = conn->host;
+
+    if (!reusable || ph->idle_count >= pool->max_idle)
+    {
+        conn_close(conn);
+        return;
+    }
+
+    conn->last_used = nova_now_ms();
+    conn->next = ph->idle;
+    ph->idle = conn;
+    ph->idle_count++;
+}
+
+int nova_pool_evict(nova_pool *pool)
+{
+    nova_pool_host *ph;
+    nova_conn **pp, *conn;
+    int64_t deadline = nova_now_ms() - pool->idle_timeout;
+    int n = 0;
+
+    for (ph = pool->hosts; ph; ph = ph->next)
+    {
+        pp = &ph->idle;
+        while ((conn = *pp))
+        {
+            if (conn->last_used < deadline)
+            {
+                *pp = conn->next;
+                ph->idle_count--;
+                conn_close(conn);
+                n++;
+            }
+            else
+            {
+                pp = &conn->next;
+            }
+        }
+    }
+    return n;
+}
@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "decoder.h"
+#include "nova.h"
+#include "binarydata.h"
+
+int nova_buf_reserve(nova_buf *buf, int32_t need)
+{
+    int64_t cap;
+    char *data;
+
+    if (need <= buf->cap)
+    {
+        return SW_OK;
+    }
+
+    cap = buf->cap ? buf->cap : RECV_BUF_SIZE;
+    while (cap < need)
+    {
+        cap *= 2;
+    }
+    if (cap > INT32_MAX)
+    {
+        cap = need;
+    }
+
+    data = realloc(buf->data, cap);
+    if (data == NULL)
+    {
+        return SW_ERR;
+    }
+    buf->data = data;
+    buf->cap = (int32_t)cap;
+    return SW_OK;
+}
+
+void nova_buf_free(nova_buf *buf)
+{
+    free(buf->data);
+    buf->data = NULL;
+    buf->len = buf->cap = 0;
+}
+
+/* check the fixed prefix, return msg_size or 0 so garbage never gets its body buffered */
+static int32_t decoder_check_prefix(const char *data)
+{
+    int32_t msg_size;
+    uint16_t magic;
+    int16_t head_size;
+
+    swReadI32((const uchar *)data, &msg_size);
+    swReadU16((const uchar *)data + 4, &magic);
+    swReadI16((const uchar *)data + 6, &head_size);
+
+    if (msg_size < NOVA_HEADER_COMMON_LEN)
+    {
+        fprintf(stderr, "ERROR: Invalid nova packet size %d\n", msg_size);
+        return 0;
+    }
+    if (msg_size > NOVA_MAX_FRAME_SIZE)
+    {
+        fprintf(stderr, "ERROR: too large nova packet size %d\n", msg_size);
+        return 0;
+    }
+    if (magic != NOVA_MAGIC)
+    {
+        fprintf(stderr, "ERROR: invalid nova magic 0x%x\n", magic);
+        return 0;
+    }
+    if (head_size < NOVA_HEADER_COMMON_LEN || head_size > msg_size)
+    {
+        fprintf(stderr, "ERROR: invalid nova head size %d\n", head_size);
+        return 0;
+    }
+    return msg_size;
+}
+
+static void decoder_rewind(nova_decoder *dec)
+{
+    if (dec->emitted)
+    {
+        dec->buf.len = 0;
+        dec->msg_size = 0;
+        dec->emitted = 0;
+    }
+}
+
+int nova_decoder_feed(nova_decoder *dec, const char **data, int32_t *len, const char **frame, int32_t *frame_len)
+{
+    int32_t need, take, msg_size;
+
+    if (dec->failed)
+    {
+        return NOVA_DECODE_ERROR;
+    }
+    decoder_rewind(dec);
+
+    if (dec->buf.len == 0)
+    {
+        /* at a frame boundary: a frame lying whole in the chunk is handed out in place */
+        if (*len < NOVA_FRAME_PREFIX)
+        {
+            if (*len == 0)
+            {
+                return NOVA_DECODE_MORE;
+            }
+        }
+        else
+        {
+            msg_size = decoder_check_prefix(*data);
+            if (msg_size == 0)
+            {
+                dec->failed = 1;
+                return NOVA_DECODE_ERROR;
+            }
+            if (*len >= msg_size)
+            {
+                *frame = *data;
+                *frame_len = msg_size;
+                *data += msg_size;
+                *len -= msg_size;
+                return NOVA_DECODE_FRAME;
+            }
+            if (!nova_buf_reserve(&dec->buf, msg_size))
+            {
+                dec->failed = 1;
+                return NOVA_DECODE_ERROR;
+            }
+            dec->msg_size = msg_size;
+        }
+    }
+
+    /* the frame is split: gather the prefix, check it, then gather the rest */
+    for (;;)
+    {
+        need = dec->msg_size ? dec->msg_size : NOVA_FRAME_PREFIX;
+        take = need - dec->buf.len;
+        if (take > *len)
+        {
+            take = *len;
+        }
+        if (take > 0)
+        {
+            if (!nova_buf_reserve(&dec->buf, need))
+            {
+                dec->failed = 1;
+                return NOVA_DECODE_ERROR;
+            }
+            memcpy(dec->buf.data + dec->buf.len, *data, take);
+            dec->buf.len += take;
+            *data += take;
+            *len -= take;
+        }
+        if (dec->buf.len < need)
+        {
+            return NOVA_DECODE_MORE;
+        }
+
+        if (dec->msg_size == 0)
+        {
+            dec->msg_size = decoder_check_prefix(dec->buf.data);
+            if (dec->msg_size == 0)
+            {
+                dec->failed = 1;
+                return NOVA_DECODE_ERROR;
+            }
+            continue;
+        }
+
+        *frame = dec->buf.data;
+        *frame_len = dec->msg_size;
+        dec->emitted = 1;
+        return NOVA_DECODE_FRAME;
+    }
+}
+
+char *nova_decoder_space(nova_decoder *dec, int32_t *room)
+{
+    int32_t need;
+
+    decoder_rewind(dec);
+    need = dec->msg_size ? dec->msg_size : NOVA_FRAME_PREFIX;
+    if (dec->failed || !nova_buf_reserve(&dec->buf, need))
+    {
+        return NULL;
+    }
+    *room = need - dec->buf.len;
+    return dec->buf.data + dec->buf.len;
+}
+
+void nova_decoder_commit(nova_decoder *dec, int32_t n)
+{
+    dec->buf.len += n;
+}
+
+int32_t nova_decoder_pending(const nova_decoder *dec)
+{
+    if (!nova_decoder_partial(dec) || dec->msg_size == 0)
+    {
+        return 0;
+    }
+    return dec->msg_size - dec->buf.len;
+}
+
+void nova_decoder_reset(nova_decoder *dec)
+{
+    dec->buf.len = 0;
+    dec->msg_size = 0;
+    dec->emitted = 0;
+    dec->failed = 0;
+}
+
+void nova_decoder_free(nova_decoder *dec)
+{
+    nova_buf_free(&dec->buf);
+    nova_decoder_reset(dec);
+}
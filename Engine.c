@@ -0,0 +1,1263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "engine.h"
+#include "nova.h"
+#include "binarydata.h"
+
+#define ENGINE_MAX_EVENTS 256
+
+#define URING_ENTRIES 256
+#define URING_BUFFERS 64
+
+/* io_uring user_data is the conn pointer tagged with the operation */
+#define URING_OP_SEND 1
+#define URING_OP_RECV 2
+#define URING_OP_CANCEL 3
+#define URING_OP_CONNECT 4
+#define URING_OP_MASK 7
+
+static int set_nonblock(int fd, int on)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0)
+    {
+        return SW_ERR;
+    }
+    flags = on ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    return fcntl(fd, F_SETFL, flags) < 0 ? SW_ERR : SW_OK;
+}
+
+/* the outcome of a non-blocking connect */
+static int sock_error(int fd)
+{
+    int err = 0;
+    socklen_t len = sizeof(err);
+
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+    {
+        return errno;
+    }
+    return err;
+}
+
+static int uring_open(nova_engine *eng)
+{
+#ifdef NOVA_HAVE_URING
+    if (!nova_uring_init(&eng->ring, URING_ENTRIES))
+    {
+        return SW_ERR;
+    }
+    if (!nova_uring_setup_buffers(&eng->ring, URING_BUFFERS, RECV_BUF_SIZE))
+    {
+        nova_uring_exit(&eng->ring);
+        return SW_ERR;
+    }
+    eng->multishot = 1;
+    return SW_OK;
+#else
+    return SW_ERR;
+#endif
+}
+
+nova_engine *nova_engine_create(nova_client *cli, int conn_count, int backend)
+{
+    int i;
+    nova_engine *eng = calloc(1, sizeof(nova_engine));
+    if (eng == NULL)
+    {
+        return NULL;
+    }
+
+    eng->cli = cli;
+    eng->timeout = cli->timeout.tv_sec * 1000 + cli->timeout.tv_usec / 1000;
+    eng->conn_count = conn_count > 0 ? conn_count : 1;
+    eng->conns = calloc(eng->conn_count, sizeof(nova_engine_conn));
+    eng->epfd = -1;
+
+    eng->backend = NOVA_ENGINE_EPOLL;
+    if (backend == NOVA_ENGINE_URING)
+    {
+        if (uring_open(eng))
+        {
+            eng->backend = NOVA_ENGINE_URING;
+        }
+        else if (cli->debug)
+        {
+            fprintf(stderr, "io_uring unavailable, fall back to epoll\n");
+        }
+    }
+    if (eng->backend == NOVA_ENGINE_EPOLL)
+    {
+        eng->epfd = epoll_create1(EPOLL_CLOEXEC);
+        eng->recv_chunk = malloc(NOVA_ENGINE_RECV_CHUNK);
+    }
+
+    if (eng->conns == NULL || (eng->backend == NOVA_ENGINE_EPOLL && (eng->epfd < 0 || eng->recv_chunk == NULL)) || !nova_inflight_init(&eng->inflight, 1024))
+    {
+        fprintf(stderr, "ERROR, fail to create nova engine\n");
+        if (eng->epfd >= 0)
+        {
+            close(eng->epfd);
+        }
+#ifdef NOVA_HAVE_URING
+        if (eng->backend == NOVA_ENGINE_URING)
+        {
+            nova_uring_exit(&eng->ring);
+        }
+#endif
+        free(eng->recv_chunk);
+        free(eng->conns);
+        free(eng);
+        return NULL;
+    }
+    for (i = 0; i < eng->conn_count; i++)
+    {
+        eng->conns[i].idx = i;
+    }
+
+    // 在事件循环开始前解析一次, 缓存未命中时最多阻塞一个超时; 解析不到时每次建连都报错
+    eng->addr_count = nova_dns_resolve(&cli->pool->dns, cli->host, cli->port, eng->addrs, NOVA_DNS_MAX_ADDRS,
+                                       eng->timeout > 0 ? (int)eng->timeout : -1);
+    return eng;
+}
+
+static nova_req *req_alloc(nova_engine *eng)
+{
+    nova_req *req = eng->free_reqs;
+    if (req)
+    {
+        eng->free_reqs = req->next;
+        return req;
+    }
+    return malloc(sizeof(nova_req));
+}
+
+static void req_unlink(nova_engine *eng, nova_req *req)
+{
+    if (req->prev)
+    {
+        req->prev->next = req->next;
+    }
+    else
+    {
+        eng->oldest = req->next;
+    }
+    if (req->next)
+    {
+        req->next->prev = req->prev;
+    }
+    else
+    {
+        eng->newest = req->prev;
+    }
+}
+
+/* take req out of the in-flight table, the deadline list and its connection */
+static void req_detach(nova_engine *eng, nova_req *req)
+{
+    nova_inflight_take(&eng->inflight, req->seq_no);
+    req_unlink(eng, req);
+    req->ec->inflight--;
+}
+
+/* the request must already be detached, the callback may submit new requests */
+static void req_finish(nova_engine *eng, nova_req *req, int status, nova_resp *resp)
+{
+    nova_resp empty = {0};
+
+    if (status == NOVA_REQ_OK)
+    {
+        eng->stats.completed++;
+    }
+    else if (status == NOVA_REQ_TIMEOUT)
+    {
+        eng->stats.timeouts++;
+    }
+    else if (status == NOVA_REQ_EXCEPTION)
+    {
+        eng->stats.exceptions++;
+    }
+    else
+    {
+        eng->stats.failed++;
+    }
+
+    if (resp == NULL)
+    {
+        resp = &empty;
+    }
+    req->cb(eng, status, resp, req->udata);
+    nova_resp_free(resp);
+
+    req->next = eng->free_reqs;
+    eng->free_reqs = req;
+}
+
+static inline int conn_usable(nova_engine_conn *ec)
+{
+    return ec->conn != NULL && !ec->closing;
+}
+
+#ifdef NOVA_HAVE_URING
+static struct io_uring_sqe *uring_sqe(nova_engine *eng)
+{
+    struct io_uring_sqe *sqe = nova_uring_get_sqe(&eng->ring);
+    if (sqe == NULL)
+    {
+        /* submission queue full, hand the batch to the kernel */
+        nova_uring_submit(&eng->ring, 0, 0);
+        eng->stats.syscalls++;
+        sqe = nova_uring_get_sqe(&eng->ring);
+    }
+    return sqe;
+}
+
+static void uring_cancel(nova_engine *eng, nova_engine_conn *ec, int op)
+{
+    struct io_uring_sqe *sqe = uring_sqe(eng);
+    if (sqe == NULL)
+    {
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t)ec | op;
+    sqe->user_data = (uint64_t)(uintptr_t)ec | URING_OP_CANCEL;
+    ec->ring_ops++;
+}
+#endif
+
+static void conn_release(nova_engine *eng, nova_engine_conn *ec, int reusable)
+{
+    if (reusable)
+    {
+        set_nonblock(ec->conn->fd, 0);
+    }
+    nova_pool_release(eng->cli->pool, ec->conn, reusable);
+    ec->conn = NULL;
+    if (ec->connecting)
+    {
+        ec->connecting = 0;
+        eng->connecting--;
+    }
+    ec->closing = 0;
+    ec->want_write = 0;
+    ec->abandoned = 0;
+    ec->out_len = ec->out_off = 0;
+    ec->send_len = ec->send_off = 0;
+    nova_decoder_reset(&ec->dec);
+}
+
+static void conn_close(nova_engine *eng, nova_engine_conn *ec, int reusable)
+{
+    if (!conn_usable(ec))
+    {
+        return;
+    }
+    if (ec->connecting)
+    {
+        reusable = 0;
+    }
+
+    if (eng->backend == NOVA_ENGINE_EPOLL)
+    {
+        epoll_ctl(eng->epfd, EPOLL_CTL_DEL, ec->conn->fd, NULL);
+        eng->stats.syscalls++;
+        conn_release(eng, ec, reusable);
+        return;
+    }
+
+#ifdef NOVA_HAVE_URING
+    if (ec->ring_ops == 0)
+    {
+        conn_release(eng, ec, reusable);
+        return;
+    }
+    /* the kernel still owns our buffers, release once every operation has completed */
+    ec->closing = 1;
+    ec->close_reusable = reusable && !ec->sending;
+    if (ec->connecting)
+    {
+        uring_cancel(eng, ec, URING_OP_CONNECT);
+    }
+    else if (ec->close_reusable)
+    {
+        uring_cancel(eng, ec, URING_OP_RECV);
+    }
+    else
+    {
+        shutdown(ec->conn->fd, SHUT_RDWR);
+    }
+#endif
+}
+
+static void conn_fail(nova_engine *eng, nova_engine_conn *ec)
+{
+    nova_req *req, *next;
+    nova_req *failed = NULL;
+
+    conn_close(eng, ec, 0);
+
+    /* detach first, callbacks may reopen ec and submit to it */
+    for (req = eng->oldest; req && ec->inflight > 0; req = next)
+    {
+        next = req->next;
+        if (req->ec == ec)
+        {
+            req_detach(eng, req);
+            req->next = failed;
+            failed = req;
+        }
+    }
+    while ((req = failed))
+    {
+        failed = req->next;
+        req_finish(eng, req, NOVA_REQ_ERR, NULL);
+    }
+}
+
+#ifdef NOVA_HAVE_URING
+static void uring_arm_recv(nova_engine *eng, nova_engine_conn *ec)
+{
+    struct io_uring_sqe *sqe = uring_sqe(eng);
+    if (sqe == NULL)
+    {
+        conn_fail(eng, ec);
+        return;
+    }
+    /* data lands in the provided buffer ring, never in memory tied to this conn */
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = ec->conn->fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->ioprio = eng->multishot ? IORING_RECV_MULTISHOT : 0;
+    sqe->user_data = (uint64_t)(uintptr_t)ec | URING_OP_RECV;
+    ec->recv_armed = 1;
+    ec->ring_ops++;
+}
+#endif
+
+#ifdef NOVA_HAVE_URING
+static int uring_connect(nova_engine *eng, nova_engine_conn *ec)
+{
+    struct io_uring_sqe *sqe = uring_sqe(eng);
+    if (sqe == NULL)
+    {
+        return SW_ERR;
+    }
+    sqe->opcode = IORING_OP_CONNECT;
+    sqe->fd = ec->conn->fd;
+    sqe->addr = (uint64_t)(uintptr_t)&ec->addr.sa;
+    sqe->off = ec->addr.len;
+    sqe->user_data = (uint64_t)(uintptr_t)ec | URING_OP_CONNECT;
+    ec->ring_ops++;
+    return SW_OK;
+}
+#endif
+
+/* start the attempt on the next address, SW_ERR with the last failure in *err once none is left */
+static int conn_connect(nova_engine *eng, nova_engine_conn *ec, int *err)
+{
+    struct epoll_event ev;
+    const nova_addr *addr;
+    int connected;
+    int fd;
+
+    while (ec->addr_next < eng->addr_count)
+    {
+        addr = &eng->addrs[ec->addr_next++];
+        // 后面还有地址时每次尝试只等 Happy Eyeballs 的间隔, 最后一个地址等满超时
+        ec->connect_deadline = ec->addr_next < eng->addr_count ? nova_now_ms() + CONNECT_ATTEMPT_DELAY_MS : nova_now_ms() + eng->timeout;
+
+#ifdef NOVA_HAVE_URING
+        if (eng->backend == NOVA_ENGINE_URING)
+        {
+            fd = socket(addr->sa.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0)
+            {
+                *err = errno;
+                continue;
+            }
+            ec->conn->fd = fd;
+            ec->addr = *addr;
+            if (uring_connect(eng, ec))
+            {
+                return SW_OK;
+            }
+            *err = EBUSY;
+            close(fd);
+            ec->conn->fd = -1;
+            continue;
+        }
+#endif
+
+        /* finished or not, the outcome is read when EPOLLOUT fires */
+        fd = nova_connect_start(addr, &connected, err);
+        if (fd < 0)
+        {
+            continue;
+        }
+        ec->conn->fd = fd;
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.ptr = ec;
+        eng->stats.syscalls++;
+        if (epoll_ctl(eng->epfd, EPOLL_CTL_ADD, fd, &ev) == 0)
+        {
+            ec->want_write = 1;
+            return SW_OK;
+        }
+        *err = errno;
+        close(fd);
+        ec->conn->fd = -1;
+    }
+    return SW_ERR;
+}
+
+/* register a connected socket with the backend */
+static int conn_watch(nova_engine *eng, nova_engine_conn *ec)
+{
+    struct epoll_event ev;
+
+#ifdef NOVA_HAVE_URING
+    if (eng->backend == NOVA_ENGINE_URING)
+    {
+        uring_arm_recv(eng, ec);
+        return conn_usable(ec);
+    }
+#endif
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = ec;
+    if (!set_nonblock(ec->conn->fd, 1) || epoll_ctl(eng->epfd, EPOLL_CTL_ADD, ec->conn->fd, &ev) < 0)
+    {
+        perror("ERROR registering connection");
+        nova_pool_release(eng->cli->pool, ec->conn, 0);
+        ec->conn = NULL;
+        return SW_ERR;
+    }
+    eng->stats.syscalls++;
+    return SW_OK;
+}
+
+static int conn_open(nova_engine *eng, nova_engine_conn *ec)
+{
+    nova_client *cli = eng->cli;
+    int err = ETIMEDOUT;
+
+    ec->conn = nova_pool_idle(cli->pool, cli->host, cli->port);
+    if (ec->conn)
+    {
+        return conn_watch(eng, ec);
+    }
+
+    /* the addresses were resolved by nova_engine_create, a lookup here would block the loop */
+    if (eng->addr_count == 0)
+    {
+        fprintf(stderr, "ERROR, no such host as %s\n", cli->host);
+        return SW_ERR;
+    }
+    ec->conn = nova_pool_wrap(cli->pool, cli->host, cli->port, -1);
+    if (ec->conn == NULL)
+    {
+        return SW_ERR;
+    }
+    ec->connecting = 1;
+    eng->connecting++;
+    ec->addr_next = 0;
+    if (!conn_connect(eng, ec, &err))
+    {
+        fprintf(stderr, "ERROR connecting %s:%d: %s\n", cli->host, cli->port, strerror(err));
+        nova_dns_invalidate(&cli->pool->dns, cli->host);
+        conn_release(eng, ec, 0);
+        return SW_ERR;
+    }
+    return SW_OK;
+}
+
+static void conn_want_write(nova_engine *eng, nova_engine_conn *ec, int on)
+{
+    struct epoll_event ev;
+
+    if (ec->want_write == on)
+    {
+        return;
+    }
+    ev.events = on ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    ev.data.ptr = ec;
+    epoll_ctl(eng->epfd, EPOLL_CTL_MOD, ec->conn->fd, &ev);
+    eng->stats.syscalls++;
+    ec->want_write = on;
+}
+
+/* room for len more bytes at the end of the queued frames, the caller bumps out_len */
+static char *conn_reserve(nova_engine_conn *ec, int len)
+{
+    char *tmp;
+    int cap;
+
+    if (ec->out_off == ec->out_len)
+    {
+        ec->out_off = ec->out_len = 0;
+    }
+    if (ec->out_len + len > ec->out_cap)
+    {
+        cap = ec->out_cap ? ec->out_cap : RECV_BUF_SIZE;
+        while (cap < ec->out_len + len)
+        {
+            cap *= 2;
+        }
+        tmp = realloc(ec->out_buf, cap);
+        if (tmp == NULL)
+        {
+            return NULL;
+        }
+        ec->out_buf = tmp;
+        ec->out_cap = cap;
+    }
+    return ec->out_buf + ec->out_len;
+}
+
+static int conn_append(nova_engine_conn *ec, const char *frame, int len)
+{
+    char *out = conn_reserve(ec, len);
+    if (out == NULL)
+    {
+        return SW_ERR;
+    }
+    memcpy(out, frame, len);
+    ec->out_len += len;
+    return SW_OK;
+}
+
+#ifdef NOVA_HAVE_URING
+static void uring_send(nova_engine *eng, nova_engine_conn *ec)
+{
+    struct io_uring_sqe *sqe;
+    char *tmp;
+    int cap;
+
+    if (ec->sending)
+    {
+        return;
+    }
+
+    /* swap buffers, submit keeps queueing into out_buf while the kernel sends */
+    if (ec->send_off == ec->send_len)
+    {
+        if (ec->out_off == ec->out_len)
+        {
+            return;
+        }
+        tmp = ec->send_buf;
+        cap = ec->send_cap;
+        ec->send_buf = ec->out_buf;
+        ec->send_cap = ec->out_cap;
+        ec->send_off = ec->out_off;
+        ec->send_len = ec->out_len;
+        ec->out_buf = tmp;
+        ec->out_cap = cap;
+        ec->out_off = ec->out_len = 0;
+    }
+
+    sqe = uring_sqe(eng);
+    if (sqe == NULL)
+    {
+        conn_fail(eng, ec);
+        return;
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = ec->conn->fd;
+    sqe->addr = (uint64_t)(uintptr_t)(ec->send_buf + ec->send_off);
+    sqe->len = ec->send_len - ec->send_off;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = (uint64_t)(uintptr_t)ec | URING_OP_SEND;
+    ec->sending = 1;
+    ec->ring_ops++;
+}
+#endif
+
+static void conn_flush(nova_engine *eng, nova_engine_conn *ec)
+{
+    ssize_t n;
+
+    if (ec->connecting)
+    {
+        return;
+    }
+
+#ifdef NOVA_HAVE_URING
+    if (eng->backend == NOVA_ENGINE_URING)
+    {
+        if (conn_usable(ec))
+        {
+            uring_send(eng, ec);
+        }
+        return;
+    }
+#endif
+
+    while (ec->conn && ec->out_off < ec->out_len)
+    {
+        n = send(ec->conn->fd, ec->out_buf + ec->out_off, ec->out_len - ec->out_off, MSG_NOSIGNAL);
+        eng->stats.syscalls++;
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                conn_want_write(eng, ec, 1);
+                return;
+            }
+            perror("ERROR sending");
+            conn_fail(eng, ec);
+            return;
+        }
+        ec->out_off += n;
+    }
+
+    if (ec->conn)
+    {
+        ec->out_off = ec->out_len = 0;
+        conn_want_write(eng, ec, 0);
+    }
+}
+
+/* the current attempt finished with err, 0 when connected, a failure moves on to the next address */
+static void conn_connect_done(nova_engine *eng, nova_engine_conn *ec, int err)
+{
+    nova_client *cli = eng->cli;
+
+    if (err == 0)
+    {
+        ec->connecting = 0;
+        eng->connecting--;
+        nova_connect_ready(ec->conn->fd, &cli->timeout);
+#ifdef NOVA_HAVE_URING
+        if (eng->backend == NOVA_ENGINE_URING)
+        {
+            uring_arm_recv(eng, ec);
+        }
+#endif
+        /* frames queued while connecting go out now */
+        conn_flush(eng, ec);
+        return;
+    }
+
+    /* closing the socket takes it out of epoll as well */
+    close(ec->conn->fd);
+    ec->conn->fd = -1;
+    if (conn_connect(eng, ec, &err))
+    {
+        return;
+    }
+    fprintf(stderr, "ERROR connecting %s:%d: %s\n", cli->host, cli->port, strerror(err));
+    nova_dns_invalidate(&cli->pool->dns, cli->host);
+    conn_fail(eng, ec);
+}
+
+/* attempts past their deadline give way to the next address */
+static void connect_expire(nova_engine *eng, int64_t now)
+{
+    nova_engine_conn *ec;
+    int i;
+
+    for (i = 0; i < eng->conn_count && eng->connecting > 0; i++)
+    {
+        ec = &eng->conns[i];
+        if (!ec->connecting || ec->closing || ec->connect_deadline > now)
+        {
+            continue;
+        }
+#ifdef NOVA_HAVE_URING
+        if (eng->backend == NOVA_ENGINE_URING)
+        {
+            /* the canceled connect completes with -ECANCELED and moves on from there */
+            ec->connect_deadline = INT64_MAX;
+            uring_cancel(eng, ec, URING_OP_CONNECT);
+            continue;
+        }
+#endif
+        conn_connect_done(eng, ec, ETIMEDOUT);
+    }
+}
+
+/* the earliest request or connect deadline, INT64_MAX when there is none */
+static int64_t engine_deadline(nova_engine *eng)
+{
+    int64_t deadline = eng->oldest ? eng->oldest->deadline : INT64_MAX;
+    int i;
+
+    for (i = 0; i < eng->conn_count && eng->connecting > 0; i++)
+    {
+        if (eng->conns[i].connecting && !eng->conns[i].closing && eng->conns[i].connect_deadline < deadline)
+        {
+            deadline = eng->conns[i].connect_deadline;
+        }
+    }
+    return deadline;
+}
+
+/* complete a reply, replies to timed out requests are dropped before anything is decoded */
+static int conn_frame(nova_engine *eng, nova_engine_conn *ec, const char *frame, int32_t frame_len)
+{
+    int64_t seq_no;
+    swNova_HeaderView view;
+    nova_resp resp;
+    int status;
+    nova_req *req = NULL;
+
+    if (swNova_unpack_view(frame, frame_len, &view))
+    {
+        req = nova_inflight_take(&eng->inflight, view.seq_no);
+    }
+    if (req == NULL)
+    {
+        if (ec->abandoned > 0)
+        {
+            ec->abandoned--;
+        }
+        return 0;
+    }
+
+    nova_unpack_resp(frame, frame_len, eng->cli->schema, eng->cli->debug, &seq_no, &resp);
+    req_unlink(eng, req);
+    req->ec->inflight--;
+    if (resp.json == NULL)
+    {
+        status = NOVA_REQ_ERR;
+    }
+    else
+    {
+        status = resp.exception ? NOVA_REQ_EXCEPTION : NOVA_REQ_OK;
+        nova_compressor_learn(&eng->cli->compress, resp.attach, resp.attach_len);
+    }
+    req_finish(eng, req, status, &resp);
+    return 1;
+}
+
+/* complete every whole reply in data, a split one is kept by the decoder */
+static int conn_feed(nova_engine *eng, nova_engine_conn *ec, const char *data, int32_t len)
+{
+    const char *frame;
+    int32_t frame_len;
+    int ret, done = 0;
+
+    for (;;)
+    {
+        ret = nova_decoder_feed(&ec->dec, &data, &len, &frame, &frame_len);
+        if (ret == NOVA_DECODE_MORE)
+        {
+            return done;
+        }
+        if (ret == NOVA_DECODE_ERROR)
+        {
+            conn_fail(eng, ec);
+            return done;
+        }
+        done += conn_frame(eng, ec, frame, frame_len);
+
+        /* a callback may not close this conn, but stay defensive */
+        if (!conn_usable(ec))
+        {
+            return done;
+        }
+    }
+}
+
+static int conn_read(nova_engine *eng, nova_engine_conn *ec)
+{
+    char *space = eng->recv_chunk;
+    int32_t room = NOVA_ENGINE_RECV_CHUNK;
+    int32_t pending = nova_decoder_pending(&ec->dec);
+    ssize_t n;
+
+    /* the rest of a large reply is read in place, nothing past it is touched */
+    if (pending >= NOVA_ENGINE_RECV_CHUNK)
+    {
+        space = nova_decoder_space(&ec->dec, &room);
+        if (space == NULL)
+        {
+            conn_fail(eng, ec);
+            return 0;
+        }
+    }
+    n = recv(ec->conn->fd, space, room, 0);
+    eng->stats.syscalls++;
+    if (n <= 0)
+    {
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            return 0;
+        }
+        if (n < 0)
+        {
+            perror("ERROR receiving");
+        }
+        conn_fail(eng, ec);
+        return 0;
+    }
+    if (space != eng->recv_chunk)
+    {
+        nova_decoder_commit(&ec->dec, (int32_t)n);
+        return conn_feed(eng, ec, NULL, 0);
+    }
+    return conn_feed(eng, ec, space, (int32_t)n);
+}
+
+#ifdef NOVA_HAVE_URING
+static int uring_complete(nova_engine *eng, struct io_uring_cqe *cqe)
+{
+    nova_engine_conn *ec = (nova_engine_conn *)(uintptr_t)(cqe->user_data & ~(uint64_t)URING_OP_MASK);
+    int op = (int)(cqe->user_data & URING_OP_MASK);
+    int more = cqe->flags & IORING_CQE_F_MORE;
+    int done = 0;
+    unsigned bid;
+
+    if (!more)
+    {
+        ec->ring_ops--;
+    }
+
+    switch (op)
+    {
+    case URING_OP_CONNECT:
+        if (conn_usable(ec))
+        {
+            conn_connect_done(eng, ec, cqe->res == -ECANCELED ? ETIMEDOUT : -cqe->res);
+        }
+        break;
+
+    case URING_OP_SEND:
+        ec->sending = 0;
+        if (cqe->res < 0)
+        {
+            if (conn_usable(ec))
+            {
+                errno = -cqe->res;
+                perror("ERROR sending");
+                conn_fail(eng, ec);
+            }
+            break;
+        }
+        ec->send_off += cqe->res;
+        if (conn_usable(ec))
+        {
+            uring_send(eng, ec);
+        }
+        break;
+
+    case URING_OP_RECV:
+        if (cqe->flags & IORING_CQE_F_BUFFER)
+        {
+            bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+            if (cqe->res > 0 && conn_usable(ec))
+            {
+                done = conn_feed(eng, ec, nova_uring_buffer(&eng->ring, bid), cqe->res);
+            }
+            nova_uring_recycle(&eng->ring, bid);
+        }
+        if (more)
+        {
+            break;
+        }
+        ec->recv_armed = 0;
+        if (!conn_usable(ec))
+        {
+            break;
+        }
+        if (cqe->res == -EINVAL && eng->multishot)
+        {
+            /* kernel before 6.0, one recv per completion */
+            eng->multishot = 0;
+            uring_arm_recv(eng, ec);
+        }
+        else if (cqe->res > 0 || cqe->res == -ENOBUFS)
+        {
+            uring_arm_recv(eng, ec);
+        }
+        else
+        {
+            if (cqe->res < 0)
+            {
+                errno = -cqe->res;
+                perror("ERROR receiving");
+            }
+            conn_fail(eng, ec);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    if (ec->closing && ec->ring_ops == 0)
+    {
+        conn_release(eng, ec, ec->close_reusable);
+    }
+    return done;
+}
+
+static int uring_poll(nova_engine *eng, int timeout_ms)
+{
+    struct io_uring_cqe *cqe;
+    struct io_uring_cqe copy;
+    int done = 0;
+    int ret;
+
+    /* one syscall submits the whole batch and waits for completions */
+    ret = nova_uring_submit(&eng->ring, 1, timeout_ms);
+    eng->stats.syscalls++;
+    if (ret < 0 && ret != -ETIME && ret != -EINTR && ret != -EBUSY)
+    {
+        errno = -ret;
+        perror("ERROR io_uring_enter");
+        return -1;
+    }
+
+    while ((cqe = nova_uring_peek_cqe(&eng->ring)))
+    {
+        copy = *cqe;
+        nova_uring_cqe_seen(&eng->ring);
+        done += uring_complete(eng, &copy);
+    }
+    return done;
+}
+
+/* wait until the kernel is done with every connection that is closing */
+static void uring_drain(nova_engine *eng)
+{
+    int i, busy;
+    int64_t deadline = nova_now_ms() + eng->timeout;
+
+    do
+    {
+        busy = 0;
+        for (i = 0; i < eng->conn_count; i++)
+        {
+            busy += eng->conns[i].ring_ops;
+        }
+        if (busy == 0 || nova_now_ms() > deadline)
+        {
+            break;
+        }
+    } while (uring_poll(eng, 100) >= 0);
+}
+#endif
+
+static int expire(nova_engine *eng, int64_t now)
+{
+    int done = 0;
+    nova_req *req;
+
+    while ((req = eng->oldest) && req->deadline <= now)
+    {
+        req_detach(eng, req);
+        req->ec->abandoned++;
+        req_finish(eng, req, NOVA_REQ_TIMEOUT, NULL);
+        done++;
+    }
+    return done;
+}
+
+/* round robin, skipping connections still draining after a failure */
+static nova_engine_conn *engine_pick_conn(nova_engine *eng)
+{
+    nova_engine_conn *ec = NULL;
+    int i;
+
+    for (i = 0; i < eng->conn_count; i++)
+    {
+        ec = &eng->conns[eng->next_conn];
+        eng->next_conn = (eng->next_conn + 1) % eng->conn_count;
+        if (!ec->closing)
+        {
+            break;
+        }
+    }
+    if (ec->closing || (ec->conn == NULL && !conn_open(eng, ec)))
+    {
+        return NULL;
+    }
+    return ec;
+}
+
+/* the frame of seq_no is queued on ec, track it until reply or deadline */
+static void engine_track(nova_engine *eng, nova_engine_conn *ec, nova_req *req, int64_t seq_no, nova_req_cb cb, void *udata)
+{
+    req->seq_no = seq_no;
+    req->deadline = nova_now_ms() + eng->timeout;
+    req->ec = ec;
+    req->cb = cb;
+    req->udata = udata;
+    req->next = NULL;
+    req->prev = eng->newest;
+    if (eng->newest)
+    {
+        eng->newest->next = req;
+    }
+    else
+    {
+        eng->oldest = req;
+    }
+    eng->newest = req;
+    nova_inflight_put(&eng->inflight, seq_no, req);
+    ec->inflight++;
+    eng->stats.submitted++;
+
+    if (!ec->dirty)
+    {
+        ec->dirty = 1;
+        ec->next_dirty = eng->dirty;
+        eng->dirty = ec;
+    }
+}
+
+/* queue a whole frame already carrying seq_no */
+static int engine_queue(nova_engine *eng, const char *frame, int32_t frame_len, int64_t seq_no, nova_req_cb cb, void *udata)
+{
+    nova_engine_conn *ec;
+    nova_req *req;
+
+    ec = engine_pick_conn(eng);
+    if (ec == NULL)
+    {
+        return SW_ERR;
+    }
+
+    req = req_alloc(eng);
+    if (req == NULL || !conn_append(ec, frame, frame_len))
+    {
+        free(req);
+        return SW_ERR;
+    }
+
+    engine_track(eng, ec, req, seq_no, cb, udata);
+    return SW_OK;
+}
+
+int nova_engine_submit(nova_engine *eng,
+                       const char *service, const char *method,
+                       const char *json_args, const char *json_attach,
+                       nova_req_cb cb, void *udata)
+{
+    nova_engine_conn *ec;
+    nova_req *req;
+    const thrift_method *typed;
+    int32_t service_len = strlen(service);
+    int32_t method_len = strlen(method);
+    int32_t args_len = strlen(json_args);
+    int32_t frame_len;
+    int64_t seq_no;
+    char *out;
+
+    typed = nova_client_method(eng->cli, service, method);
+    if (typed || eng->cli->protocol != THRIFT_BINARY || eng->cli->compress.codec != NOVA_COMPRESS_NONE)
+    {
+        /* typed, compact and compressed frames have no template, they are encoded aside and copied in */
+        seq_no = eng->cli->seq_no + 1;
+        eng->typed_buf.len = 0;
+        if (!nova_client_encode(eng->cli, &eng->typed_buf, seq_no, service, method, json_args, json_attach) ||
+            !engine_queue(eng, eng->typed_buf.data, eng->typed_buf.len, seq_no, cb, udata))
+        {
+            return SW_ERR;
+        }
+        eng->cli->seq_no = seq_no;
+        return SW_OK;
+    }
+
+    // 附件不变时复用预先序列化的帧模板, 直接写入连接发送缓冲区
+    if (eng->tpl.attach == NULL || strcmp(eng->tpl.attach, json_attach) != 0)
+    {
+        nova_frame_tpl_free(&eng->tpl);
+        if (!nova_frame_tpl_init(&eng->tpl, json_attach))
+        {
+            return SW_ERR;
+        }
+    }
+
+    ec = engine_pick_conn(eng);
+    if (ec == NULL)
+    {
+        return SW_ERR;
+    }
+
+    frame_len = nova_frame_tpl_len(&eng->tpl, service_len, method_len, args_len);
+    req = req_alloc(eng);
+    out = req ? conn_reserve(ec, frame_len) : NULL;
+    if (out == NULL)
+    {
+        free(req);
+        return SW_ERR;
+    }
+
+    seq_no = ++eng->cli->seq_no;
+    ec->out_len += nova_frame_tpl_write(&eng->tpl, out, seq_no, service, service_len, method, method_len, json_args, args_len);
+    engine_track(eng, ec, req, seq_no, cb, udata);
+    return SW_OK;
+}
+
+int nova_engine_submit_frame(nova_engine *eng, char *frame, int32_t frame_len, nova_req_cb cb, void *udata)
+{
+    int64_t seq_no = eng->cli->seq_no + 1;
+
+    if (!nova_frame_set_seq(frame, frame_len, seq_no) || !engine_queue(eng, frame, frame_len, seq_no, cb, udata))
+    {
+        return SW_ERR;
+    }
+    eng->cli->seq_no = seq_no;
+    return SW_OK;
+}
+
+int nova_engine_poll(nova_engine *eng, int timeout_ms)
+{
+    struct epoll_event events[ENGINE_MAX_EVENTS];
+    nova_engine_conn *ec;
+    int64_t now, deadline;
+    int n, i;
+    int done = 0;
+
+    /* frames queued since the last iteration go out in one send per connection */
+    while ((ec = eng->dirty))
+    {
+        eng->dirty = ec->next_dirty;
+        ec->dirty = 0;
+        conn_flush(eng, ec);
+    }
+
+    deadline = engine_deadline(eng);
+    if (deadline != INT64_MAX)
+    {
+        now = nova_now_ms();
+        if (deadline - now < timeout_ms || timeout_ms < 0)
+        {
+            timeout_ms = deadline > now ? (int)(deadline - now) : 0;
+        }
+    }
+
+#ifdef NOVA_HAVE_URING
+    if (eng->backend == NOVA_ENGINE_URING)
+    {
+        n = uring_poll(eng, timeout_ms);
+        if (n < 0)
+        {
+            return -1;
+        }
+        now = nova_now_ms();
+        connect_expire(eng, now);
+        return n + expire(eng, now);
+    }
+#endif
+
+    n = epoll_wait(eng->epfd, events, ENGINE_MAX_EVENTS, timeout_ms);
+    eng->stats.syscalls++;
+    if (n < 0 && errno != EINTR)
+    {
+        perror("ERROR epoll_wait");
+        return -1;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        ec = events[i].data.ptr;
+        if (ec->conn && ec->connecting)
+        {
+            conn_connect_done(eng, ec, sock_error(ec->conn->fd));
+            continue;
+        }
+        if (ec->conn && (events[i].events & EPOLLOUT))
+        {
+            conn_flush(eng, ec);
+        }
+        if (ec->conn && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+        {
+            done += conn_read(eng, ec);
+        }
+    }
+
+    now = nova_now_ms();
+    connect_expire(eng, now);
+    return done + expire(eng, now);
+}
+
+void nova_engine_destroy(nova_engine *eng)
+{
+    int i;
+    nova_req *req;
+    nova_engine_conn *ec;
+
+    if (eng == NULL)
+    {
+        return;
+    }
+
+    /* only connections with nothing in flight or half read are in sync */
+    for (i = 0; i < eng->conn_count; i++)
+    {
+        ec = &eng->conns[i];
+        conn_close(eng, ec, ec->inflight == 0 && ec->abandoned == 0 && !nova_decoder_partial(&ec->dec) && ec->out_off == ec->out_len);
+    }
+
+    while ((req = eng->oldest))
+    {
+        req_detach(eng, req);
+        req_finish(eng, req, NOVA_REQ_ERR, NULL);
+    }
+    while ((req = eng->free_reqs))
+    {
+        eng->free_reqs = req->next;
+        free(req);
+    }
+
+    /* callbacks above may have resubmitted */
+    for (i = 0; i < eng->conn_count; i++)
+    {
+        conn_close(eng, &eng->conns[i], 0);
+    }
+
+#ifdef NOVA_HAVE_URING
+    if (eng->backend == NOVA_ENGINE_URING)
+    {
+        uring_drain(eng);
+        for (i = 0; i < eng->conn_count; i++)
+        {
+            ec = &eng->conns[i];
+            if (ec->conn)
+            {
+                /* the kernel never gave the send buffer back, leak it rather than free under it */
+                ec->send_buf = NULL;
+                conn_release(eng, ec, 0);
+            }
+        }
+        nova_uring_exit(&eng->ring);
+    }
+#endif
+
+    for (i = 0; i < eng->conn_count; i++)
+    {
+        ec = &eng->conns[i];
+        nova_decoder_free(&ec->dec);
+        free(ec->out_buf);
+        free(ec->send_buf);
+    }
+
+    nova_inflight_free(&eng->inflight);
+    nova_frame_tpl_free(&eng->tpl);
+    nova_buf_free(&eng->typed_buf);
+    if (eng->epfd >= 0)
+    {
+        close(eng->epfd);
+    }
+    free(eng->recv_chunk);
+    free(eng->conns);
+    free(eng);
+}
@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "histogram.h"
+#include "binarydata.h"
+
+#define HIST_MAGIC "NVH1"
+
+nova_histogram *nova_hist_create()
+{
+    nova_histogram *hist = malloc(sizeof(nova_histogram));
+    if (hist)
+    {
+        nova_hist_reset(hist);
+    }
+    return hist;
+}
+
+void nova_hist_destroy(nova_histogram *hist)
+{
+    free(hist);
+}
+
+void nova_hist_reset(nova_histogram *hist)
+{
+    memset(hist, 0, sizeof(*hist));
+    hist->min = INT64_MAX;
+}
+
+static inline int hist_index(int64_t value)
+{
+    /* bucket 0 holds [0, 2^SUB_BITS), bucket b > 0 holds [2^(SUB_BITS+b-1), 2^(SUB_BITS+b)) */
+    int bucket = 64 - __builtin_clzll((uint64_t)value | ((1 << NOVA_HIST_SUB_BITS) - 1)) - NOVA_HIST_SUB_BITS;
+    int sub = (int)(value >> bucket);
+
+    return ((bucket + 1) << (NOVA_HIST_SUB_BITS - 1)) + sub - NOVA_HIST_HALF_COUNT;
+}
+
+static inline int64_t hist_highest_value(int index)
+{
+    int bucket = (index >> (NOVA_HIST_SUB_BITS - 1)) - 1;
+    int64_t sub = (index & (NOVA_HIST_HALF_COUNT - 1)) + NOVA_HIST_HALF_COUNT;
+
+    if (bucket < 0)
+    {
+        sub -= NOVA_HIST_HALF_COUNT;
+        bucket = 0;
+    }
+    return (sub << bucket) + ((int64_t)1 << bucket) - 1;
+}
+
+void nova_hist_record(nova_histogram *hist, int64_t value)
+{
+    if (value < 0)
+    {
+        value = 0;
+    }
+    else if (value > NOVA_HIST_MAX_VALUE)
+    {
+        value = NOVA_HIST_MAX_VALUE;
+    }
+
+    hist->counts[hist_index(value)]++;
+    hist->count++;
+    hist->sum += value;
+    if (value < hist->min)
+    {
+        hist->min = value;
+    }
+    if (value > hist->max)
+    {
+        hist->max = value;
+    }
+}
+
+int64_t nova_hist_percentile(const nova_histogram *hist, double p)
+{
+    uint64_t target, seen = 0;
+    int64_t value;
+    int i;
+
+    if (hist->count == 0)
+    {
+        return 0;
+    }
+
+    target = (uint64_t)(p / 100.0 * hist->count + 0.5);
+    if (target < 1)
+    {
+        target = 1;
+    }
+    else if (target > hist->count)
+    {
+        target = hist->count;
+    }
+
+    for (i = 0; i < NOVA_HIST_LEN; i++)
+    {
+        seen += hist->counts[i];
+        if (seen >= target)
+        {
+            value = hist_highest_value(i);
+            return value < hist->max ? value : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+void nova_hist_merge(nova_histogram *dst, const nova_histogram *src)
+{
+    int i;
+
+    for (i = 0; i < NOVA_HIST_LEN; i++)
+    {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->min < dst->min)
+    {
+        dst->min = src->min;
+    }
+    if (src->max > dst->max)
+    {
+        dst->max = src->max;
+    }
+}
+
+void nova_hist_print(const nova_histogram *hist, FILE *out)
+{
+    if (hist->count == 0)
+    {
+        fprintf(out, "latency(ms): no samples\n");
+        return;
+    }
+
+    fprintf(out, "latency(ms): min %.3f, mean %.3f, p50 %.3f, p90 %.3f, p99 %.3f, p99.9 %.3f, max %.3f\n",
+            hist->min / 1000.0,
+            hist->sum / hist->count / 1000.0,
+            nova_hist_percentile(hist, 50) / 1000.0,
+            nova_hist_percentile(hist, 90) / 1000.0,
+            nova_hist_percentile(hist, 99) / 1000.0,
+            nova_hist_percentile(hist, 99.9) / 1000.0,
+            hist->max / 1000.0);
+}
+
+static void write_varint(FILE *fp, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        fputc((int)(value & 0x7f) | 0x80, fp);
+        value >>= 7;
+    }
+    fputc((int)value, fp);
+}
+
+static int read_varint(FILE *fp, uint64_t *value)
+{
+    int c, shift = 0;
+
+    *value = 0;
+    while ((c = fgetc(fp)) != EOF)
+    {
+        if (shift > 63)
+        {
+            return SW_ERR;
+        }
+        *value |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80))
+        {
+            return SW_OK;
+        }
+        shift += 7;
+    }
+    return SW_ERR;
+}
+
+int nova_hist_save(const nova_histogram *hist, const char *path)
+{
+    FILE *fp;
+    int i, last = -1;
+    int ret;
+
+    fp = fopen(path, "wb");
+    if (fp == NULL)
+    {
+        perror("ERROR, fail to open histogram file");
+        return SW_ERR;
+    }
+
+    fwrite(HIST_MAGIC, 1, 4, fp);
+    write_varint(fp, NOVA_HIST_SUB_BITS);
+    write_varint(fp, hist->count);
+    write_varint(fp, hist->count ? (uint64_t)hist->min : 0);
+    write_varint(fp, (uint64_t)hist->max);
+    write_varint(fp, (uint64_t)(hist->sum + 0.5));
+    for (i = 0; i < NOVA_HIST_LEN; i++)
+    {
+        if (hist->counts[i])
+        {
+            write_varint(fp, (uint64_t)(i - last));
+            write_varint(fp, hist->counts[i]);
+            last = i;
+        }
+    }
+
+    ret = ferror(fp) ? SW_ERR : SW_OK;
+    if (fclose(fp) != 0)
+    {
+        ret = SW_ERR;
+    }
+    if (!ret)
+    {
+        fprintf(stderr, "ERROR, fail to write histogram file %s\n", path);
+    }
+    return ret;
+}
+
+int nova_hist_load(nova_histogram *hist, const char *path)
+{
+    nova_histogram *tmp;
+    FILE *fp;
+    char magic[4];
+    uint64_t bits, count, min, max, sum, gap, n, total = 0;
+    int64_t index = -1;
+    int ret = SW_ERR;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        perror("ERROR, fail to open histogram file");
+        return SW_ERR;
+    }
+
+    tmp = nova_hist_create();
+    if (tmp == NULL)
+    {
+        fclose(fp);
+        return SW_ERR;
+    }
+
+    if (fread(magic, 1, 4, fp) != 4 || memcmp(magic, HIST_MAGIC, 4) != 0 ||
+        !read_varint(fp, &bits) || bits != NOVA_HIST_SUB_BITS ||
+        !read_varint(fp, &count) || !read_varint(fp, &min) ||
+        !read_varint(fp, &max) || !read_varint(fp, &sum))
+    {
+        goto done;
+    }
+
+    while (read_varint(fp, &gap))
+    {
+        index += gap;
+        if (gap == 0 || index >= NOVA_HIST_LEN || !read_varint(fp, &n))
+        {
+            goto done;
+        }
+        tmp->counts[index] = n;
+        total += n;
+    }
+    if (total != count || !feof(fp))
+    {
+        goto done;
+    }
+
+    if (count)
+    {
+        tmp->count = count;
+        tmp->min = (int64_t)min;
+        tmp->max = (int64_t)max;
+        tmp->sum = (double)sum;
+        nova_hist_merge(hist, tmp);
+    }
+    ret = SW_OK;
+
+done:
+    if (!ret)
+    {
+        fprintf(stderr, "ERROR, invalid histogram file %s\n", path);
+    }
+    nova_hist_destroy(tmp);
+    fclose(fp);
+    return ret;
+}
@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "inflight.h"
+#include "binarydata.h"
+
+static inline uint32_t seq_hash(int64_t seq_no, uint32_t mask)
+{
+    uint64_t h = (uint64_t)seq_no * 0x9E3779B97F4A7C15ULL;
+    return (uint32_t)(h >> 32) & mask;
+}
+
+int nova_inflight_init(nova_inflight *table, uint32_t hint)
+{
+    uint32_t cap = 16;
+    while (cap < hint * 2)
+    {
+        cap <<= 1;
+    }
+    table->slots = calloc(cap, sizeof(nova_inflight_entry));
+    if (table->slots == NULL)
+    {
+        return SW_ERR;
+    }
+    table->mask = cap - 1;
+    table->size = 0;
+    return SW_OK;
+}
+
+void nova_inflight_free(nova_inflight *table)
+{
+    free(table->slots);
+    table->slots = NULL;
+    table->mask = 0;
+    table->size = 0;
+}
+
+static int inflight_grow(nova_inflight *table)
+{
+    nova_inflight old = *table;
+    uint32_t i;
+
+    if (!nova_inflight_init(table, (old.mask + 1)))
+    {
+        *table = old;
+        return SW_ERR;
+    }
+    for (i = 0; i <= old.mask; i++)
+    {
+        if (old.slots[i].data)
+        {
+            nova_inflight_put(table, old.slots[i].seq_no, old.slots[i].data);
+        }
+    }
+    free(old.slots);
+    return SW_OK;
+}
+
+int nova_inflight_put(nova_inflight *table, int64_t seq_no, void *data)
+{
+    uint32_t i;
+
+    /* keep load factor under 1/2 */
+    if ((table->size + 1) * 2 > table->mask + 1 && !inflight_grow(table))
+    {
+        return SW_ERR;
+    }
+
+    i = seq_hash(seq_no, table->mask);
+    while (table->slots[i].data)
+    {
+        if (table->slots[i].seq_no == seq_no)
+        {
+            return SW_ERR;
+        }
+        i = (i + 1) & table->mask;
+    }
+    table->slots[i].seq_no = seq_no;
+    table->slots[i].data = data;
+    table->size++;
+    return SW_OK;
+}
+
+void *nova_inflight_take(nova_inflight *table, int64_t seq_no)
+{
+    uint32_t i, j, home;
+    void *data;
+
+    if (table->size == 0)
+    {
+        return NULL;
+    }
+
+    i = seq_hash(seq_no, table->mask);
+    while (table->slots[i].data && table->slots[i].seq_no != seq_no)
+    {
+        i = (i + 1) & table->mask;
+    }
+    data = table->slots[i].data;
+    if (data == NULL)
+    {
+        return NULL;
+    }
+
+    /* backward shift deletion, no tombstones */
+    j = i;
+    for (;;)
+    {
+        j = (j + 1) & table->mask;
+        if (table->slots[j].data == NULL)
+        {
+            break;
+        }
+        home = seq_hash(table->slots[j].seq_no, table->mask);
+        /* move j into the hole at i unless its home lies cyclically in (i, j] */
+        if ((i <= j) ? (i < home && home <= j) : (i < home || home <= j))
+        {
+            continue;
+        }
+        table->slots[i] = table->slots[j];
+        i = j;
+    }
+    table->slots[i].data = NULL;
+    table->size--;
+    return data;
+}
@@ -0,0 +1,146 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "jsonarena.h"
+#include "cJSON.h"
+#include "nova.h"
+
+#define ARENA_ALIGN 8 /* cJSON stores nothing wider than a double or a pointer */
+
+/* one reserved address range per thread, made writable from the front as the scopes grow.
+   the range alone tells arena pointers from malloc ones, so a free costs a compare */
+typedef struct json_arena
+{
+    char *base;     /* NULL until a scope of the thread reserved it */
+    size_t reserve; /* size of the range, NOVA_JSON_ARENA_RESERVE unless that much address space was refused */
+    size_t committed;
+    size_t used;
+    int depth;
+} json_arena;
+
+static __thread json_arena arena;
+static pthread_once_t arena_hooked = PTHREAD_ONCE_INIT;
+
+static int arena_commit(size_t size)
+{
+    size_t committed = arena.committed ? arena.committed : NOVA_JSON_CHUNK;
+
+    // 已提交的部分翻倍增长, 大文档只需几次 mprotect
+    while (committed < size)
+    {
+        committed *= 2;
+    }
+    if (committed > arena.reserve)
+    {
+        committed = arena.reserve;
+    }
+    if (mprotect(arena.base + arena.committed, committed - arena.committed, PROT_READ | PROT_WRITE) != 0)
+    {
+        return SW_ERR;
+    }
+    arena.committed = committed;
+    return SW_OK;
+}
+
+static void *arena_malloc(size_t size)
+{
+    void *p;
+
+    // 没有保留到地址空间或者用完时照旧走malloc, arena_free 按地址把它们交给free
+    if (arena.depth == 0 || arena.base == NULL)
+    {
+        return malloc(size);
+    }
+
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (size > arena.reserve - arena.used ||
+        (arena.used + size > arena.committed && !arena_commit(arena.used + size)))
+    {
+        return malloc(size);
+    }
+    p = arena.base + arena.used;
+    arena.used += size;
+    return p;
+}
+
+static void arena_free(void *p)
+{
+    if (arena.base && (char *)p >= arena.base && (char *)p < arena.base + arena.reserve)
+    {
+        return;
+    }
+    free(p);
+}
+
+/* the outermost scope ended, keep the front pages for the next one */
+static void arena_trim()
+{
+    // 重新映射成不可访问, 物理页与提交额度一起还给内核
+    if (arena.committed > NOVA_JSON_ARENA_KEEP &&
+        mmap(arena.base + NOVA_JSON_ARENA_KEEP, arena.committed - NOVA_JSON_ARENA_KEEP, PROT_NONE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) != MAP_FAILED)
+    {
+        arena.committed = NOVA_JSON_ARENA_KEEP;
+    }
+    arena.used = 0;
+}
+
+static void arena_reserve()
+{
+    size_t reserve;
+    void *base;
+
+    for (reserve = NOVA_JSON_ARENA_RESERVE; reserve >= NOVA_JSON_CHUNK; reserve /= 2)
+    {
+        base = mmap(NULL, reserve, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (base != MAP_FAILED)
+        {
+            arena.base = base;
+            arena.reserve = reserve;
+            return;
+        }
+    }
+}
+
+static void arena_hook()
+{
+    cJSON_Hooks hooks = {arena_malloc, arena_free};
+    cJSON_InitHooks(&hooks);
+}
+
+nova_json_mark nova_json_arena_begin()
+{
+    nova_json_mark mark;
+
+    // 钩子全局只装一次, 作用域以外的线程照旧走malloc/free
+    pthread_once(&arena_hooked, arena_hook);
+
+    // 只占地址空间不占内存, ulimit -v 之类拒绝时减半再试, 一块都保留不到就由下个最外层作用域再试
+    if (arena.base == NULL && arena.depth == 0)
+    {
+        arena_reserve();
+    }
+
+    mark.used = arena.used;
+    mark.indexes = cJSON_IndexMark();
+    arena.depth++;
+    return mark;
+}
+
+void nova_json_arena_end(nova_json_mark mark)
+{
+    // 作用域里建的成员索引可能挂在作用域外的对象上, 内存收回前先摘掉
+    cJSON_DropIndexes(mark.indexes);
+    arena.depth--;
+    if (arena.depth == 0)
+    {
+        if (arena.base)
+        {
+            arena_trim();
+        }
+        return;
+    }
+    arena.used = mark.used;
+}
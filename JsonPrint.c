@@ -0,0 +1,562 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "jsonprint.h"
+#include "nova.h"
+#include "cJSON.h"
+
+/*
+ * one recursive descent serves both passes: with out NULL it only validates, otherwise the
+ * already validated text is written out. depth counts the enclosing objects and arrays like
+ * cJSON_Print does, though only object members are indented, arrays stay on one line
+ */
+
+typedef struct json_out
+{
+    FILE *fp;
+    size_t len;
+    char buf[NOVA_JSON_OUT_BUF];
+} json_out;
+
+static void out_flush(json_out *out)
+{
+    fwrite(out->buf, 1, out->len, out->fp);
+    out->len = 0;
+}
+
+static inline void out_write(json_out *out, const char *data, size_t len)
+{
+    if (len > sizeof(out->buf) - out->len)
+    {
+        out_flush(out);
+        if (len >= sizeof(out->buf))
+        {
+            fwrite(data, 1, len, out->fp);
+            return;
+        }
+    }
+    memcpy(out->buf + out->len, data, len);
+    out->len += len;
+}
+
+static inline void out_byte(json_out *out, char c)
+{
+    if (out->len == sizeof(out->buf))
+    {
+        out_flush(out);
+    }
+    out->buf[out->len++] = c;
+}
+
+static void out_tabs(json_out *out, size_t depth)
+{
+    static const char tabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+    size_t n;
+
+    while (depth > 0)
+    {
+        n = depth < sizeof(tabs) - 1 ? depth : sizeof(tabs) - 1;
+        out_write(out, tabs, n);
+        depth -= n;
+    }
+}
+
+/* cJSON treats every control byte and space as whitespace, the text ends at NUL */
+static inline const char *skip_ws(const char *p)
+{
+    while (*p && (unsigned char)*p <= 32)
+    {
+        p++;
+    }
+    return p;
+}
+
+/* invalid digits read as 0, like cJSON's parse_hex4 */
+static unsigned hex4(const char *p)
+{
+    unsigned h = 0, d;
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        if (p[i] >= '0' && p[i] <= '9')
+        {
+            d = p[i] - '0';
+        }
+        else if ((p[i] | 0x20) >= 'a' && (p[i] | 0x20) <= 'f')
+        {
+            d = (p[i] | 0x20) - 'a' + 10;
+        }
+        else
+        {
+            return 0;
+        }
+        h = h << 4 | d;
+    }
+    return h;
+}
+
+/* past the closing quote of the string at p, NULL when it is unterminated or has a bad escape */
+static const char *scan_string(const char *p)
+{
+    const char *end = p + 1, *s;
+    unsigned code;
+
+    /* find the closing quote first, escapes are checked only when there are any */
+    for (;;)
+    {
+        end += strcspn(end, "\"\\");
+        if (*end == '"')
+        {
+            break;
+        }
+        if (*end == 0 || end[1] == 0)
+        {
+            return NULL;
+        }
+        end += 2;
+    }
+
+    /* like cJSON an escape may run into the closing quote, which it then reads as \" */
+    s = p + 1;
+    while (s < end && (s = memchr(s, '\\', end - s)) != NULL)
+    {
+        switch (s[1])
+        {
+        case 'b':
+        case 'f':
+        case 'n':
+        case 'r':
+        case 't':
+        case '"':
+        case '\\':
+        case '/':
+            s += 2;
+            break;
+        case 'u':
+            if (end - s < 6)
+            {
+                return NULL;
+            }
+            code = hex4(s + 2);
+            if (code >= 0xDC00 && code <= 0xDFFF)
+            {
+                return NULL;
+            }
+            if (code >= 0xD800 && code <= 0xDBFF)
+            {
+                /* a high surrogate needs its low half */
+                if (end - s < 12 || s[6] != '\\' || s[7] != 'u')
+                {
+                    return NULL;
+                }
+                code = hex4(s + 8);
+                if (code < 0xDC00 || code > 0xDFFF)
+                {
+                    return NULL;
+                }
+                s += 6;
+            }
+            s += 6;
+            break;
+        default:
+            return NULL;
+        }
+    }
+    return end + 1;
+}
+
+/* a character cJSON_Print escapes, c is below 32, a quote or a backslash */
+static void out_escape(json_out *out, unsigned c)
+{
+    static const char hex[] = "0123456789abcdef";
+    char esc[6] = {'\\', 'u', '0', '0'};
+
+    switch (c)
+    {
+    case '"':
+    case '\\':
+        esc[1] = (char)c;
+        break;
+    case '\b':
+        esc[1] = 'b';
+        break;
+    case '\f':
+        esc[1] = 'f';
+        break;
+    case '\n':
+        esc[1] = 'n';
+        break;
+    case '\r':
+        esc[1] = 'r';
+        break;
+    case '\t':
+        esc[1] = 't';
+        break;
+    default:
+        esc[4] = hex[c >> 4];
+        esc[5] = hex[c & 15];
+        out_write(out, esc, 6);
+        return;
+    }
+    out_write(out, esc, 2);
+}
+
+static void out_utf8(json_out *out, unsigned code)
+{
+    char utf8[4];
+    int n;
+
+    if (code < 0x80)
+    {
+        utf8[0] = (char)code;
+        n = 1;
+    }
+    else if (code < 0x800)
+    {
+        utf8[0] = (char)(0xC0 | code >> 6);
+        n = 2;
+    }
+    else if (code < 0x10000)
+    {
+        utf8[0] = (char)(0xE0 | code >> 12);
+        n = 3;
+    }
+    else
+    {
+        utf8[0] = (char)(0xF0 | code >> 18);
+        n = 4;
+    }
+    switch (n)
+    {
+    case 4:
+        utf8[n - 3] = (char)(0x80 | ((code >> 12) & 0x3F));
+        /* fall through */
+    case 3:
+        utf8[n - 2] = (char)(0x80 | ((code >> 6) & 0x3F));
+        /* fall through */
+    case 2:
+        utf8[n - 1] = (char)(0x80 | (code & 0x3F));
+    }
+    out_write(out, utf8, n);
+}
+
+/*
+ * the scanned string p..end as cJSON_Print writes what cJSON_Parse read from it: \/ and \u escapes
+ * become UTF-8, control characters are escaped and a \u0000 ends the text like the NUL it decodes to
+ */
+static void out_string(json_out *out, const char *p, const char *end)
+{
+    const char *s = p + 1, *run = s;
+    unsigned code;
+
+    end--;
+    out_byte(out, '"');
+    while (s < end)
+    {
+        if ((unsigned char)*s >= 32 && *s != '\\')
+        {
+            s++;
+            continue;
+        }
+        out_write(out, run, s - run);
+        if (*s != '\\')
+        {
+            out_escape(out, (unsigned char)*s++);
+        }
+        else if (s[1] == 'u')
+        {
+            code = hex4(s + 2);
+            s += 6;
+            if (code >= 0xD800 && code <= 0xDBFF)
+            {
+                code = 0x10000 + ((code & 0x3FF) << 10 | (hex4(s + 2) & 0x3FF));
+                s += 6;
+            }
+            if (code == 0)
+            {
+                run = s = end;
+                break;
+            }
+            if (code < 32 || code == '"' || code == '\\')
+            {
+                out_escape(out, code);
+            }
+            else
+            {
+                out_utf8(out, code);
+            }
+        }
+        else if (s[1] == '/')
+        {
+            out_byte(out, '/');
+            s += 2;
+        }
+        else
+        {
+            /* \b \f \n \r \t \" and \\ come out as they went in */
+            out_write(out, s, 2);
+            s += 2;
+        }
+        run = s;
+    }
+    out_write(out, run, s - run);
+    out_byte(out, '"');
+}
+
+static inline const char *skip_digits(const char *p)
+{
+    while (*p >= '0' && *p <= '9')
+    {
+        p++;
+    }
+    return p;
+}
+
+/* the longest prefix strtod would take, it starts with '-' or a digit */
+static const char *scan_number(const char *p)
+{
+    const char *int_end, *frac_end, *exp;
+
+    if (*p == '-')
+    {
+        p++;
+    }
+    int_end = skip_digits(p);
+    frac_end = int_end;
+    if (*int_end == '.')
+    {
+        frac_end = skip_digits(int_end + 1);
+    }
+    if (int_end == p && frac_end <= int_end + 1)
+    {
+        return NULL;
+    }
+
+    p = frac_end;
+    if (*p == 'e' || *p == 'E')
+    {
+        exp = p + 1;
+        if (*exp == '+' || *exp == '-')
+        {
+            exp++;
+        }
+        if (*exp >= '0' && *exp <= '9')
+        {
+            p = skip_digits(exp);
+        }
+    }
+    return p;
+}
+
+static const char *json_value(json_out *out, const char *p, size_t depth, int nest);
+
+static int match_name(const char *key, size_t key_len, const char *name)
+{
+    return strlen(name) == key_len && strncasecmp(key, name, key_len) == 0;
+}
+
+static const char *json_object(json_out *out, const char *p, size_t depth, int nest,
+                               const char **names, const char **values, int n)
+{
+    const char *end, *key;
+    size_t key_len;
+    int i;
+
+    if (nest >= CJSON_NESTING_LIMIT)
+    {
+        return NULL;
+    }
+    if (out)
+    {
+        out_write(out, "{\n", 2);
+    }
+
+    p = skip_ws(p + 1);
+    if (*p == '}')
+    {
+        if (out)
+        {
+            out_tabs(out, depth);
+            out_byte(out, '}');
+        }
+        return p + 1;
+    }
+
+    for (;;)
+    {
+        if (*p != '"' || (end = scan_string(p)) == NULL)
+        {
+            return NULL;
+        }
+        if (out)
+        {
+            out_tabs(out, depth + 1);
+            out_string(out, p, end);
+            out_write(out, ":\t", 2);
+        }
+        key = p + 1;
+        key_len = end - p - 2;
+
+        p = skip_ws(end);
+        if (*p != ':')
+        {
+            return NULL;
+        }
+        p = skip_ws(p + 1);
+        for (i = 0; i < n; i++)
+        {
+            if (values[i] == NULL && match_name(key, key_len, names[i]))
+            {
+                values[i] = p;
+            }
+        }
+        p = json_value(out, p, depth + 1, nest + 1);
+        if (p == NULL)
+        {
+            return NULL;
+        }
+
+        p = skip_ws(p);
+        if (*p == ',')
+        {
+            if (out)
+            {
+                out_write(out, ",\n", 2);
+            }
+            p = skip_ws(p + 1);
+        }
+        else if (*p == '}')
+        {
+            if (out)
+            {
+                out_byte(out, '\n');
+                out_tabs(out, depth);
+                out_byte(out, '}');
+            }
+            return p + 1;
+        }
+        else
+        {
+            return NULL;
+        }
+    }
+}
+
+static const char *json_array(json_out *out, const char *p, size_t depth, int nest)
+{
+    if (nest >= CJSON_NESTING_LIMIT)
+    {
+        return NULL;
+    }
+    if (out)
+    {
+        out_byte(out, '[');
+    }
+
+    p = skip_ws(p + 1);
+    if (*p == ']')
+    {
+        if (out)
+        {
+            out_byte(out, ']');
+        }
+        return p + 1;
+    }
+
+    for (;;)
+    {
+        p = json_value(out, p, depth + 1, nest + 1);
+        if (p == NULL)
+        {
+            return NULL;
+        }
+
+        p = skip_ws(p);
+        if (*p == ',')
+        {
+            if (out)
+            {
+                out_write(out, ", ", 2);
+            }
+            p = skip_ws(p + 1);
+        }
+        else if (*p == ']')
+        {
+            if (out)
+            {
+                out_byte(out, ']');
+            }
+            return p + 1;
+        }
+        else
+        {
+            return NULL;
+        }
+    }
+}
+
+/* p is past any whitespace */
+static const char *json_value(json_out *out, const char *p, size_t depth, int nest)
+{
+    const char *end;
+
+    switch (*p)
+    {
+    case '{':
+        return json_object(out, p, depth, nest, NULL, NULL, 0);
+    case '[':
+        return json_array(out, p, depth, nest);
+    case '"':
+        end = scan_string(p);
+        break;
+    case 'n':
+        end = strncmp(p, "null", 4) == 0 ? p + 4 : NULL;
+        break;
+    case 't':
+        end = strncmp(p, "true", 4) == 0 ? p + 4 : NULL;
+        break;
+    case 'f':
+        end = strncmp(p, "false", 5) == 0 ? p + 5 : NULL;
+        break;
+    default:
+        end = *p == '-' || (*p >= '0' && *p <= '9') ? scan_number(p) : NULL;
+        break;
+    }
+
+    if (end && out)
+    {
+        if (*p == '"')
+        {
+            out_string(out, p, end);
+        }
+        else
+        {
+            out_write(out, p, end - p);
+        }
+    }
+    return end;
+}
+
+int nova_json_members(const char *json, const char **names, const char **values, int n)
+{
+    const char *p = skip_ws(json);
+
+    memset(values, 0, n * sizeof(values[0]));
+    if (*p != '{')
+    {
+        return SW_ERR;
+    }
+    return json_object(NULL, p, 0, 0, names, values, n) != NULL;
+}
+
+void nova_json_print(FILE *fp, const char *value)
+{
+    static json_out out;
+
+    out.fp = fp;
+    out.len = 0;
+    json_value(&out, skip_ws(value), 0, 0);
+    out_flush(&out);
+}
@@ -63,118 +63,123 @@ int swNova_IsNovaPack(const char* data, int nLen)
     return SW_OK;
 }
 
-int swNova_unpack(char* data, int length, swNova_Header* header)
+static inline int view_string(const char *data, int end, int *off, const char **str, int32_t *len)
 {
-    if (length <= NOVA_HEADER_COMMON_LEN) {
-        swWarn("length is less than nova header common length. length=%d", length);
-        return SW_ERR;
-    }
-    int off = 0;
-    //read msg length
-    if(swReadI32((const uchar *)data + off, &(header->msg_size)) != SW_OK)
+    if (end - *off < 4)
     {
-        swWarn("read msg length error.");
         return SW_ERR;
     }
-    off += 4;
-    
-    //判断msg_size是否异常
-    if(header->msg_size <= NOVA_HEADER_COMMON_LEN) {
-        swWarn("msg size is less than nova header common length. msg_size=%d", header->msg_size);
-        return SW_ERR;
-    }
-    
-    //read magic
-    
-    if(swReadU16((const uchar *)data + off, &(header->magic)) != SW_OK)
+    swReadI32((const uchar *)data + *off, len);
+    *off += 4;
+    if (*len < 0 || *len > end - *off)
     {
-        swWarn("read magic error");
         return SW_ERR;
     }
-    
-    off += 2;
-    //判断magic是否合法
-    if(header->magic != NOVA_MAGIC)
-    {
-        swWarn("magic error. magic=%x", header->magic);
-        return SW_ERR;
-    }
-    
-    //read header size
-    if(swReadI16((const uchar *)data + off, &(header->head_size)) != SW_OK)
-    {
-        swWarn("read header size error");
+    *str = data + *off;
+    *off += *len;
+    return SW_OK;
+}
+
+/* the header alone, data holds at least head_size bytes but maybe not the body */
+SW_INLINE int unpack_head_view(const char* data, int length, swNova_HeaderView* view)
+{
+    int off = 0;
+
+    if (length < NOVA_HEADER_COMMON_LEN || !data) {
         return SW_ERR;
     }
+
+    swReadI32((const uchar *)data + off, &view->msg_size);
+    off += 4;
+    swReadU16((const uchar *)data + off, &view->magic);
     off += 2;
-    
-    //判断header size是否合法
-    if (header->head_size > header->msg_size) {
-        swWarn("header size is inval invalid. msg_size=%d, header_size=%d", header->msg_size, header->msg_size);
-        return SW_ERR;
-    }
-    
-    //read version
-    if(swReadByte((const uchar *)data + off, (char *)&(header->version)) != SW_OK)
+    swReadI16((const uchar *)data + off, &view->head_size);
+    off += 2;
+    if (view->magic != NOVA_MAGIC || view->head_size > length
+        || view->head_size < NOVA_HEADER_COMMON_LEN || view->head_size > view->msg_size)
     {
-        swWarn("read version error");
         return SW_ERR;
     }
+
+    //everything below is bounded by head_size
+    view->version = (int8_t)data[off];
     off += 1;
-    //read ip
-    if(swReadU32((const uchar *)data + off, &(header->ip)) != SW_OK)
+    swReadU32((const uchar *)data + off, &view->ip);
+    off += 4;
+    swReadU32((const uchar *)data + off, &view->port);
+    off += 4;
+
+    if (view_string(data, view->head_size, &off, &view->service_name, &view->service_len) != SW_OK
+        || view_string(data, view->head_size, &off, &view->method_name, &view->method_len) != SW_OK
+        || view->head_size - off < 8)
     {
-        swWarn("read ip error");
         return SW_ERR;
     }
-    off += 4;
-    //read port
-    if(swReadU32((const uchar *)data + off, &(header->port)) != SW_OK)
+    swReadI64((const uchar *)data + off, &view->seq_no);
+    off += 8;
+
+    if (view_string(data, view->head_size, &off, &view->attach, &view->attach_len) != SW_OK)
     {
-        swWarn("read port error");
         return SW_ERR;
     }
+    return SW_OK;
+}
 
-    off += 4;
-    //read service name
-    if(swReadString((const uchar *)data + off, length - off, &(header->service_name), &(header->service_len)) != SW_OK)
+int swNova_unpack_view(const char* data, int length, swNova_HeaderView* view)
+{
+    if (unpack_head_view(data, length, view) != SW_OK || view->msg_size > length)
     {
-        swWarn("read service name error");
         return SW_ERR;
     }
-    off += 4;
-    off += header->service_len;
-    CHECK_PACK
-    
-    //read method name
-    if(swReadString((const uchar *)data + off, length - off, &(header->method_name), &(header->method_len)) != SW_OK)
+    return SW_OK;
+}
+
+/* NUL terminated copy replacing *dst */
+static int copy_string(char **dst, const char *src, int32_t len)
+{
+    char *str = sw_malloc(len + 1);
+    if (str == NULL)
     {
-        swWarn("read method name error");
         return SW_ERR;
     }
-    off += 4;
-    off += header->method_len;
-    CHECK_PACK
-    
-    //read seq no
-    if(swReadI64((const uchar *)data + off, &(header->seq_no)) != SW_OK)
+    memcpy(str, src, len);
+    str[len] = 0;
+    if (*dst != NULL)
     {
-        swWarn("read seq no error");
+        sw_free(*dst);
+    }
+    *dst = str;
+    return SW_OK;
+}
+
+int swNova_unpack(char* data, int length, swNova_Header* header)
+{
+    swNova_HeaderView view;
+
+    //所有读取都先经过视图解析的边界检查, 之后才拷贝
+    if (unpack_head_view(data, length, &view) != SW_OK)
+    {
+        swWarn("invalid nova header. length=%d", length);
         return SW_ERR;
     }
-    off += 8;
-    CHECK_PACK
-    
-    //read attach
-    if(swReadString((const uchar *)data + off, length - off, &(header->attach), &(header->attach_len)) != SW_OK)
+
+    header->msg_size = view.msg_size;
+    header->magic = view.magic;
+    header->head_size = view.head_size;
+    header->version = view.version;
+    header->ip = view.ip;
+    header->port = view.port;
+    header->seq_no = view.seq_no;
+    header->service_len = view.service_len;
+    header->method_len = view.method_len;
+    header->attach_len = view.attach_len;
+    if (copy_string(&header->service_name, view.service_name, view.service_len) != SW_OK
+        || copy_string(&header->method_name, view.method_name, view.method_len) != SW_OK
+        || copy_string(&header->attach, view.attach, view.attach_len) != SW_OK)
     {
-        swWarn("read attachment error");
+        swWarn("malloc failed");
         return SW_ERR;
     }
-    off += 4;
-    off += header->attach_len;
-    CHECK_PACK
-    
     return SW_OK;
 }
 
@@ -286,3 +291,34 @@ int swNova_pack(swNova_Header* header, char* body, int body_len, char **data, in
     *data = pTmp;
     return SW_OK;
 }
+
+int swNova_pack_head(swNova_Header* header, int body_len, char *data)
+{
+    int off = 0;
+
+    swWriteI32((uchar *)data+off, header->head_size + body_len);
+    off += 4;
+    swWriteI16((uchar *)data+off, header->magic);
+    off += 2;
+    swWriteI16((uchar *)data+off, header->head_size);
+    off += 2;
+    swWriteByte((uchar *)data+off, header->version);
+    off += 1;
+    swWriteU32((uchar *)data+off, header->ip);
+    off += 4;
+    swWriteU32((uchar *)data+off, header->port);
+    off += 4;
+    swWriteString((uchar *)data+off, header->service_name, header->service_len);
+    off += 4;
+    off += header->service_len;
+    swWriteString((uchar *)data+off, header->method_name, header->method_len);
+    off += 4;
+    off += header->method_len;
+    swWriteI64((uchar *)data+off, header->seq_no);
+    off += 8;
+    //only the attachment length, the bytes follow as their own slice
+    swWriteI32((uchar *)data+off, header->attach_len);
+    off += 4;
+
+    return off;
+}
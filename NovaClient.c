@@ -3,29 +3,37 @@
 #include <unistd.h>
 #include <stddef.h>
 #include <string.h>
-#include <sys/socket.h>
-#include <arpa/inet.h>
-#include <netdb.h>
-#include <errno.h>
+#include <sys/time.h>
 #include <ctype.h>
 
 #include "cJSON.h"
-#include "thriftgeneric.h"
-#include "nova.h"
-#include "binarydata.h"
-
-#define RECV_BUF_SIZE 8192
+#include "client.h"
+#include "engine.h"
+#include "batch.h"
+#include "bench.h"
+#include "histogram.h"
+#include "jsonprint.h"
 
 static const char *usage =
     "\nUsage:\n"
-    "   nova -h<HOST> -p<PORT> -m<METHOD> -a<JSON_ARGUMENTS> [-e<JSON_ATTACHMENT='{}'> -t<TIMEOUT_SEC=5>]\n"
-    "   nova -h<HOST> -p<PORT> -s [-t<TIMEOUT_SEC=5>] doc: https://github.com/youzan/zan/issues/18 \n\n"
+    "   nova -h<HOST> -p<PORT> -m<METHOD> -a<JSON_ARGUMENTS> [-e<JSON_ATTACHMENT='{}'> -t<TIMEOUT_SEC=5> -S<SCHEMA_JSON> -P<binary|compact> -z]\n"
+    "   nova -h<HOST> -p<PORT> -s [-t<TIMEOUT_SEC=5>] doc: https://github.com/youzan/zan/issues/18 \n"
+    "   nova -h<HOST> -p<PORT> -f<JSONL_FILE|-> [-c<CONCURRENCY=16> -u -t<TIMEOUT_SEC=5>]\n"
+    "   nova -h<HOST> -p<PORT> -m<METHOD> -a<JSON_ARGUMENTS> -n<REQUESTS>|-d<DURATION_SEC> [-c<CONCURRENCY=16> -r<QPS> -u -t<TIMEOUT_SEC=5> -H<HIST_FILE>]\n"
+    "   nova -M <HIST_FILE>...\n\n"
     "Example:\n"
     "   nova -h127.0.0.1 -p8050 -s\n"
     "   nova -h127.0.0.1 -p8050 -m=com.youzan.material.general.service.TokenService.getToken -a='{\"xxxId\":1,\"scope\":\"\"}'\n"
     "   nova -h127.0.0.1 -p8050 -m=com.youzan.material.general.service.TokenService.getToken -a='{\"xxxId\":1,\"scope\":\"\"}' -e='{\"xxxId\":1}'\n"
     "   nova -h127.0.0.1 -p8050 -m=com.youzan.material.general.service.MediaService.getMediaList -a='{\"query\":{\"categoryId\":2,\"xxxId\":1,\"pageNo\":1,\"pageSize\":5}}'\n"
-    "   nova -hqabb-dev-scrm-test0 -p8100 -mcom.youzan.scrm.customer.service.customerService.getByYzUid -a '{\"xxxId\":1, \"yzUid\": 1}'\n";
+    "   nova -hqabb-dev-scrm-test0 -p8100 -mcom.youzan.scrm.customer.service.customerService.getByYzUid -a '{\"xxxId\":1, \"yzUid\": 1}'\n"
+    "   nova -h127.0.0.1 -p8050 -m=com.youzan.material.general.service.MediaService.getMediaList -a='{\"query\":{\"categoryId\":2}}' -S/tmp/media.json\n"
+    "   nova -h127.0.0.1 -p8050 -s -Pcompact\n"
+    "   nova -h127.0.0.1 -p8050 -m=com.youzan.material.general.service.MediaService.getMediaList -a='{\"query\":{\"categoryId\":2,\"pageSize\":500}}' -z\n"
+    "   nova -h127.0.0.1 -p8050 -s -n100000 -c64\n"
+    "   nova -h127.0.0.1 -p8050 -s -d30 -r5000 -c256 -H/tmp/run1.hist\n"
+    "   nova -M /tmp/run1.hist /tmp/run2.hist\n"
+    "   echo '{\"method\":\"com.youzan.service.test.stats\",\"args\":{}}' | nova -h127.0.0.1 -p8050 -f- -c64\n";
 
 struct globalArgs_t
 {
@@ -37,9 +45,22 @@ struct globalArgs_t
     const char *args;   /* JSON */
     const char *attach; /* JSON */
     struct timeval timeout;
+    const char *batch; /* JSONL file, "-" for stdin */
+    int concurrency;
+    int backend;
+    long requests; /* bench */
+    int duration;
+    int rate;
+    const char *hist; /* save bench latency histogram */
+    int merge;        /* merge histogram files given as arguments */
+    const char *schema; /* typed calls, see thriftschema.h */
+    int protocol;       /* THRIFT_BINARY or THRIFT_COMPACT */
+    int compress;       /* lz4 generic payloads, see compress.h */
 } globalArgs;
 
-static const char *optString = "h:p:m:a:e:t:?s!";
+static thrift_schema *schema;
+
+static const char *optString = "h:p:m:a:e:t:f:c:un:d:r:H:MS:P:z?s!";
 
 #define INVALID_OPT(reason, ...)                                     \
     fprintf(stderr, "\x1B[1;31m" reason "\x1B[0m\n", ##__VA_ARGS__); \
@@ -50,39 +71,6 @@ static void display_usage()
     exit(1);
 }
 
-static void error(char *msg)
-{
-    perror(msg);
-    exit(1);
-}
-
-static void printbin(const char *bin, int size)
-{
-    char c = '*';
-    int count = 100;
-    int i;
-    for (i = 0; i < count; i++)
-        putchar(c);
-    puts("");
-    fwrite(bin, sizeof(char), size, stdout);
-    puts("");
-    for (i = 0; i < count; i++)
-        putchar(c);
-    puts("");
-}
-
-#define DUMP_STRUCT(sp) bin2hex((const char *)(sp), sizeof(*(sp)))
-#define DUMP_MEM(vp, n) bin2hex((const char *)(vp), (size_t)(n))
-static void bin2hex(const char *vp, size_t n)
-{
-    size_t i;
-    for (i = 0; i < n; i++)
-    {
-        printf("%02x", (unsigned char)vp[i]);
-    }
-    putchar('\n');
-}
-
 // remove prefix = sapce and remove suffix space
 static char *trim_opt(char *opt)
 {
@@ -109,277 +97,197 @@ static char *trim_opt(char *opt)
     return opt;
 }
 
-static int socket_connect(const char *host, int port)
+static void print_resp(nova_resp *resp)
 {
-    int sockfd;
-    struct sockaddr_in sin = {0};
-    struct hostent *host_entry;
-    struct in_addr addr;
-
-    sin.sin_family = AF_INET;
-    sin.sin_port = htons((unsigned short int)port);
-
-    if (inet_aton(host, &addr))
-    {
-        sin.sin_addr.s_addr = addr.s_addr;
-    }
-    else
+    // print json attach
+    if (resp->attach && strcmp(resp->attach, "{}") != 0)
     {
-        host_entry = gethostbyname(host);
-        if (!host_entry)
+        cJSON *root = cJSON_Parse(resp->attach);
+        if (root)
         {
-            fprintf(stderr, "ERROR, no such host as %s\n", host);
-            exit(1);
+            char *out = cJSON_PrintUnformatted(root);
+            printf("Nova Attachment: %s\n", out);
+            cJSON_free(out);
+            cJSON_Delete(root);
         }
-        memcpy(&(sin.sin_addr.s_addr), host_entry->h_addr_list[0], host_entry->h_length);
     }
 
-    sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sockfd < 0)
+    // print json resp, tokenized in place rather than parsed into a tree and printed into a copy
     {
-        perror("ERROR opening socket");
-        exit(1);
-    }
+        static const char *names[] = {"error_response", "exception", "response"};
+        const char *values[3];
 
-    if (connect(sockfd, (struct sockaddr *)&sin, sizeof(struct sockaddr_in)) < 0)
-    {
-        perror("ERROR connecting");
-        exit(1);
+        if (!nova_json_members(resp->json, names, values, 3))
+        {
+            fprintf(stderr, "\x1B[1;31m"
+                            "Invalid JSON Response"
+                            "\x1B[0m\n");
+            printf("%s", resp->json);
+        }
+        else if (values[0] || values[1])
+        {
+            fputs("\x1B[1;31m", stdout);
+            nova_json_print(stdout, values[0] ? values[0] : values[1]);
+            fputs("\x1B[0m\n", stdout);
+        }
+        else if (values[2])
+        {
+            fputs("\x1B[1;32m", stdout);
+            nova_json_print(stdout, values[2]);
+            fputs("\x1B[0m\n", stdout);
+        }
+        else
+        {
+            nova_json_print(stdout, resp->json);
+            fputs("\n", stdout);
+        }
     }
-
-    return sockfd;
 }
 
-static void nova_invoke()
+static nova_client *nova_open()
 {
-    int sockfd;
-
-    swNova_Header *nova_hdr;
-    char *thrift_buf;
-
-    char *nova_buf;
-    ssize_t send_n;
-    int32_t nova_pkt_len;
-
-    char *recv_buf;
-    ssize_t recv_msg_size;
-    int recv_n;
-    int recv_left;
-
-    char *resp_json;
-
-    char *tmp_buf;
-
-    int buf_len = thrift_generic_pack(0,
-                                      globalArgs.service, strlen(globalArgs.service),
-                                      globalArgs.method, strlen(globalArgs.method),
-                                      globalArgs.args, strlen(globalArgs.args), &thrift_buf);
-
-    if (buf_len == 0)
+    nova_client *cli = nova_client_create(globalArgs.host, globalArgs.port, globalArgs.timeout);
+    if (cli == NULL)
     {
-        fprintf(stderr, "ERROR, fail to pack thrift\n");
-        exit(1);
+        fprintf(stderr, "ERROR, fail to create nova client\n");
+        return NULL;
     }
-
-    nova_hdr = createNovaHeader();
-    if (nova_hdr == NULL)
+    cli->debug = globalArgs.debug;
+    cli->schema = schema;
+    cli->protocol = globalArgs.protocol;
+    if (globalArgs.compress)
     {
-        fprintf(stderr, "ERROR, fail to create nova header\n");
-        exit(1);
+        cli->compress.codec = NOVA_COMPRESS_LZ4;
     }
+    return cli;
+}
 
-    nova_hdr->magic = NOVA_MAGIC;
-    nova_hdr->version = 1;
-    nova_hdr->ip = 0;
-    nova_hdr->port = 0;
+static int nova_invoke()
+{
+    int ret;
+    nova_resp resp;
+    nova_client *cli;
 
-    nova_hdr->service_len = GENERIC_SERVICE_LEN;
-    nova_hdr->method_len = GENERIC_METHOD_LEN;
-    nova_hdr->attach_len = strlen(globalArgs.attach);
-    int headLen = NOVA_HEADER_COMMON_LEN + nova_hdr->service_len + nova_hdr->method_len + nova_hdr->attach_len;
-    if (headLen > 0x7fff)
+    cli = nova_open();
+    if (cli == NULL)
     {
-        fprintf(stderr, "ERROR, too large nova header as %d\n", headLen);
-        exit(1);
+        return 1;
     }
-    nova_hdr->head_size = (int16_t)headLen;
-    nova_hdr->service_name = malloc(nova_hdr->service_len + 1);
-    memcpy(nova_hdr->service_name, GENERIC_SERVICE, nova_hdr->service_len);
-    nova_hdr->service_name[nova_hdr->service_len] = 0;
-
-    nova_hdr->method_name = malloc(nova_hdr->method_len + 1);
-    memcpy(nova_hdr->method_name, GENERIC_METHOD, nova_hdr->method_len);
-    nova_hdr->method_name[nova_hdr->method_len] = 0;
-    nova_hdr->seq_no = 1;
-
-    nova_hdr->attach = malloc(nova_hdr->attach_len + 1);
-    memcpy(nova_hdr->attach, globalArgs.attach, nova_hdr->attach_len);
-    nova_hdr->attach[nova_hdr->attach_len] = 0;
-
-    nova_buf = NULL;
-    if (!swNova_pack(nova_hdr, thrift_buf, buf_len, &nova_buf, &nova_pkt_len))
+
+    ret = nova_client_invoke(cli, globalArgs.service, globalArgs.method, globalArgs.args, globalArgs.attach, &resp);
+    if (ret)
     {
-        fprintf(stderr, "ERROR, fail to pack nova\n");
-        exit(1);
+        print_resp(&resp);
+        /* a TApplicationException is printed like any error, but the call failed */
+        ret = !resp.exception;
+        nova_resp_free(&resp);
     }
 
-    sockfd = socket_connect(globalArgs.host, globalArgs.port);
+    nova_client_destroy(cli);
+    return ret ? 0 : 1;
+}
 
-    if (globalArgs.debug)
-    {
-        puts("sending...");
-        DUMP_MEM(nova_buf, nova_pkt_len);
-    }
+static int nova_bench()
+{
+    int ret;
+    nova_client *cli;
+    nova_bench_opts opts;
 
-    setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, (const char *)&globalArgs.timeout, sizeof(struct timeval));
-    tmp_buf = nova_buf;
-    while (nova_pkt_len > 0)
+    cli = nova_open();
+    if (cli == NULL)
     {
-        send_n = send(sockfd, tmp_buf, nova_pkt_len, 0);
-        if (send_n < 0)
-        {
-            if (errno == EINTR)
-            {
-                continue;
-            }
-            error("ERROR sending");
-        }
-        tmp_buf += send_n;
-        nova_pkt_len -= send_n;
+        return 1;
     }
 
-    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&globalArgs.timeout, sizeof(struct timeval));
-    recv_buf = (char *)malloc(RECV_BUF_SIZE);
-    tmp_buf = recv_buf;
+    opts.concurrency = globalArgs.concurrency;
+    opts.requests = globalArgs.requests;
+    opts.duration = globalArgs.duration;
+    opts.rate = globalArgs.rate;
+    opts.backend = globalArgs.backend;
+    opts.hist_path = globalArgs.hist;
+    ret = nova_bench_run(cli, globalArgs.service, globalArgs.method, globalArgs.args, globalArgs.attach, &opts, stdout);
 
-    recv_n = recv(sockfd, recv_buf, RECV_BUF_SIZE, 0);
-    if (recv_n < 4)
-    {
-        error("ERROR receiving");
-    }
+    nova_client_destroy(cli);
+    return ret ? 0 : 1;
+}
 
-    recv_msg_size = 0; /* !!!!! */
-    swReadI32((const uchar *)recv_buf, (int32_t *)&recv_msg_size);
-    if (recv_msg_size <= 0)
+static int nova_merge(int argc, char **argv)
+{
+    nova_histogram *hist;
+    int ret = 0;
+    int i;
+
+    if (argc == 0)
     {
-        fprintf(stderr, "ERROR: Invalid nova packet size %zd\n", recv_msg_size);
-        printbin(recv_buf, 300);
-        exit(1);
+        INVALID_OPT("Missing Histogram Files");
     }
-    if (recv_msg_size > RECV_BUF_SIZE)
+
+    hist = nova_hist_create();
+    if (hist == NULL)
     {
-        fprintf(stderr, "ERROR: too large nova packet size %zd\n", recv_msg_size);
-        printbin(recv_buf, 300);
-        exit(1);
+        return 1;
     }
-
-    recv_left = recv_msg_size - recv_n;
-    tmp_buf += recv_n;
-    while (recv_left > 0)
+    for (i = 0; i < argc; i++)
     {
-        recv_n = recv(sockfd, tmp_buf, RECV_BUF_SIZE, 0);
-        if (recv_n < 0)
+        if (!nova_hist_load(hist, argv[i]))
         {
-            if (errno == EINTR)
-            {
-                continue;
-            }
-            error("ERROR receiving");
+            ret = 1;
         }
-        tmp_buf += recv_n;
-        recv_left -= recv_n;
     }
 
-    if (globalArgs.debug)
-    {
-        DUMP_MEM(recv_buf, recv_msg_size);
-        printbin(recv_buf, recv_msg_size);
-    }
+    printf("requests: %llu\n", (unsigned long long)hist->count);
+    nova_hist_print(hist, stdout);
+    nova_hist_destroy(hist);
+    return ret;
+}
 
-    if (!swNova_IsNovaPack(recv_buf, recv_msg_size))
-    {
-        fprintf(stderr, "ERROR, invalid nova packet\n");
-        printbin(recv_buf, recv_msg_size);
-        exit(1);
-    }
-    if (!swNova_unpack(recv_buf, recv_msg_size, nova_hdr))
+static int nova_batch()
+{
+    int ret;
+    FILE *in;
+    nova_client *cli;
+
+    if (strcmp(globalArgs.batch, "-") == 0)
     {
-        deleteNovaHeader(nova_hdr);
-        fprintf(stderr, "ERROR, fail to unpcak nova packet header\n");
-        printbin(recv_buf, recv_msg_size);
-        exit(1);
+        in = stdin;
     }
-
-    if (!thrift_generic_unpack(recv_buf + nova_hdr->head_size, nova_hdr->msg_size - nova_hdr->head_size, &resp_json))
+    else if ((in = fopen(globalArgs.batch, "r")) == NULL)
     {
-        fprintf(stderr, "ERROR, fail to unpack thrift packet\n");
-        printbin(recv_buf, recv_msg_size);
-        exit(1);
+        perror("ERROR, fail to open batch file");
+        return 1;
     }
 
-    // print json attach
+    cli = nova_open();
+    if (cli == NULL)
     {
-        nova_hdr->attach[nova_hdr->attach_len] = 0;
-        if (strcmp(nova_hdr->attach, "{}") != 0)
+        if (in != stdin)
         {
-            cJSON *root = cJSON_Parse(nova_hdr->attach);
-            if (root)
-            {
-                printf("Nova Attachment: %s\n", cJSON_PrintUnformatted(root));
-                cJSON_Delete(root);
-            }
+            fclose(in);
         }
+        return 1;
     }
 
-    // print json resp
-    {
-        cJSON *resp;
-        cJSON *root = cJSON_Parse(resp_json);
-        if (root == NULL || !cJSON_IsObject(root))
-        {
-            fprintf(stderr, "\x1B[1;31m"
-                            "Invalid JSON Response"
-                            "\x1B[0m\n");
-            printf("%s", resp_json);
-            goto fail;
-        }
-        else if ((resp = cJSON_GetObjectItem(root, "error_response")))
-        {
-            printf("\x1B[1;31m%s\x1B[0m\n", cJSON_Print(resp));
-        }
-        else if ((resp = cJSON_GetObjectItem(root, "response")))
-        {
-            printf("\x1B[1;32m%s\x1B[0m\n", cJSON_Print(resp));
-        }
-        else
-        {
-            printf("%s\n", cJSON_Print(root));
-        }
+    ret = nova_batch_run(cli, in, stdout, globalArgs.concurrency, globalArgs.backend);
 
-        cJSON_Delete(root);
+    nova_client_destroy(cli);
+    if (in != stdin)
+    {
+        fclose(in);
     }
-
-fail:
-    deleteNovaHeader(nova_hdr);
-    close(sockfd);
-    free(nova_buf);
-    free(thrift_buf);
-    free(recv_buf);
-    exit(1);
+    return ret ? 0 : 1;
 }
 
 int main(int argc, char **argv)
 {
     int opt = 0;
 
-    char *ret = NULL;
-    size_t method_len = 0;
-    size_t service_len = 0;
 
     globalArgs.attach = "{}";
     globalArgs.debug = 0;
     globalArgs.timeout.tv_sec = 5;
     globalArgs.timeout.tv_usec = 0;
+    globalArgs.concurrency = 16;
+    globalArgs.backend = NOVA_ENGINE_EPOLL;
 
     opt = getopt(argc, argv, optString);
     optarg = trim_opt(optarg);
@@ -403,20 +311,10 @@ int main(int argc, char **argv)
             globalArgs.port = atoi(optarg);
             break;
         case 'm':
-            ret = strrchr(optarg, '.');
-            if (ret == NULL)
+            if (!nova_split_method(optarg, (char **)&globalArgs.service, (char **)&globalArgs.method))
             {
                 INVALID_OPT("Invalid method %s", optarg);
             }
-
-            service_len = ret - optarg;
-            method_len = strlen(optarg) - service_len - 1;
-            *ret = 0;
-            globalArgs.service = malloc(service_len + 1);
-            globalArgs.method = malloc(method_len + 1);
-            memcpy((void *)globalArgs.service, optarg, service_len + 1);
-            memcpy((void *)globalArgs.method, ret + 1, method_len + 1);
-
             break;
         case 'a':
             globalArgs.args = optarg;
@@ -427,6 +325,49 @@ int main(int argc, char **argv)
         case 't':
             globalArgs.timeout.tv_sec = atoi(optarg) > 0 ? atoi(optarg) : 5;
             break;
+        case 'f':
+            globalArgs.batch = optarg;
+            break;
+        case 'c':
+            globalArgs.concurrency = atoi(optarg) > 0 ? atoi(optarg) : 16;
+            break;
+        case 'u':
+            globalArgs.backend = NOVA_ENGINE_URING;
+            break;
+        case 'n':
+            globalArgs.requests = atol(optarg);
+            break;
+        case 'd':
+            globalArgs.duration = atoi(optarg);
+            break;
+        case 'r':
+            globalArgs.rate = atoi(optarg);
+            break;
+        case 'H':
+            globalArgs.hist = optarg;
+            break;
+        case 'M':
+            globalArgs.merge = 1;
+            break;
+        case 'S':
+            globalArgs.schema = optarg;
+            break;
+        case 'P':
+            if (strcmp(optarg, "compact") == 0)
+            {
+                globalArgs.protocol = THRIFT_COMPACT;
+            }
+            else if (strcmp(optarg, "binary") != 0)
+            {
+                INVALID_OPT("Invalid Protocol %s, binary or compact", optarg);
+            }
+            break;
+        case 'z':
+#ifndef NOVA_HAVE_LZ4
+            INVALID_OPT("Compression unsupported, nova was built without liblz4");
+#endif
+            globalArgs.compress = 1;
+            break;
         case '?':
             display_usage();
             break;
@@ -440,6 +381,11 @@ int main(int argc, char **argv)
         optarg = trim_opt(optarg);
     }
 
+    if (globalArgs.merge)
+    {
+        return nova_merge(argc - optind, argv + optind);
+    }
+
     if (globalArgs.host == NULL)
     {
         INVALID_OPT("Missing Host");
@@ -450,6 +396,16 @@ int main(int argc, char **argv)
         INVALID_OPT("Missing Port");
     }
 
+    if (globalArgs.schema != NULL && (schema = thrift_schema_load(globalArgs.schema)) == NULL)
+    {
+        INVALID_OPT("Invalid Schema %s", globalArgs.schema);
+    }
+
+    if (globalArgs.batch != NULL)
+    {
+        return nova_batch();
+    }
+
     if (globalArgs.service == NULL)
     {
         INVALID_OPT("Missing Service -m=${service}.${method}");
@@ -477,19 +433,7 @@ int main(int argc, char **argv)
         }
         else
         {
-            // 泛化调用参数为扁平KV结构, 非标量参数要二次打包
-            cJSON *cur = root->child;
-            while (cur)
-            {
-                if (cJSON_IsArray(cur) || cJSON_IsObject(cur))
-                {
-                    cJSON_ReplaceItemInObject(root, cur->string, cJSON_CreateString(cJSON_PrintUnformatted(cur)));
-                }
-
-                cur = cur->next;
-            }
-
-            globalArgs.args = cJSON_PrintUnformatted(root);
+            globalArgs.args = nova_generic_args(root);
         }
     }
 
@@ -514,7 +458,10 @@ int main(int argc, char **argv)
             globalArgs.args,
             globalArgs.attach);
 
-    nova_invoke();
+    if (globalArgs.requests > 0 || globalArgs.duration > 0)
+    {
+        return nova_bench();
+    }
 
-    return 0;
+    return nova_invoke();
 }
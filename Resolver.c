@@ -0,0 +1,285 @@
+#define _GNU_SOURCE /* getaddrinfo_a */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+
+#include "resolver.h"
+#include "connpool.h"
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+#define NOVA_HAVE_GAI_A 1 /* in libc itself since 2.34, no -lanl */
+#endif
+
+void nova_dns_init(nova_dns *dns, int64_t ttl)
+{
+    dns->entries = NULL;
+    dns->ttl = ttl > 0 ? ttl : NOVA_DNS_TTL_MS;
+}
+
+static void entry_free(nova_dns_entry *entry)
+{
+    free(entry->host);
+    free(entry->addrs);
+    free(entry);
+}
+
+void nova_dns_free(nova_dns *dns)
+{
+    nova_dns_entry *entry, *next;
+
+    for (entry = dns->entries; entry; entry = next)
+    {
+        next = entry->next;
+        entry_free(entry);
+    }
+    dns->entries = NULL;
+}
+
+void nova_dns_invalidate(nova_dns *dns, const char *host)
+{
+    nova_dns_entry **pp, *entry;
+
+    if (dns == NULL)
+    {
+        return;
+    }
+    for (pp = &dns->entries; (entry = *pp); pp = &entry->next)
+    {
+        if (strcmp(entry->host, host) == 0)
+        {
+            *pp = entry->next;
+            entry_free(entry);
+            return;
+        }
+    }
+}
+
+#ifdef NOVA_HAVE_GAI_A
+/* heap owned, a lookup that cannot be cancelled keeps writing into it after we give up */
+typedef struct gai_lookup
+{
+    struct gaicb cb;
+    struct addrinfo hints;
+    char host[];
+} gai_lookup;
+#endif
+
+static int lookup(const char *host, int timeout_ms, struct addrinfo **res)
+{
+    struct addrinfo hints;
+    int err;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    /* literals never reach the resolver */
+    hints.ai_flags = AI_NUMERICHOST;
+    err = getaddrinfo(host, NULL, &hints, res);
+    if (err != EAI_NONAME)
+    {
+        return err;
+    }
+    hints.ai_flags = 0;
+
+#ifdef NOVA_HAVE_GAI_A
+    if (timeout_ms >= 0)
+    {
+        gai_lookup *gl = calloc(1, sizeof(gai_lookup) + strlen(host) + 1);
+        struct gaicb *list[1];
+        struct timespec ts;
+        int64_t deadline = nova_now_ms() + timeout_ms;
+        int64_t left;
+
+        if (gl == NULL)
+        {
+            return EAI_MEMORY;
+        }
+        gl->hints = hints;
+        strcpy(gl->host, host);
+        gl->cb.ar_name = gl->host;
+        gl->cb.ar_request = &gl->hints;
+        list[0] = &gl->cb;
+
+        err = getaddrinfo_a(GAI_NOWAIT, list, 1, NULL);
+        if (err != 0)
+        {
+            free(gl);
+            return err;
+        }
+
+        while ((err = gai_error(&gl->cb)) == EAI_INPROGRESS)
+        {
+            left = deadline - nova_now_ms();
+            if (left <= 0)
+            {
+                if (gai_cancel(&gl->cb) == EAI_NOTCANCELED)
+                {
+                    /* the resolver thread still owns gl, leak it on purpose */
+                    return EAI_AGAIN;
+                }
+                /* EAI_CANCELED, or EAI_ALLDONE when it finished since the last gai_error and the result is usable */
+                err = gai_error(&gl->cb);
+                break;
+            }
+            ts.tv_sec = left / 1000;
+            ts.tv_nsec = (left % 1000) * 1000000;
+            gai_suspend((const struct gaicb *const *)list, 1, &ts);
+        }
+
+        if (err == 0)
+        {
+            *res = gl->cb.ar_result;
+        }
+        else if (err == EAI_INPROGRESS || err == EAI_CANCELED)
+        {
+            if (gl->cb.ar_result)
+            {
+                freeaddrinfo(gl->cb.ar_result);
+            }
+            err = EAI_AGAIN;
+        }
+        free(gl);
+        return err;
+    }
+#endif
+
+    return getaddrinfo(host, NULL, &hints, res);
+}
+
+// 按RFC 8305交替排列地址族, 首选族保持解析器给出的顺序
+static int interleave(struct addrinfo *res, nova_addr *addrs, int max)
+{
+    struct addrinfo *first[2] = {NULL, NULL};
+    struct addrinfo *ai;
+    int family0 = 0;
+    int count = 0;
+    int f;
+
+    for (ai = res; ai; ai = ai->ai_next)
+    {
+        if ((ai->ai_family == AF_INET || ai->ai_family == AF_INET6) && ai->ai_addrlen <= sizeof(struct sockaddr_storage))
+        {
+            family0 = ai->ai_family;
+            break;
+        }
+    }
+    first[0] = first[1] = res;
+
+    while (count < max && (first[0] || first[1]))
+    {
+        for (f = 0; f < 2 && count < max; f++)
+        {
+            int family = f == 0 ? family0 : (family0 == AF_INET ? AF_INET6 : AF_INET);
+            for (ai = first[f]; ai && ai->ai_family != family; ai = ai->ai_next)
+                ;
+            if (ai == NULL || ai->ai_addrlen > sizeof(struct sockaddr_storage))
+            {
+                first[f] = NULL;
+                continue;
+            }
+            memcpy(&addrs[count].sa, ai->ai_addr, ai->ai_addrlen);
+            addrs[count].len = ai->ai_addrlen;
+            count++;
+            first[f] = ai->ai_next;
+        }
+    }
+    return count;
+}
+
+static nova_dns_entry *cache_find(nova_dns *dns, const char *host, int64_t now)
+{
+    nova_dns_entry *entry;
+
+    for (entry = dns->entries; entry; entry = entry->next)
+    {
+        if (strcmp(entry->host, host) == 0)
+        {
+            if (entry->expires > now)
+            {
+                return entry;
+            }
+            nova_dns_invalidate(dns, host);
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+static void set_port(nova_addr *addr, int port)
+{
+    if (addr->sa.ss_family == AF_INET6)
+    {
+        ((struct sockaddr_in6 *)&addr->sa)->sin6_port = htons((unsigned short)port);
+    }
+    else
+    {
+        ((struct sockaddr_in *)&addr->sa)->sin_port = htons((unsigned short)port);
+    }
+}
+
+int nova_dns_resolve(nova_dns *dns, const char *host, int port, nova_addr *addrs, int max, int timeout_ms)
+{
+    nova_addr found[NOVA_DNS_MAX_ADDRS];
+    nova_dns_entry *entry = NULL;
+    struct addrinfo *res = NULL;
+    int64_t now = nova_now_ms();
+    int count;
+    int err;
+    int i;
+
+    if (dns && (entry = cache_find(dns, host, now)))
+    {
+        count = entry->count < max ? entry->count : max;
+        memcpy(addrs, entry->addrs, count * sizeof(nova_addr));
+    }
+    else
+    {
+        err = lookup(host, timeout_ms, &res);
+        if (err != 0)
+        {
+            fprintf(stderr, "ERROR, fail to resolve %s: %s\n", host, gai_strerror(err));
+            count = 0;
+        }
+        else
+        {
+            count = interleave(res, found, NOVA_DNS_MAX_ADDRS);
+            freeaddrinfo(res);
+        }
+
+        if (dns && (entry = calloc(1, sizeof(nova_dns_entry))))
+        {
+            entry->host = strdup(host);
+            entry->addrs = count ? malloc(count * sizeof(nova_addr)) : NULL;
+            if (entry->host == NULL || (count && entry->addrs == NULL))
+            {
+                entry_free(entry);
+            }
+            else
+            {
+                memcpy(entry->addrs, found, count * sizeof(nova_addr));
+                entry->count = count;
+                entry->expires = now + (count ? dns->ttl : NOVA_DNS_NEGATIVE_TTL_MS);
+                entry->next = dns->entries;
+                dns->entries = entry;
+            }
+        }
+
+        if (count > max)
+        {
+            count = max;
+        }
+        memcpy(addrs, found, count * sizeof(nova_addr));
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        set_port(&addrs[i], port);
+    }
+    return count;
+}
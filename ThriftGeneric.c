@@ -1,21 +1,20 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <assert.h>
 #include <string.h>
 
 #include "binarydata.h"
 #include "thriftgeneric.h"
+#include "jsonarena.h"
+#include "cJSON.h"
 
 #define BUF_OFS (uchar_t *)buf + off
-#define C_BUF_OFS (const uchar *)buf + off
 
 int thrift_generic_pack(int seq,
                         const char *serv, int serv_len,
                         const char *method, int method_len,
                         const char *json_args, int args_len, char **out_buf)
 {
-    int off = 0;
     char *buf = malloc(GENERIC_COMMON_LEN + serv_len + method_len + args_len);
     if (buf == NULL)
     {
@@ -23,6 +22,17 @@ int thrift_generic_pack(int seq,
         return 0;
     }
 
+    *out_buf = buf;
+    return thrift_generic_pack_into(seq, serv, serv_len, method, method_len, json_args, args_len, buf);
+}
+
+int thrift_generic_pack_into(int seq,
+                             const char *serv, int serv_len,
+                             const char *method, int method_len,
+                             const char *json_args, int args_len, char *buf)
+{
+    int off = 0;
+
     swWriteU32(BUF_OFS, VER1 | T_CALL);
     off += 4;
 
@@ -105,89 +115,261 @@ int thrift_generic_pack(int seq,
     swWriteByte(BUF_OFS, FIELD_STOP);
     off += 1;
 
-    *out_buf = buf;
     return off;
 }
 
-int thrift_generic_unpack(const char *buf, int buf_len, char **out_json_resp)
+static inline int pack_string_field(char *buf, uint16_t field_id, int len)
+{
+    swWriteByte((uchar_t *)buf, TYPE_STRING);
+    swWriteU16((uchar_t *)buf + 1, field_id);
+    swWriteU32((uchar_t *)buf + 3, len);
+    return 7;
+}
+
+int thrift_generic_pack_iov(int seq,
+                            const char *serv, int serv_len,
+                            const char *method, int method_len,
+                            const char *json_args, int args_len,
+                            char *buf, struct iovec *iov)
 {
     int off = 0;
-    uint32_t ver1;
-    int type;
-    uint32_t tmp_len;
-    char *tmp_str;
-    uint32_t seq;
-    uchar_t field_type;
-    uint16_t field_id;
+    int i = 0;
+
+    swWriteU32(BUF_OFS, VER1 | T_CALL);
+    off += 4;
 
-    swReadU32(C_BUF_OFS, &ver1);
+    swWriteU32(BUF_OFS, GENERIC_METHOD_LEN);
+    off += 4;
+
+    swWriteBytes(BUF_OFS, GENERIC_METHOD, GENERIC_METHOD_LEN);
+    off += GENERIC_METHOD_LEN;
+
+    swWriteU32(BUF_OFS, seq);
     off += 4;
 
-    if (ver1 > 0x7fffffff)
+    swWriteByte(BUF_OFS, TYPE_STRUCT);
+    off += 1;
+
+    swWriteU16(BUF_OFS, 1);
+    off += 2;
+
+    off += pack_string_field(buf + off, 1, serv_len);
+    iov[i].iov_base = buf;
+    iov[i++].iov_len = off;
+    iov[i].iov_base = (void *)serv;
+    iov[i++].iov_len = serv_len;
+
+    iov[i].iov_base = buf + off;
+    iov[i++].iov_len = pack_string_field(buf + off, 2, method_len);
+    off += 7;
+    iov[i].iov_base = (void *)method;
+    iov[i++].iov_len = method_len;
+
+    iov[i].iov_base = buf + off;
+    iov[i++].iov_len = pack_string_field(buf + off, 3, args_len);
+    off += 7;
+    iov[i].iov_base = (void *)json_args;
+    iov[i++].iov_len = args_len;
+
+    // struct stop and args stop
+    swWriteByte(BUF_OFS, FIELD_STOP);
+    swWriteByte(BUF_OFS + 1, FIELD_STOP);
+    iov[i].iov_base = buf + off;
+    iov[i++].iov_len = 2;
+    off += 2;
+
+    return off + serv_len + method_len + args_len;
+}
+
+int thrift_generic_write(thrift_writer *w, int seq,
+                         const char *serv, int serv_len,
+                         const char *method, int method_len,
+                         const char *json_args, int args_len)
+{
+    thrift_write_message_begin(w, GENERIC_METHOD, GENERIC_METHOD_LEN, T_CALL, seq);
+    thrift_write_struct_begin(w);
+    thrift_write_field_begin(w, TYPE_STRUCT, 1);
+
+    // GenericRequest
+    thrift_write_struct_begin(w);
+    thrift_write_field_begin(w, TYPE_STRING, 1);
+    thrift_write_string(w, serv, serv_len);
+    thrift_write_field_begin(w, TYPE_STRING, 2);
+    thrift_write_string(w, method, method_len);
+    thrift_write_field_begin(w, TYPE_STRING, 3);
+    thrift_write_string(w, json_args, args_len);
+    thrift_write_struct_end(w);
+
+    thrift_write_struct_end(w);
+    return !w->error;
+}
+
+/* what GenericService always answers: binary, "invoke", the json as string field 0, then the stop */
+#define GENERIC_REPLY_PREFIX (4 + 4 + GENERIC_METHOD_LEN + 4 + 3 + 4)
+
+/* one length check up front, then straight line compares; anything else goes the long way */
+static const char *generic_reply_fast(const char *buf, int buf_len, int32_t *json_len)
+{
+    const uchar *p = (const uchar *)buf;
+    uint32_t ver;
+    int32_t name_len, len;
+
+    if (buf_len < GENERIC_REPLY_PREFIX + 1)
     {
-        ver1 = 0 - ((ver1 - 1) ^ 0xffffffff);
+        return NULL;
     }
-    ver1 = ver1 & VER_MASK;
-    if (ver1 != VER1)
+    swReadU32(p, &ver);
+    swReadI32(p + 4, &name_len);
+    swReadI32(p + GENERIC_REPLY_PREFIX - 4, &len);
+    if (ver != (VER1 | T_REPLY) || name_len != GENERIC_METHOD_LEN ||
+        memcmp(p + 8, GENERIC_METHOD, GENERIC_METHOD_LEN) != 0 ||
+        p[8 + GENERIC_METHOD_LEN + 4] != TYPE_STRING || p[8 + GENERIC_METHOD_LEN + 5] != 0 || p[8 + GENERIC_METHOD_LEN + 6] != 0 ||
+        len != buf_len - GENERIC_REPLY_PREFIX - 1 || p[buf_len - 1] != FIELD_STOP)
     {
-        fprintf(stderr, "unexpected thrift protocol version\n");
-        return 0;
+        return NULL;
     }
+    *json_len = len;
+    return buf + GENERIC_REPLY_PREFIX;
+}
 
-    type = ver1 & 0x000000ff;
+/* the success string is field 0 of the result struct, anything else is skipped; every read is bounds checked */
+static int generic_read_reply(const char *buf, int buf_len, const char **json, int32_t *json_len)
+{
+    thrift_reader r;
+    const char *name;
+    int32_t name_len, seq;
+    int type;
+    int16_t id;
+
+    *json = NULL;
+    thrift_reader_init(&r, buf, buf_len);
+    if (!thrift_read_message_begin(&r, &name, &name_len, &type, &seq))
+    {
+        fprintf(stderr, "unexpected thrift protocol version\n");
+        return SW_ERR;
+    }
     if (type == T_EX)
     {
         fprintf(stderr, "unexpected thrift exception response\n");
-        return 0;
+        return SW_ERR;
+    }
+    if (name_len != GENERIC_METHOD_LEN || memcmp(name, GENERIC_METHOD, GENERIC_METHOD_LEN) != 0)
+    {
+        fprintf(stderr, "unexpected generic method name:%.*s\n", (int)name_len, name);
+        return SW_ERR;
     }
 
-    swReadU32(C_BUF_OFS, &tmp_len);
-    off += 4;
-    tmp_str = NULL;
-    if (!swReadBytes(C_BUF_OFS, buf_len - off, &tmp_str, (int)tmp_len))
+    thrift_read_struct_begin(&r);
+    for (;;)
     {
-        fprintf(stderr, "fail to read generic method\n");
-        return 0;
+        if (!thrift_read_field_begin(&r, &type, &id))
+        {
+            fprintf(stderr, "fail to read json resp\n");
+            return SW_ERR;
+        }
+        if (type == FIELD_STOP)
+        {
+            break;
+        }
+        if (id == 0 && type == TYPE_STRING)
+        {
+            if (!thrift_read_string(&r, json, json_len))
+            {
+                fprintf(stderr, "fail to read json resp\n");
+                return SW_ERR;
+            }
+        }
+        else if (!thrift_skip(&r, type, 0))
+        {
+            fprintf(stderr, "fail to read json resp\n");
+            return SW_ERR;
+        }
     }
-    off += tmp_len;
-    if (strncmp(tmp_str, GENERIC_METHOD, GENERIC_COMMON_LEN) != 0)
+    if (*json == NULL)
     {
-        fprintf(stderr, "unexpected generic method name:%.*s\n", GENERIC_COMMON_LEN, tmp_str);
-        return 0;
+        fprintf(stderr, "unexpected generic idl format: missing json resp\n");
+        return SW_ERR;
     }
-    free(tmp_str);
+    return SW_OK;
+}
 
-    swReadU32(C_BUF_OFS, &seq);
-    off += 4;
+int thrift_generic_unpack(const char *buf, int buf_len, char **out_json_resp)
+{
+    const char *json;
+    int32_t json_len;
+    char *out;
 
-    swReadByte(C_BUF_OFS, (char *)&field_type);
-    off += 1;
-    if(field_type != TYPE_STRING) {
-        fprintf(stderr, "unexpected generic idl format: expected TYPE_STRING but got %c\n", field_type);
+    json = generic_reply_fast(buf, buf_len, &json_len);
+    if (json == NULL && !generic_read_reply(buf, buf_len, &json, &json_len))
+    {
         return 0;
     }
-
-    swReadU16(C_BUF_OFS, &field_id);
-    off += 2;
-    assert(field_id == 0);
-
-    swReadU32(C_BUF_OFS, &tmp_len);
-    off += 4;
-
-    tmp_str = NULL;
-    if (!swReadBytes(C_BUF_OFS, buf_len - off, &tmp_str, tmp_len))
+    if (json_len == 0)
     {
-        fprintf(stderr, "fail to read json resp\n");
+        /* 0 reads as failure to callers, nothing may be handed out with it */
+        fprintf(stderr, "empty json resp\n");
         return 0;
     }
-    off += tmp_len;
-    *out_json_resp = tmp_str;
 
-    swReadByte(C_BUF_OFS, (char *)&field_type);
-    assert(field_type == FIELD_STOP);
-    off += 1;
+    /* NUL terminated for json parsers */
+    out = malloc(json_len + 1);
+    if (out == NULL)
+    {
+        fprintf(stderr, "malloc failed");
+        return 0;
+    }
+    memcpy(out, json, json_len);
+    out[json_len] = 0;
+    *out_json_resp = out;
+    return json_len;
+}
 
-    assert(off == buf_len);
+int thrift_exception_unpack(const char *buf, int buf_len, char **out_json)
+{
+    thrift_reader r;
+    thrift_app_exception ex;
+    const char *name;
+    int32_t name_len, seq;
+    int type, len = 0;
+    char *message, *json;
+    cJSON *root, *item;
+    nova_json_mark mark;
+
+    thrift_reader_init(&r, buf, buf_len);
+    if (!thrift_read_message_begin(&r, &name, &name_len, &type, &seq) || type != T_EX ||
+        !thrift_read_app_exception(&r, &ex))
+    {
+        fprintf(stderr, "invalid thrift exception response\n");
+        return 0;
+    }
 
-    return tmp_len;
-}
\ No newline at end of file
+    message = malloc(ex.message_len + 1);
+    if (message == NULL)
+    {
+        return 0;
+    }
+    if (ex.message_len > 0)
+    {
+        memcpy(message, ex.message, ex.message_len);
+    }
+    message[ex.message_len] = 0;
+
+    mark = nova_json_arena_begin();
+    root = cJSON_CreateObject();
+    item = cJSON_CreateObject();
+    cJSON_AddItemToObject(root, "exception", item);
+    cJSON_AddNumberToObject(item, "type", ex.type);
+    cJSON_AddStringToObject(item, "name", thrift_app_exception_name(ex.type));
+    cJSON_AddStringToObject(item, "message", message);
+    free(message);
+
+    /* resp->json is released with free */
+    json = cJSON_PrintUnformatted(root);
+    *out_json = json ? strdup(json) : NULL;
+    nova_json_arena_end(mark);
+    if (*out_json)
+    {
+        len = strlen(*out_json);
+    }
+    return len;
+}
@@ -0,0 +1,1048 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "thriftprotocol.h"
+#include "binarydata.h"
+
+#define COMPACT_VERSION 1
+#define COMPACT_BOOL_TRUE 1
+#define COMPACT_BOOL_FALSE 2
+
+/* TYPE_* to the compact type nibble, 0 where compact has no such type */
+static const uchar compact_types[16] = {
+    [TYPE_BOOL] = COMPACT_BOOL_TRUE,
+    [TYPE_BYTE] = 3,
+    [TYPE_I16] = 4,
+    [TYPE_I32] = 5,
+    [TYPE_I64] = 6,
+    [TYPE_DOUBLE] = 7,
+    [TYPE_STRING] = 8,
+    [TYPE_LIST] = 9,
+    [TYPE_SET] = 10,
+    [TYPE_MAP] = 11,
+    [TYPE_STRUCT] = 12,
+};
+
+/* the compact type nibble to TYPE_*, -1 for the unused nibbles */
+static const int8_t ttypes[16] = {
+    FIELD_STOP, TYPE_BOOL, TYPE_BOOL, TYPE_BYTE, TYPE_I16, TYPE_I32, TYPE_I64, TYPE_DOUBLE,
+    TYPE_STRING, TYPE_LIST, TYPE_SET, TYPE_MAP, TYPE_STRUCT, -1, -1, -1,
+};
+
+static inline uint32_t zigzag32(int32_t n)
+{
+    return ((uint32_t)n << 1) ^ (uint32_t)(n >> 31);
+}
+
+static inline uint64_t zigzag64(int64_t n)
+{
+    return ((uint64_t)n << 1) ^ (uint64_t)(n >> 63);
+}
+
+static inline int32_t unzigzag32(uint32_t n)
+{
+    return (int32_t)(n >> 1) ^ -(int32_t)(n & 1);
+}
+
+static inline int64_t unzigzag64(uint64_t n)
+{
+    return (int64_t)(n >> 1) ^ -(int64_t)(n & 1);
+}
+
+static void compact_reset(thrift_compact_state *cs)
+{
+    cs->last_id = 0;
+    cs->bool_pending = 0;
+    cs->depth = 0;
+}
+
+/* remember the parent's last field id, 0 when the nesting is too deep */
+static int compact_push(thrift_compact_state *cs)
+{
+    if (cs->depth > THRIFT_MAX_DEPTH)
+    {
+        return SW_ERR;
+    }
+    cs->ids[cs->depth++] = cs->last_id;
+    cs->last_id = 0;
+    return SW_OK;
+}
+
+static int compact_pop(thrift_compact_state *cs)
+{
+    if (cs->depth == 0)
+    {
+        return SW_ERR;
+    }
+    cs->last_id = cs->ids[--cs->depth];
+    return SW_OK;
+}
+
+/* room for n more bytes, return where they go or NULL once the writer failed */
+static uchar *writer_space(thrift_writer *w, int32_t n)
+{
+    uchar *p;
+
+    if (w->error || !nova_buf_reserve(w->out, w->out->len + n))
+    {
+        w->error = 1;
+        return NULL;
+    }
+    p = (uchar *)w->out->data + w->out->len;
+    w->out->len += n;
+    return p;
+}
+
+static inline int put_varint32(uchar *p, uint32_t n)
+{
+    int i = 0;
+
+    while (n >= 0x80)
+    {
+        p[i++] = (uchar)(n | 0x80);
+        n >>= 7;
+    }
+    p[i++] = (uchar)n;
+    return i;
+}
+
+static void write_varint32(thrift_writer *w, uint32_t n)
+{
+    uchar tmp[5];
+    uchar *p;
+    int len = put_varint32(tmp, n);
+
+    if ((p = writer_space(w, len)))
+    {
+        memcpy(p, tmp, len);
+    }
+}
+
+static void write_varint64(thrift_writer *w, uint64_t n)
+{
+    uchar tmp[10];
+    uchar *p;
+    int len = 0;
+
+    while (n >= 0x80)
+    {
+        tmp[len++] = (uchar)(n | 0x80);
+        n >>= 7;
+    }
+    tmp[len++] = (uchar)n;
+    if ((p = writer_space(w, len)))
+    {
+        memcpy(p, tmp, len);
+    }
+}
+
+/* always 5 bytes, the trailing groups carry continuation bits over zeros */
+static void put_fixed_varint32(uchar *p, uint32_t n)
+{
+    p[0] = (uchar)(n | 0x80);
+    p[1] = (uchar)((n >> 7) | 0x80);
+    p[2] = (uchar)((n >> 14) | 0x80);
+    p[3] = (uchar)((n >> 21) | 0x80);
+    p[4] = (uchar)(n >> 28);
+}
+
+static uchar compact_type(thrift_writer *w, int type)
+{
+    uchar ct = type >= 0 && type < 16 ? compact_types[type] : 0;
+
+    if (ct == 0)
+    {
+        w->error = 1;
+    }
+    return ct;
+}
+
+void thrift_writer_init(thrift_writer *w, nova_buf *out, int proto)
+{
+    w->out = out;
+    w->proto = proto;
+    w->error = 0;
+    compact_reset(&w->cs);
+}
+
+void thrift_write_message_begin(thrift_writer *w, const char *name, int32_t name_len, int type, int32_t seq)
+{
+    uchar *p;
+    int n;
+
+    if (w->proto == THRIFT_COMPACT)
+    {
+        p = writer_space(w, 2 + 5 + 5 + name_len);
+        if (p)
+        {
+            p[0] = THRIFT_COMPACT_ID;
+            p[1] = (uchar)(COMPACT_VERSION | (type << 5));
+            put_fixed_varint32(p + 2, (uint32_t)seq);
+            n = put_varint32(p + 7, (uint32_t)name_len);
+            memcpy(p + 7 + n, name, name_len);
+            /* the name length took less than the 5 bytes reserved */
+            w->out->len -= 5 - n;
+        }
+        return;
+    }
+
+    p = writer_space(w, 4 + 4 + name_len + 4);
+    if (p)
+    {
+        swWriteU32(p, VER1 | type);
+        swWriteI32(p + 4, name_len);
+        memcpy(p + 8, name, name_len);
+        swWriteI32(p + 8 + name_len, seq);
+    }
+}
+
+void thrift_write_struct_begin(thrift_writer *w)
+{
+    if (w->proto == THRIFT_COMPACT && !compact_push(&w->cs))
+    {
+        w->error = 1;
+    }
+}
+
+void thrift_write_struct_end(thrift_writer *w)
+{
+    uchar *p = writer_space(w, 1);
+    if (p)
+    {
+        *p = FIELD_STOP;
+    }
+    if (w->proto == THRIFT_COMPACT && !compact_pop(&w->cs))
+    {
+        w->error = 1;
+    }
+}
+
+static void compact_field_header(thrift_writer *w, uchar ct, int16_t id)
+{
+    uchar *p;
+    int delta = id - w->cs.last_id;
+
+    if (delta > 0 && delta <= 15)
+    {
+        if ((p = writer_space(w, 1)))
+        {
+            *p = (uchar)(delta << 4 | ct);
+        }
+    }
+    else if ((p = writer_space(w, 1)))
+    {
+        *p = ct;
+        write_varint32(w, zigzag32(id));
+    }
+    w->cs.last_id = id;
+}
+
+void thrift_write_field_begin(thrift_writer *w, int type, int16_t id)
+{
+    uchar ct;
+    uchar *p;
+
+    if (w->proto == THRIFT_COMPACT)
+    {
+        if (type == TYPE_BOOL)
+        {
+            /* the header waits for the value */
+            w->cs.bool_id = id;
+            w->cs.bool_pending = 1;
+        }
+        else if ((ct = compact_type(w, type)))
+        {
+            compact_field_header(w, ct, id);
+        }
+        return;
+    }
+
+    p = writer_space(w, 3);
+    if (p)
+    {
+        swWriteByte(p, (char)type);
+        swWriteI16(p + 1, id);
+    }
+}
+
+void thrift_write_list_begin(thrift_writer *w, int elem_type, int32_t size)
+{
+    uchar ct;
+    uchar *p;
+
+    if (w->proto == THRIFT_COMPACT)
+    {
+        if ((ct = compact_type(w, elem_type)) == 0)
+        {
+            return;
+        }
+        if (size < 15)
+        {
+            if ((p = writer_space(w, 1)))
+            {
+                *p = (uchar)(size << 4 | ct);
+            }
+        }
+        else if ((p = writer_space(w, 1)))
+        {
+            *p = 0xf0 | ct;
+            write_varint32(w, (uint32_t)size);
+        }
+        return;
+    }
+
+    p = writer_space(w, 5);
+    if (p)
+    {
+        swWriteByte(p, (char)elem_type);
+        swWriteI32(p + 1, size);
+    }
+}
+
+void thrift_write_map_begin(thrift_writer *w, int key_type, int val_type, int32_t size)
+{
+    uchar kt, vt;
+    uchar *p;
+
+    if (w->proto == THRIFT_COMPACT)
+    {
+        /* an empty map is a single zero, the types are left out */
+        write_varint32(w, (uint32_t)size);
+        if (size > 0 && (kt = compact_type(w, key_type)) && (vt = compact_type(w, val_type)) && (p = writer_space(w, 1)))
+        {
+            *p = (uchar)(kt << 4 | vt);
+        }
+        return;
+    }
+
+    p = writer_space(w, 6);
+    if (p)
+    {
+        swWriteByte(p, (char)key_type);
+        swWriteByte(p + 1, (char)val_type);
+        swWriteI32(p + 2, size);
+    }
+}
+
+void thrift_write_bool(thrift_writer *w, int value)
+{
+    if (w->proto == THRIFT_COMPACT)
+    {
+        if (w->cs.bool_pending)
+        {
+            w->cs.bool_pending = 0;
+            compact_field_header(w, value ? COMPACT_BOOL_TRUE : COMPACT_BOOL_FALSE, w->cs.bool_id);
+        }
+        else
+        {
+            thrift_write_byte(w, value ? COMPACT_BOOL_TRUE : COMPACT_BOOL_FALSE);
+        }
+        return;
+    }
+    thrift_write_byte(w, value ? 1 : 0);
+}
+
+void thrift_write_byte(thrift_writer *w, int8_t value)
+{
+    uchar *p = writer_space(w, 1);
+    if (p)
+    {
+        *p = (uchar)value;
+    }
+}
+
+void thrift_write_i16(thrift_writer *w, int16_t value)
+{
+    uchar *p;
+
+    if (w->proto == THRIFT_COMPACT)
+    {
+        write_varint32(w, zigzag32(value));
+        return;
+    }
+    if ((p = writer_space(w, 2)))
+    {
+        swWriteI16(p, value);
+    }
+}
+
+void thrift_write_i32(thrift_writer *w, int32_t value)
+{
+    uchar *p;
+
+    if (w->proto == THRIFT_COMPACT)
+    {
+        write_varint32(w, zigzag32(value));
+        return;
+    }
+    if ((p = writer_space(w, 4)))
+    {
+        swWriteI32(p, value);
+    }
+}
+
+void thrift_write_i64(thrift_writer *w, int64_t value)
+{
+    uchar *p;
+
+    if (w->proto == THRIFT_COMPACT)
+    {
+        write_varint64(w, zigzag64(value));
+        return;
+    }
+    if ((p = writer_space(w, 8)))
+    {
+        swWriteI64(p, value);
+    }
+}
+
+void thrift_write_double(thrift_writer *w, double value)
+{
+    uint64_t bits;
+    uchar *p;
+    int i;
+
+    memcpy(&bits, &value, sizeof(bits));
+    if (w->proto == THRIFT_COMPACT)
+    {
+        /* compact doubles are little endian */
+        if ((p = writer_space(w, 8)))
+        {
+            for (i = 0; i < 8; i++)
+            {
+                p[i] = (uchar)(bits >> (8 * i));
+            }
+        }
+        return;
+    }
+    if ((p = writer_space(w, 8)))
+    {
+        swStoreU64(p, bits);
+    }
+}
+
+void thrift_write_string(thrift_writer *w, const char *str, int32_t len)
+{
+    uchar *p;
+
+    if (w->proto == THRIFT_COMPACT)
+    {
+        write_varint32(w, (uint32_t)len);
+        if ((p = writer_space(w, len)))
+        {
+            memcpy(p, str, len);
+        }
+        return;
+    }
+    if ((p = writer_space(w, 4 + len)))
+    {
+        swWriteI32(p, len);
+        memcpy(p + 4, str, len);
+    }
+}
+
+/* n more bytes are in the buffer, return where they start or NULL once the reader failed */
+static const uchar *reader_take(thrift_reader *r, int32_t n)
+{
+    const uchar *p;
+
+    if (r->error || n < 0 || n > r->len - r->off)
+    {
+        r->error = 1;
+        return NULL;
+    }
+    p = (const uchar *)r->buf + r->off;
+    r->off += n;
+    return p;
+}
+
+/* at most max_bytes groups, longer encodings are garbage */
+static int read_varint(thrift_reader *r, uint64_t *value, int max_bytes)
+{
+    const uchar *p;
+    uint64_t n = 0;
+    int shift = 0, i;
+
+    for (i = 0; i < max_bytes; i++)
+    {
+        if ((p = reader_take(r, 1)) == NULL)
+        {
+            return SW_ERR;
+        }
+        n |= (uint64_t)(*p & 0x7f) << shift;
+        if (!(*p & 0x80))
+        {
+            *value = n;
+            return SW_OK;
+        }
+        shift += 7;
+    }
+    r->error = 1;
+    return SW_ERR;
+}
+
+static int read_varint32(thrift_reader *r, uint32_t *value)
+{
+    uint64_t n;
+
+    if (!read_varint(r, &n, 5))
+    {
+        return SW_ERR;
+    }
+    *value = (uint32_t)n;
+    return SW_OK;
+}
+
+void thrift_reader_init(thrift_reader *r, const char *buf, int32_t len)
+{
+    r->buf = buf;
+    r->len = len;
+    r->off = 0;
+    r->proto = len > 0 && (uchar)buf[0] == THRIFT_COMPACT_ID ? THRIFT_COMPACT : THRIFT_BINARY;
+    r->error = 0;
+    compact_reset(&r->cs);
+}
+
+int thrift_read_message_begin(thrift_reader *r, const char **name, int32_t *name_len, int *type, int32_t *seq)
+{
+    const uchar *p;
+    uint32_t ver, n;
+
+    if (r->proto == THRIFT_COMPACT)
+    {
+        if ((p = reader_take(r, 2)) == NULL)
+        {
+            return SW_ERR;
+        }
+        if ((p[1] & 0x1f) != COMPACT_VERSION)
+        {
+            r->error = 1;
+            return SW_ERR;
+        }
+        *type = p[1] >> 5;
+        if (!read_varint32(r, &n))
+        {
+            return SW_ERR;
+        }
+        *seq = (int32_t)n;
+        return thrift_read_string(r, name, name_len);
+    }
+
+    if ((p = reader_take(r, 4)) == NULL)
+    {
+        return SW_ERR;
+    }
+    swReadU32(p, &ver);
+    if ((ver & VER_MASK) != VER1)
+    {
+        /* old style unversioned messages are not spoken by nova */
+        r->error = 1;
+        return SW_ERR;
+    }
+    *type = ver & 0xff;
+    return thrift_read_string(r, name, name_len) && thrift_read_i32(r, seq);
+}
+
+int thrift_read_struct_begin(thrift_reader *r)
+{
+    if (r->proto == THRIFT_COMPACT && !compact_push(&r->cs))
+    {
+        r->error = 1;
+        return SW_ERR;
+    }
+    return !r->error;
+}
+
+int thrift_read_struct_end(thrift_reader *r)
+{
+    if (r->proto == THRIFT_COMPACT && !compact_pop(&r->cs))
+    {
+        r->error = 1;
+        return SW_ERR;
+    }
+    return !r->error;
+}
+
+int thrift_read_field_begin(thrift_reader *r, int *type, int16_t *id)
+{
+    const uchar *p = reader_take(r, 1);
+    uint32_t n;
+    int ct;
+
+    if (p == NULL)
+    {
+        return SW_ERR;
+    }
+    *id = 0;
+
+    if (r->proto == THRIFT_COMPACT)
+    {
+        ct = *p & 0x0f;
+        if ((*type = ttypes[ct]) < 0)
+        {
+            r->error = 1;
+            return SW_ERR;
+        }
+        if (*type == FIELD_STOP)
+        {
+            return SW_OK;
+        }
+        if (*p >> 4)
+        {
+            *id = (int16_t)(r->cs.last_id + (*p >> 4));
+        }
+        else if (read_varint32(r, &n))
+        {
+            *id = (int16_t)unzigzag32(n);
+        }
+        else
+        {
+            return SW_ERR;
+        }
+        r->cs.last_id = *id;
+        if (*type == TYPE_BOOL)
+        {
+            r->cs.bool_pending = 1;
+            r->cs.bool_value = ct == COMPACT_BOOL_TRUE;
+        }
+        return SW_OK;
+    }
+
+    *type = *p;
+    if (*type == FIELD_STOP)
+    {
+        return SW_OK;
+    }
+    return thrift_read_i16(r, id);
+}
+
+/* a container can not hold more elements than bytes left, this bounds allocations on garbage */
+static int reader_check_size(thrift_reader *r, int32_t size)
+{
+    if (size < 0 || size > r->len - r->off)
+    {
+        r->error = 1;
+        return SW_ERR;
+    }
+    return SW_OK;
+}
+
+static int reader_compact_type(thrift_reader *r, int ct, int *type)
+{
+    if ((*type = ttypes[ct & 0x0f]) <= FIELD_STOP)
+    {
+        r->error = 1;
+        return SW_ERR;
+    }
+    return SW_OK;
+}
+
+int thrift_read_list_begin(thrift_reader *r, int *elem_type, int32_t *size)
+{
+    const uchar *p;
+    uint32_t n;
+
+    if (r->proto == THRIFT_COMPACT)
+    {
+        if ((p = reader_take(r, 1)) == NULL || !reader_compact_type(r, *p, elem_type))
+        {
+            return SW_ERR;
+        }
+        n = *p >> 4;
+        if (n == 15 && !read_varint32(r, &n))
+        {
+            return SW_ERR;
+        }
+        *size = (int32_t)n;
+        return reader_check_size(r, *size);
+    }
+
+    if ((p = reader_take(r, 5)) == NULL)
+    {
+        return SW_ERR;
+    }
+    *elem_type = p[0];
+    swReadI32(p + 1, size);
+    return reader_check_size(r, *size);
+}
+
+int thrift_read_map_begin(thrift_reader *r, int *key_type, int *val_type, int32_t *size)
+{
+    const uchar *p;
+    uint32_t n;
+
+    if (r->proto == THRIFT_COMPACT)
+    {
+        if (!read_varint32(r, &n))
+        {
+            return SW_ERR;
+        }
+        *size = (int32_t)n;
+        *key_type = *val_type = FIELD_STOP;
+        if (n == 0)
+        {
+            return SW_OK;
+        }
+        if ((p = reader_take(r, 1)) == NULL || !reader_compact_type(r, *p >> 4, key_type) || !reader_compact_type(r, *p, val_type))
+        {
+            return SW_ERR;
+        }
+        return reader_check_size(r, *size);
+    }
+
+    if ((p = reader_take(r, 6)) == NULL)
+    {
+        return SW_ERR;
+    }
+    *key_type = p[0];
+    *val_type = p[1];
+    swReadI32(p + 2, size);
+    return reader_check_size(r, *size);
+}
+
+int thrift_read_bool(thrift_reader *r, int *value)
+{
+    const uchar *p;
+
+    if (r->proto == THRIFT_COMPACT && r->cs.bool_pending)
+    {
+        /* the value came with the field header */
+        r->cs.bool_pending = 0;
+        *value = r->cs.bool_value;
+        return !r->error;
+    }
+    if ((p = reader_take(r, 1)) == NULL)
+    {
+        return SW_ERR;
+    }
+    *value = r->proto == THRIFT_COMPACT ? *p == COMPACT_BOOL_TRUE : *p != 0;
+    return SW_OK;
+}
+
+int thrift_read_byte(thrift_reader *r, int8_t *value)
+{
+    const uchar *p = reader_take(r, 1);
+
+    if (p == NULL)
+    {
+        return SW_ERR;
+    }
+    *value = (int8_t)*p;
+    return SW_OK;
+}
+
+int thrift_read_i16(thrift_reader *r, int16_t *value)
+{
+    const uchar *p;
+    uint32_t n;
+
+    if (r->proto == THRIFT_COMPACT)
+    {
+        if (!read_varint32(r, &n))
+        {
+            return SW_ERR;
+        }
+        *value = (int16_t)unzigzag32(n);
+        return SW_OK;
+    }
+    if ((p = reader_take(r, 2)) == NULL)
+    {
+        return SW_ERR;
+    }
+    swReadI16(p, value);
+    return SW_OK;
+}
+
+int thrift_read_i32(thrift_reader *r, int32_t *value)
+{
+    const uchar *p;
+    uint32_t n;
+
+    if (r->proto == THRIFT_COMPACT)
+    {
+        if (!read_varint32(r, &n))
+        {
+            return SW_ERR;
+        }
+        *value = unzigzag32(n);
+        return SW_OK;
+    }
+    if ((p = reader_take(r, 4)) == NULL)
+    {
+        return SW_ERR;
+    }
+    swReadI32(p, value);
+    return SW_OK;
+}
+
+int thrift_read_i64(thrift_reader *r, int64_t *value)
+{
+    const uchar *p;
+    uint64_t n;
+
+    if (r->proto == THRIFT_COMPACT)
+    {
+        if (!read_varint(r, &n, 10))
+        {
+            return SW_ERR;
+        }
+        *value = unzigzag64(n);
+        return SW_OK;
+    }
+    if ((p = reader_take(r, 8)) == NULL)
+    {
+        return SW_ERR;
+    }
+    swReadI64(p, value);
+    return SW_OK;
+}
+
+int thrift_read_double(thrift_reader *r, double *value)
+{
+    const uchar *p = reader_take(r, 8);
+    uint64_t bits = 0;
+    int i;
+
+    if (p == NULL)
+    {
+        return SW_ERR;
+    }
+    if (r->proto == THRIFT_COMPACT)
+    {
+        for (i = 0; i < 8; i++)
+        {
+            bits |= (uint64_t)p[i] << (8 * i);
+        }
+    }
+    else
+    {
+        bits = swLoadU64(p);
+    }
+    memcpy(value, &bits, sizeof(bits));
+    return SW_OK;
+}
+
+int thrift_read_string(thrift_reader *r, const char **str, int32_t *len)
+{
+    const uchar *p;
+    uint32_t n;
+
+    if (r->proto == THRIFT_COMPACT)
+    {
+        if (!read_varint32(r, &n))
+        {
+            return SW_ERR;
+        }
+        *len = (int32_t)n;
+    }
+    else if (!thrift_read_i32(r, len))
+    {
+        return SW_ERR;
+    }
+    if ((p = reader_take(r, *len)) == NULL)
+    {
+        return SW_ERR;
+    }
+    *str = (const char *)p;
+    return SW_OK;
+}
+
+int thrift_skip(thrift_reader *r, int type, int depth)
+{
+    int8_t b;
+    int16_t i16;
+    int32_t i32, size, i;
+    int64_t i64;
+    double d;
+    const char *str;
+    int bv, key_type, val_type, elem_type;
+    int16_t id;
+
+    if (depth > THRIFT_MAX_DEPTH)
+    {
+        r->error = 1;
+        return SW_ERR;
+    }
+
+    switch (type)
+    {
+    case TYPE_BOOL:
+        return thrift_read_bool(r, &bv);
+    case TYPE_BYTE:
+        return thrift_read_byte(r, &b);
+    case TYPE_I16:
+        return thrift_read_i16(r, &i16);
+    case TYPE_I32:
+        return thrift_read_i32(r, &i32);
+    case TYPE_I64:
+        return thrift_read_i64(r, &i64);
+    case TYPE_DOUBLE:
+        return thrift_read_double(r, &d);
+    case TYPE_STRING:
+        return thrift_read_string(r, &str, &i32);
+    case TYPE_STRUCT:
+        if (!thrift_read_struct_begin(r))
+        {
+            return SW_ERR;
+        }
+        for (;;)
+        {
+            if (!thrift_read_field_begin(r, &elem_type, &id))
+            {
+                return SW_ERR;
+            }
+            if (elem_type == FIELD_STOP)
+            {
+                return thrift_read_struct_end(r);
+            }
+            if (!thrift_skip(r, elem_type, depth + 1))
+            {
+                return SW_ERR;
+            }
+        }
+    case TYPE_MAP:
+        if (!thrift_read_map_begin(r, &key_type, &val_type, &size))
+        {
+            return SW_ERR;
+        }
+        for (i = 0; i < size; i++)
+        {
+            if (!thrift_skip(r, key_type, depth + 1) || !thrift_skip(r, val_type, depth + 1))
+            {
+                return SW_ERR;
+            }
+        }
+        return SW_OK;
+    case TYPE_SET:
+    case TYPE_LIST:
+        if (!thrift_read_list_begin(r, &elem_type, &size))
+        {
+            return SW_ERR;
+        }
+        for (i = 0; i < size; i++)
+        {
+            if (!thrift_skip(r, elem_type, depth + 1))
+            {
+                return SW_ERR;
+            }
+        }
+        return SW_OK;
+    default:
+        r->error = 1;
+        return SW_ERR;
+    }
+}
+
+int thrift_message_set_seq(char *buf, int32_t len, int32_t seq)
+{
+    uchar *p = (uchar *)buf;
+    int32_t name_len;
+
+    if (len > 0 && p[0] == THRIFT_COMPACT_ID)
+    {
+        /* only the fixed width seq thrift_write_message_begin writes can be patched */
+        p += THRIFT_COMPACT_SEQ_OFFSET;
+        if (len < THRIFT_COMPACT_SEQ_OFFSET + 5 || (p[0] & p[1] & p[2] & p[3] & 0x80) == 0 || p[4] > 0x0f)
+        {
+            return SW_ERR;
+        }
+        put_fixed_varint32(p, (uint32_t)seq);
+        return SW_OK;
+    }
+
+    if (len < 8)
+    {
+        return SW_ERR;
+    }
+    swReadI32(p + 4, &name_len);
+    if (name_len < 0 || name_len > len - 12)
+    {
+        return SW_ERR;
+    }
+    swWriteI32(p + 8 + name_len, seq);
+    return SW_OK;
+}
+
+int thrift_message_type(const char *buf, int32_t len)
+{
+    const uchar *p = (const uchar *)buf;
+    uint32_t ver;
+
+    if (len >= 2 && p[0] == THRIFT_COMPACT_ID)
+    {
+        return (p[1] & 0x1f) == COMPACT_VERSION ? p[1] >> 5 : -1;
+    }
+    if (len < 4)
+    {
+        return -1;
+    }
+    swReadU32(p, &ver);
+    return (ver & VER_MASK) == VER1 ? (int)(ver & 0xff) : -1;
+}
+
+int thrift_read_app_exception(thrift_reader *r, thrift_app_exception *ex)
+{
+    int type;
+    int16_t id;
+
+    ex->message = NULL;
+    ex->message_len = 0;
+    ex->type = THRIFT_EX_UNKNOWN;
+
+    if (!thrift_read_struct_begin(r))
+    {
+        return SW_ERR;
+    }
+    for (;;)
+    {
+        if (!thrift_read_field_begin(r, &type, &id))
+        {
+            return SW_ERR;
+        }
+        if (type == FIELD_STOP)
+        {
+            break;
+        }
+        if (id == 1 && type == TYPE_STRING)
+        {
+            thrift_read_string(r, &ex->message, &ex->message_len);
+        }
+        else if (id == 2 && type == TYPE_I32)
+        {
+            thrift_read_i32(r, &ex->type);
+        }
+        else
+        {
+            thrift_skip(r, type, 0);
+        }
+        if (r->error)
+        {
+            return SW_ERR;
+        }
+    }
+    return thrift_read_struct_end(r);
+}
+
+const char *thrift_app_exception_name(int32_t type)
+{
+    static const char *names[] = {
+        "UNKNOWN",
+        "UNKNOWN_METHOD",
+        "INVALID_MESSAGE_TYPE",
+        "WRONG_METHOD_NAME",
+        "BAD_SEQUENCE_ID",
+        "MISSING_RESULT",
+        "INTERNAL_ERROR",
+        "PROTOCOL_ERROR",
+        "INVALID_TRANSFORM",
+        "INVALID_PROTOCOL",
+        "UNSUPPORTED_CLIENT_TYPE",
+    };
+
+    if (type < 0 || type >= (int32_t)(sizeof(names) / sizeof(names[0])))
+    {
+        return names[THRIFT_EX_UNKNOWN];
+    }
+    return names[type];
+}
@@ -0,0 +1,908 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "thriftschema.h"
+#include "binarydata.h"
+#include "jsonarena.h"
+#include "cJSON.h"
+
+static const struct
+{
+    const char *name;
+    int ttype;
+} thrift_base_types[] = {
+    {"bool", TYPE_BOOL},
+    {"byte", TYPE_BYTE},
+    {"i8", TYPE_BYTE},
+    {"i16", TYPE_I16},
+    {"i32", TYPE_I32},
+    {"i64", TYPE_I64},
+    {"double", TYPE_DOUBLE},
+    {"string", TYPE_STRING},
+    {"binary", TYPE_STRING},
+};
+
+static void type_free(thrift_type *t)
+{
+    if (t)
+    {
+        type_free(t->key);
+        type_free(t->elem);
+        free(t);
+    }
+}
+
+static void struct_free(thrift_struct *s)
+{
+    int i;
+
+    for (i = 0; i < s->nfields; i++)
+    {
+        free(s->fields[i].name);
+        type_free(s->fields[i].type);
+    }
+    free(s->fields);
+    free(s->name);
+}
+
+void thrift_schema_free(thrift_schema *schema)
+{
+    int i;
+
+    if (schema == NULL)
+    {
+        return;
+    }
+    for (i = 0; i < schema->nstructs; i++)
+    {
+        struct_free(&schema->structs[i]);
+    }
+    for (i = 0; i < schema->nmethods; i++)
+    {
+        free(schema->methods[i].service);
+        free(schema->methods[i].name);
+        struct_free(&schema->methods[i].args);
+        struct_free(&schema->methods[i].result);
+    }
+    free(schema->structs);
+    free(schema->methods);
+    free(schema);
+}
+
+static thrift_type *parse_type(thrift_schema *schema, cJSON *item)
+{
+    thrift_type *t = calloc(1, sizeof(thrift_type));
+    cJSON *sub;
+    size_t i;
+
+    if (t == NULL)
+    {
+        return NULL;
+    }
+
+    if (cJSON_IsString(item))
+    {
+        for (i = 0; i < sizeof(thrift_base_types) / sizeof(thrift_base_types[0]); i++)
+        {
+            if (strcmp(item->valuestring, thrift_base_types[i].name) == 0)
+            {
+                t->ttype = thrift_base_types[i].ttype;
+                return t;
+            }
+        }
+        for (i = 0; i < (size_t)schema->nstructs; i++)
+        {
+            if (strcmp(item->valuestring, schema->structs[i].name) == 0)
+            {
+                t->ttype = TYPE_STRUCT;
+                t->sdef = &schema->structs[i];
+                return t;
+            }
+        }
+        fprintf(stderr, "ERROR, unknown thrift type %s\n", item->valuestring);
+    }
+    else if ((sub = cJSON_GetObjectItem(item, "list")) || (sub = cJSON_GetObjectItem(item, "set")))
+    {
+        t->ttype = strcmp(sub->string, "set") == 0 ? TYPE_SET : TYPE_LIST;
+        if ((t->elem = parse_type(schema, sub)))
+        {
+            return t;
+        }
+    }
+    else if ((sub = cJSON_GetObjectItem(item, "map")) && cJSON_GetArraySize(sub) == 2)
+    {
+        t->ttype = TYPE_MAP;
+        if ((t->key = parse_type(schema, cJSON_GetArrayItem(sub, 0))) &&
+            (t->elem = parse_type(schema, cJSON_GetArrayItem(sub, 1))))
+        {
+            return t;
+        }
+    }
+    else
+    {
+        fprintf(stderr, "ERROR, invalid thrift type, expect a name, {\"list\":T}, {\"set\":T} or {\"map\":[K,V]}\n");
+    }
+
+    type_free(t);
+    return NULL;
+}
+
+static const thrift_field *struct_field_by_id(const thrift_struct *s, int16_t id)
+{
+    int i;
+
+    for (i = 0; i < s->nfields; i++)
+    {
+        if (s->fields[i].id == id)
+        {
+            return &s->fields[i];
+        }
+    }
+    return NULL;
+}
+
+static const thrift_field *struct_field_by_name(const thrift_struct *s, const char *name)
+{
+    int i;
+
+    for (i = 0; i < s->nfields; i++)
+    {
+        if (strcmp(s->fields[i].name, name) == 0)
+        {
+            return &s->fields[i];
+        }
+    }
+    return NULL;
+}
+
+/* append one field, ids start at 1 except for the success field of results */
+static int add_field(thrift_schema *schema, thrift_struct *s, int id, const char *name, cJSON *type, int required)
+{
+    thrift_field *f;
+
+    if (id < 0 || id > 0x7fff || struct_field_by_id(s, (int16_t)id) || struct_field_by_name(s, name))
+    {
+        fprintf(stderr, "ERROR, invalid or duplicate thrift field %s.%s (%d)\n", s->name, name, id);
+        return SW_ERR;
+    }
+
+    f = &s->fields[s->nfields];
+    f->id = (int16_t)id;
+    f->required = required;
+    f->name = strdup(name);
+    if (f->name == NULL)
+    {
+        return SW_ERR;
+    }
+    s->nfields++;
+    f->type = parse_type(schema, type);
+    return f->type != NULL;
+}
+
+static int parse_fields(thrift_schema *schema, thrift_struct *s, cJSON *fields)
+{
+    cJSON *item, *id, *name, *type;
+
+    cJSON_ArrayForEach(item, fields)
+    {
+        id = cJSON_GetObjectItem(item, "id");
+        name = cJSON_GetObjectItem(item, "name");
+        type = cJSON_GetObjectItem(item, "type");
+        if (!cJSON_IsNumber(id) || id->valueint < 1 || !cJSON_IsString(name) || type == NULL)
+        {
+            fprintf(stderr, "ERROR, thrift field of %s needs an id > 0, a name and a type\n", s->name);
+            return SW_ERR;
+        }
+        if (!add_field(schema, s, id->valueint, name->valuestring, type, cJSON_IsTrue(cJSON_GetObjectItem(item, "required"))))
+        {
+            return SW_ERR;
+        }
+    }
+    return SW_OK;
+}
+
+/* fields are allocated up front, add_field fills them in */
+static int init_struct(thrift_struct *s, const char *name, int nfields)
+{
+    s->name = strdup(name);
+    s->fields = calloc(nfields > 0 ? nfields : 1, sizeof(thrift_field));
+    return s->name && s->fields;
+}
+
+static int parse_method(thrift_schema *schema, thrift_method *m, const char *service, cJSON *def)
+{
+    cJSON *args = cJSON_GetObjectItem(def, "args");
+    cJSON *result = cJSON_GetObjectItem(def, "result");
+    cJSON *throws = cJSON_GetObjectItem(def, "throws");
+    cJSON *protocol = cJSON_GetObjectItem(def, "protocol");
+
+    m->protocol = -1;
+    if (cJSON_IsString(protocol) && strcmp(protocol->valuestring, "binary") == 0)
+    {
+        m->protocol = THRIFT_BINARY;
+    }
+    else if (cJSON_IsString(protocol) && strcmp(protocol->valuestring, "compact") == 0)
+    {
+        m->protocol = THRIFT_COMPACT;
+    }
+    else if (protocol)
+    {
+        fprintf(stderr, "ERROR, unknown thrift protocol for %s.%s\n", service, def->string);
+        return SW_ERR;
+    }
+
+    m->service = strdup(service);
+    m->name = strdup(def->string);
+    if (m->service == NULL || m->name == NULL ||
+        (args && !cJSON_IsArray(args)) || (throws && !cJSON_IsArray(throws)) ||
+        !init_struct(&m->args, def->string, cJSON_GetArraySize(args)) ||
+        !init_struct(&m->result, def->string, 1 + cJSON_GetArraySize(throws)))
+    {
+        fprintf(stderr, "ERROR, invalid thrift method %s.%s\n", service, def->string);
+        return SW_ERR;
+    }
+
+    if (!parse_fields(schema, &m->args, args))
+    {
+        return SW_ERR;
+    }
+    if (result && !(cJSON_IsString(result) && strcmp(result->valuestring, "void") == 0) &&
+        !add_field(schema, &m->result, 0, "success", result, 0))
+    {
+        return SW_ERR;
+    }
+    return parse_fields(schema, &m->result, throws);
+}
+
+static char *read_file(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    char *data = NULL, *p;
+    size_t len = 0, cap = 0, n;
+
+    if (fp == NULL)
+    {
+        return NULL;
+    }
+    for (;;)
+    {
+        if (cap - len < 4096)
+        {
+            cap = cap ? cap * 2 : 65536;
+            p = realloc(data, cap + 1);
+            if (p == NULL)
+            {
+                free(data);
+                fclose(fp);
+                return NULL;
+            }
+            data = p;
+        }
+        n = fread(data + len, 1, cap - len, fp);
+        len += n;
+        if (n == 0)
+        {
+            break;
+        }
+    }
+    fclose(fp);
+    data[len] = 0;
+    return data;
+}
+
+thrift_schema *thrift_schema_load(const char *path)
+{
+    thrift_schema *schema = NULL;
+    char *text;
+    cJSON *root, *structs, *services, *service, *def;
+    int n = 0;
+
+    text = read_file(path);
+    if (text == NULL)
+    {
+        perror("ERROR, fail to read thrift schema");
+        return NULL;
+    }
+    root = cJSON_Parse(text);
+    free(text);
+    if (root == NULL || !cJSON_IsObject(root))
+    {
+        fprintf(stderr, "ERROR, invalid thrift schema JSON in %s\n", path);
+        goto fail;
+    }
+
+    structs = cJSON_GetObjectItem(root, "structs");
+    services = cJSON_GetObjectItem(root, "services");
+    cJSON_ArrayForEach(service, services)
+    {
+        n += cJSON_GetArraySize(service);
+    }
+
+    schema = calloc(1, sizeof(thrift_schema));
+    if (schema == NULL ||
+        (schema->structs = calloc(cJSON_GetArraySize(structs) + 1, sizeof(thrift_struct))) == NULL ||
+        (schema->methods = calloc(n + 1, sizeof(thrift_method))) == NULL)
+    {
+        goto fail;
+    }
+
+    /* every struct is named before any field is parsed, so structs may refer to each other */
+    cJSON_ArrayForEach(def, structs)
+    {
+        if (!cJSON_IsArray(def) || !init_struct(&schema->structs[schema->nstructs++], def->string, cJSON_GetArraySize(def)))
+        {
+            fprintf(stderr, "ERROR, thrift struct %s must be an array of fields\n", def->string);
+            goto fail;
+        }
+    }
+    n = 0;
+    cJSON_ArrayForEach(def, structs)
+    {
+        if (!parse_fields(schema, &schema->structs[n++], def))
+        {
+            goto fail;
+        }
+    }
+
+    cJSON_ArrayForEach(service, services)
+    {
+        cJSON_ArrayForEach(def, service)
+        {
+            if (!parse_method(schema, &schema->methods[schema->nmethods++], service->string, def))
+            {
+                goto fail;
+            }
+        }
+    }
+
+    cJSON_Delete(root);
+    return schema;
+
+fail:
+    cJSON_Delete(root);
+    thrift_schema_free(schema);
+    return NULL;
+}
+
+const thrift_method *thrift_schema_find(const thrift_schema *schema,
+                                        const char *service, int32_t service_len,
+                                        const char *method, int32_t method_len)
+{
+    int i;
+    const thrift_method *m;
+
+    for (i = 0; i < schema->nmethods; i++)
+    {
+        m = &schema->methods[i];
+        /* the names come from the wire and may hold NULs, compare lengths first */
+        if ((int32_t)strlen(m->name) == method_len && memcmp(m->name, method, method_len) == 0 &&
+            (int32_t)strlen(m->service) == service_len && memcmp(m->service, service, service_len) == 0)
+        {
+            return m;
+        }
+    }
+    return NULL;
+}
+
+static int encode_error(const char *name, const char *expect)
+{
+    fprintf(stderr, "ERROR, thrift field %s: expected %s\n", name, expect);
+    return SW_ERR;
+}
+
+/* numbers, or strings for i64 values a double can not hold exactly */
+static int json_integer(cJSON *v, int64_t min, int64_t max, int64_t *out)
+{
+    char *end;
+    double d;
+
+    if (cJSON_IsNumber(v))
+    {
+        d = v->valuedouble;
+        if (!(d >= -9223372036854775808.0 && d < 9223372036854775808.0) || (double)(int64_t)d != d)
+        {
+            return SW_ERR;
+        }
+        *out = (int64_t)d;
+    }
+    else if (cJSON_IsString(v))
+    {
+        errno = 0;
+        *out = strtoll(v->valuestring, &end, 10);
+        if (end == v->valuestring || *end || errno)
+        {
+            return SW_ERR;
+        }
+    }
+    else
+    {
+        return SW_ERR;
+    }
+    return *out >= min && *out <= max;
+}
+
+static int encode_struct(thrift_writer *w, const thrift_struct *s, cJSON *obj, int depth);
+
+static int encode_value(thrift_writer *w, const thrift_type *t, cJSON *v, const char *name, int depth)
+{
+    cJSON *parsed = NULL, *item, key;
+    int64_t iv;
+    double d;
+    char *end;
+    int ret = SW_OK;
+
+    if (depth > THRIFT_MAX_DEPTH)
+    {
+        return encode_error(name, "less nesting");
+    }
+
+    // 泛化参数里嵌套的值被打包成了JSON字符串, 按schema期望的类型解开
+    if (cJSON_IsString(v) && t->ttype >= TYPE_STRUCT && (parsed = cJSON_Parse(v->valuestring)))
+    {
+        v = parsed;
+    }
+
+    switch (t->ttype)
+    {
+    case TYPE_BOOL:
+        if (cJSON_IsBool(v))
+        {
+            thrift_write_bool(w, cJSON_IsTrue(v));
+        }
+        else if (cJSON_IsString(v) && (strcmp(v->valuestring, "true") == 0 || strcmp(v->valuestring, "false") == 0))
+        {
+            thrift_write_bool(w, v->valuestring[0] == 't');
+        }
+        else
+        {
+            ret = encode_error(name, "bool");
+        }
+        break;
+    case TYPE_BYTE:
+        if ((ret = json_integer(v, INT8_MIN, INT8_MAX, &iv)))
+        {
+            thrift_write_byte(w, (int8_t)iv);
+        }
+        else
+        {
+            encode_error(name, "byte");
+        }
+        break;
+    case TYPE_I16:
+        if ((ret = json_integer(v, INT16_MIN, INT16_MAX, &iv)))
+        {
+            thrift_write_i16(w, (int16_t)iv);
+        }
+        else
+        {
+            encode_error(name, "i16");
+        }
+        break;
+    case TYPE_I32:
+        if ((ret = json_integer(v, INT32_MIN, INT32_MAX, &iv)))
+        {
+            thrift_write_i32(w, (int32_t)iv);
+        }
+        else
+        {
+            encode_error(name, "i32");
+        }
+        break;
+    case TYPE_I64:
+        if ((ret = json_integer(v, INT64_MIN, INT64_MAX, &iv)))
+        {
+            thrift_write_i64(w, iv);
+        }
+        else
+        {
+            encode_error(name, "i64");
+        }
+        break;
+    case TYPE_DOUBLE:
+        if (cJSON_IsNumber(v))
+        {
+            thrift_write_double(w, v->valuedouble);
+        }
+        else if (cJSON_IsString(v) && (d = strtod(v->valuestring, &end), end != v->valuestring && *end == 0))
+        {
+            thrift_write_double(w, d);
+        }
+        else
+        {
+            ret = encode_error(name, "double");
+        }
+        break;
+    case TYPE_STRING:
+        if (cJSON_IsString(v))
+        {
+            thrift_write_string(w, v->valuestring, strlen(v->valuestring));
+        }
+        else
+        {
+            ret = encode_error(name, "string");
+        }
+        break;
+    case TYPE_STRUCT:
+        ret = encode_struct(w, t->sdef, v, depth + 1);
+        break;
+    case TYPE_SET:
+    case TYPE_LIST:
+        if (!cJSON_IsArray(v))
+        {
+            ret = encode_error(name, "array");
+            break;
+        }
+        thrift_write_list_begin(w, t->elem->ttype, cJSON_GetArraySize(v));
+        cJSON_ArrayForEach(item, v)
+        {
+            if (!(ret = encode_value(w, t->elem, item, name, depth + 1)))
+            {
+                break;
+            }
+        }
+        break;
+    case TYPE_MAP:
+        if (!cJSON_IsObject(v))
+        {
+            ret = encode_error(name, "object");
+            break;
+        }
+        thrift_write_map_begin(w, t->key->ttype, t->elem->ttype, cJSON_GetArraySize(v));
+        cJSON_ArrayForEach(item, v)
+        {
+            /* JSON keys are strings, converted like string values of the key type */
+            memset(&key, 0, sizeof(key));
+            key.type = cJSON_String;
+            key.valuestring = item->string;
+            if (!(ret = encode_value(w, t->key, &key, name, depth + 1) && encode_value(w, t->elem, item, name, depth + 1)))
+            {
+                break;
+            }
+        }
+        break;
+    default:
+        ret = SW_ERR;
+        break;
+    }
+
+    cJSON_Delete(parsed);
+    return ret;
+}
+
+/* an object keyed by field name, or an array in field order */
+static int encode_struct(thrift_writer *w, const thrift_struct *s, cJSON *obj, int depth)
+{
+    const thrift_field *f;
+    cJSON *v, *item;
+    int i;
+
+    if (!cJSON_IsObject(obj) && !cJSON_IsArray(obj))
+    {
+        return encode_error(s->name, "object");
+    }
+    if (cJSON_IsArray(obj) && cJSON_GetArraySize(obj) > s->nfields)
+    {
+        return encode_error(s->name, "no more values than fields");
+    }
+
+    thrift_write_struct_begin(w);
+    v = cJSON_IsArray(obj) ? obj->child : NULL;
+    for (i = 0; i < s->nfields; i++)
+    {
+        f = &s->fields[i];
+        item = cJSON_IsArray(obj) ? v : cJSON_GetObjectItemCaseSensitive(obj, f->name);
+        if (v)
+        {
+            v = v->next;
+        }
+        if (item == NULL || cJSON_IsNull(item))
+        {
+            if (f->required)
+            {
+                fprintf(stderr, "ERROR, missing required thrift field %s.%s\n", s->name, f->name);
+                return SW_ERR;
+            }
+            continue;
+        }
+        thrift_write_field_begin(w, f->type->ttype, f->id);
+        if (!encode_value(w, f->type, item, f->name, depth))
+        {
+            return SW_ERR;
+        }
+    }
+
+    if (cJSON_IsObject(obj))
+    {
+        /* a misspelled argument would otherwise be dropped silently */
+        cJSON_ArrayForEach(item, obj)
+        {
+            if (struct_field_by_name(s, item->string) == NULL)
+            {
+                fprintf(stderr, "ERROR, unknown thrift field %s.%s\n", s->name, item->string);
+                return SW_ERR;
+            }
+        }
+    }
+
+    thrift_write_struct_end(w);
+    return SW_OK;
+}
+
+int thrift_encode_call(thrift_writer *w, const thrift_method *m, int32_t seq, const char *json_args)
+{
+    cJSON *args = cJSON_Parse(json_args);
+    int ret;
+
+    if (args == NULL || (!cJSON_IsObject(args) && !cJSON_IsArray(args)))
+    {
+        fprintf(stderr, "ERROR, invalid arguments JSON for %s.%s\n", m->service, m->name);
+        cJSON_Delete(args);
+        return SW_ERR;
+    }
+
+    thrift_write_message_begin(w, m->name, strlen(m->name), T_CALL, seq);
+    ret = encode_struct(w, &m->args, args, 0);
+    cJSON_Delete(args);
+    return ret && !w->error;
+}
+
+static cJSON *decode_struct(thrift_reader *r, const thrift_struct *s, int depth);
+
+/* a NUL terminated copy for cJSON */
+static char *reader_strdup(thrift_reader *r)
+{
+    const char *str;
+    int32_t len;
+    char *copy;
+
+    if (!thrift_read_string(r, &str, &len) || (copy = malloc(len + 1)) == NULL)
+    {
+        return NULL;
+    }
+    memcpy(copy, str, len);
+    copy[len] = 0;
+    return copy;
+}
+
+static cJSON *decode_value(thrift_reader *r, const thrift_type *t, int depth)
+{
+    cJSON *v = NULL, *item;
+    char num[24];
+    char *str, *json;
+    int b, elem_type, key_type, ok;
+    int8_t i8;
+    int16_t i16;
+    int32_t i32, size, i;
+    int64_t i64;
+    double d;
+
+    if (depth > THRIFT_MAX_DEPTH)
+    {
+        return NULL;
+    }
+
+    switch (t->ttype)
+    {
+    case TYPE_BOOL:
+        return thrift_read_bool(r, &b) ? cJSON_CreateBool(b) : NULL;
+    case TYPE_BYTE:
+        return thrift_read_byte(r, &i8) ? cJSON_CreateNumber(i8) : NULL;
+    case TYPE_I16:
+        return thrift_read_i16(r, &i16) ? cJSON_CreateNumber(i16) : NULL;
+    case TYPE_I32:
+        return thrift_read_i32(r, &i32) ? cJSON_CreateNumber(i32) : NULL;
+    case TYPE_I64:
+        /* printed exactly, a double would round above 2^53 */
+        if (!thrift_read_i64(r, &i64))
+        {
+            return NULL;
+        }
+        snprintf(num, sizeof(num), "%lld", (long long)i64);
+        return cJSON_CreateRaw(num);
+    case TYPE_DOUBLE:
+        return thrift_read_double(r, &d) ? cJSON_CreateNumber(d) : NULL;
+    case TYPE_STRING:
+        if ((str = reader_strdup(r)) == NULL)
+        {
+            return NULL;
+        }
+        v = cJSON_CreateString(str);
+        free(str);
+        return v;
+    case TYPE_STRUCT:
+        return decode_struct(r, t->sdef, depth + 1);
+    case TYPE_SET:
+    case TYPE_LIST:
+        if (!thrift_read_list_begin(r, &elem_type, &size) || elem_type != t->elem->ttype || (v = cJSON_CreateArray()) == NULL)
+        {
+            return NULL;
+        }
+        for (i = 0; i < size; i++)
+        {
+            if ((item = decode_value(r, t->elem, depth + 1)) == NULL)
+            {
+                cJSON_Delete(v);
+                return NULL;
+            }
+            cJSON_AddItemToArray(v, item);
+        }
+        return v;
+    case TYPE_MAP:
+        if (!thrift_read_map_begin(r, &key_type, &elem_type, &size) ||
+            (size > 0 && (key_type != t->key->ttype || elem_type != t->elem->ttype)) ||
+            (v = cJSON_CreateObject()) == NULL)
+        {
+            return NULL;
+        }
+        for (i = 0; i < size; i++)
+        {
+            /* JSON keys are strings, other key types are printed */
+            if (t->key->ttype == TYPE_STRING)
+            {
+                str = reader_strdup(r);
+            }
+            else
+            {
+                item = decode_value(r, t->key, depth + 1);
+                json = item ? cJSON_PrintUnformatted(item) : NULL;
+                str = json ? strdup(json) : NULL;
+                cJSON_free(json);
+                cJSON_Delete(item);
+            }
+            item = str ? decode_value(r, t->elem, depth + 1) : NULL;
+            ok = item != NULL;
+            if (ok)
+            {
+                cJSON_AddItemToObject(v, str, item);
+            }
+            free(str);
+            if (!ok)
+            {
+                cJSON_Delete(v);
+                return NULL;
+            }
+        }
+        return v;
+    default:
+        return NULL;
+    }
+}
+
+/* fields the schema does not know or types it disagrees with are skipped, as thrift does */
+static cJSON *decode_struct(thrift_reader *r, const thrift_struct *s, int depth)
+{
+    cJSON *obj = thrift_read_struct_begin(r) ? cJSON_CreateObject() : NULL;
+    cJSON *v;
+    const thrift_field *f;
+    int type;
+    int16_t id;
+
+    while (obj)
+    {
+        if (!thrift_read_field_begin(r, &type, &id))
+        {
+            break;
+        }
+        if (type == FIELD_STOP)
+        {
+            if (!thrift_read_struct_end(r))
+            {
+                break;
+            }
+            return obj;
+        }
+        f = struct_field_by_id(s, id);
+        if (f == NULL || f->type->ttype != type)
+        {
+            if (!thrift_skip(r, type, depth))
+            {
+                break;
+            }
+            continue;
+        }
+        if ((v = decode_value(r, f->type, depth)) == NULL)
+        {
+            break;
+        }
+        cJSON_AddItemToObject(obj, f->name, v);
+    }
+    cJSON_Delete(obj);
+    return NULL;
+}
+
+int thrift_decode_reply(const thrift_method *m, const char *buf, int32_t len, char **out_json)
+{
+    thrift_reader r;
+    const char *name;
+    int32_t name_len, seq;
+    int type;
+    int16_t id;
+    cJSON *root, *errors = NULL, *v;
+    const thrift_field *f;
+    char *json;
+    int found = 0;
+    nova_json_mark mark;
+
+    thrift_reader_init(&r, buf, len);
+    if (!thrift_read_message_begin(&r, &name, &name_len, &type, &seq))
+    {
+        fprintf(stderr, "ERROR, invalid thrift reply of %s.%s\n", m->service, m->name);
+        return 0;
+    }
+    if (type == T_EX)
+    {
+        fprintf(stderr, "unexpected thrift exception response\n");
+        return 0;
+    }
+
+    /* the reply tree is built in an arena scope, only its printed copy outlives it */
+    mark = nova_json_arena_begin();
+    root = thrift_read_struct_begin(&r) ? cJSON_CreateObject() : NULL;
+    while (root)
+    {
+        if (!thrift_read_field_begin(&r, &type, &id))
+        {
+            goto fail;
+        }
+        if (type == FIELD_STOP)
+        {
+            break;
+        }
+        f = struct_field_by_id(&m->result, id);
+        if (f == NULL || f->type->ttype != type)
+        {
+            if (!thrift_skip(&r, type, 0))
+            {
+                goto fail;
+            }
+            continue;
+        }
+        if ((v = decode_value(&r, f->type, 0)) == NULL)
+        {
+            goto fail;
+        }
+        found = 1;
+        if (f->id == 0)
+        {
+            cJSON_AddItemToObject(root, "response", v);
+        }
+        else
+        {
+            // 声明的异常按字段名放进error_response, 与泛化调用的错误响应同形
+            if (errors == NULL)
+            {
+                errors = cJSON_CreateObject();
+                cJSON_AddItemToObject(root, "error_response", errors);
+            }
+            cJSON_AddItemToObject(errors, f->name, v);
+        }
+    }
+    if (root == NULL)
+    {
+        nova_json_arena_end(mark);
+        return 0;
+    }
+
+    if (!found)
+    {
+        if (m->result.nfields > 0 && m->result.fields[0].id == 0)
+        {
+            fprintf(stderr, "ERROR, %s.%s replied without a result\n", m->service, m->name);
+            goto fail;
+        }
+        cJSON_AddNullToObject(root, "response");
+    }
+
+    /* resp->json is released with free */
+    json = cJSON_PrintUnformatted(root);
+    *out_json = json ? strdup(json) : NULL;
+    nova_json_arena_end(mark);
+    return *out_json ? strlen(*out_json) : 0;
+
+fail:
+    fprintf(stderr, "ERROR, fail to decode thrift reply of %s.%s\n", m->service, m->name);
+    nova_json_arena_end(mark);
+    return 0;
+}
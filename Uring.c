@@ -0,0 +1,246 @@
+#include "uring.h"
+
+#ifdef NOVA_HAVE_URING
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+
+#include "binarydata.h"
+
+#define smp_load_acquire(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define smp_store_release(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void *arg, size_t argsz)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+int nova_uring_init(nova_uring *ring, unsigned entries)
+{
+    struct io_uring_params p;
+    char *sq, *cq;
+
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+    ring->fd = sys_io_uring_setup(entries, &p);
+    if (ring->fd < 0 && errno == EINVAL)
+    {
+        /* older kernels reject the flags, they are only hints */
+        memset(&p, 0, sizeof(p));
+        ring->fd = sys_io_uring_setup(entries, &p);
+    }
+    if (ring->fd < 0)
+    {
+        return SW_ERR;
+    }
+
+    ring->features = p.features;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_EXT_ARG) || !(p.features & IORING_FEAT_NODROP))
+    {
+        goto fail;
+    }
+
+    ring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (ring->cq_ring_size > ring->sq_ring_size)
+    {
+        ring->sq_ring_size = ring->cq_ring_size;
+    }
+    ring->cq_ring_size = 0; /* single mmap shared with the sq ring */
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED)
+    {
+        ring->sq_ring = NULL;
+        goto fail;
+    }
+    ring->cq_ring = ring->sq_ring;
+
+    ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        ring->sqes = NULL;
+        goto fail;
+    }
+
+    sq = ring->sq_ring;
+    ring->sq_head = (unsigned *)(sq + p.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    ring->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + p.sq_off.array);
+    ring->sq_local_tail = *ring->sq_tail;
+
+    cq = ring->cq_ring;
+    ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    ring->cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    return SW_OK;
+
+fail:
+    nova_uring_exit(ring);
+    return SW_ERR;
+}
+
+void nova_uring_exit(nova_uring *ring)
+{
+    /* closing the ring cancels whatever is still in flight before the memory goes */
+    if (ring->fd >= 0)
+    {
+        close(ring->fd);
+        ring->fd = -1;
+    }
+    if (ring->br)
+    {
+        munmap(ring->br, ring->br_size);
+        ring->br = NULL;
+    }
+    free(ring->br_bufs);
+    ring->br_bufs = NULL;
+    if (ring->sqes)
+    {
+        munmap(ring->sqes, ring->sqes_size);
+        ring->sqes = NULL;
+    }
+    if (ring->sq_ring)
+    {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+        ring->sq_ring = NULL;
+    }
+}
+
+int nova_uring_setup_buffers(nova_uring *ring, unsigned entries, unsigned buf_size)
+{
+    struct io_uring_buf_reg reg;
+    unsigned i;
+
+    ring->br_size = entries * sizeof(struct io_uring_buf);
+    ring->br = mmap(NULL, ring->br_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->br == MAP_FAILED)
+    {
+        ring->br = NULL;
+        return SW_ERR;
+    }
+    ring->br_bufs = malloc((size_t)entries * buf_size);
+    if (ring->br_bufs == NULL)
+    {
+        return SW_ERR;
+    }
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring->br;
+    reg.ring_entries = entries;
+    reg.bgid = 0;
+    if (sys_io_uring_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        return SW_ERR;
+    }
+
+    ring->br_entries = entries;
+    ring->br_buf_size = buf_size;
+    ring->br_tail = 0;
+    for (i = 0; i < entries; i++)
+    {
+        nova_uring_recycle(ring, i);
+    }
+    return SW_OK;
+}
+
+char *nova_uring_buffer(nova_uring *ring, unsigned bid)
+{
+    return ring->br_bufs + (size_t)bid * ring->br_buf_size;
+}
+
+void nova_uring_recycle(nova_uring *ring, unsigned bid)
+{
+    struct io_uring_buf *buf = &ring->br->bufs[ring->br_tail & (ring->br_entries - 1)];
+
+    buf->addr = (uint64_t)(uintptr_t)nova_uring_buffer(ring, bid);
+    buf->len = ring->br_buf_size;
+    buf->bid = (uint16_t)bid;
+    ring->br_tail++;
+    smp_store_release(&ring->br->tail, ring->br_tail);
+}
+
+struct io_uring_sqe *nova_uring_get_sqe(nova_uring *ring)
+{
+    struct io_uring_sqe *sqe;
+    unsigned head = smp_load_acquire(ring->sq_head);
+
+    if (ring->sq_local_tail - head > ring->sq_mask)
+    {
+        return NULL;
+    }
+    sqe = &ring->sqes[ring->sq_local_tail & ring->sq_mask];
+    ring->sq_array[ring->sq_local_tail & ring->sq_mask] = ring->sq_local_tail & ring->sq_mask;
+    ring->sq_local_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int nova_uring_submit(nova_uring *ring, unsigned wait_nr, int timeout_ms)
+{
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    unsigned to_submit = nova_uring_pending(ring);
+    unsigned flags = IORING_ENTER_EXT_ARG;
+    int ret;
+
+    smp_store_release(ring->sq_tail, ring->sq_local_tail);
+
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    if (wait_nr > 0)
+    {
+        flags |= IORING_ENTER_GETEVENTS;
+        if (timeout_ms >= 0)
+        {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+        }
+    }
+
+    ret = sys_io_uring_enter(ring->fd, to_submit, wait_nr, flags, &arg, sizeof(arg));
+    return ret < 0 ? -errno : ret;
+}
+
+struct io_uring_cqe *nova_uring_peek_cqe(nova_uring *ring)
+{
+    unsigned head = *ring->cq_head;
+
+    if (head == smp_load_acquire(ring->cq_tail))
+    {
+        return NULL;
+    }
+    return &ring->cqes[head & ring->cq_mask];
+}
+
+void nova_uring_cqe_seen(nova_uring *ring)
+{
+    smp_store_release(ring->cq_head, *ring->cq_head + 1);
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include <stdio.h>
+#include "client.h"
+
+/**
+ *  run every JSONL request of in over shared connections of cli->pool,
+ *  one line per call: {"method":"service.method","args":{...},"attach":{...}}
+ *
+ *  results are written to out as NDJSON in completion order, each record carries
+ *  the input line number: {"line":1,"ok":true,"response":{...}} or {"line":2,"ok":false,"error":"timeout"}
+ *
+ *  @param concurrency max calls in flight
+ *  @param backend     NOVA_ENGINE_EPOLL or NOVA_ENGINE_URING
+ *
+ *  @return SW_OK when every call succeeded
+ */
+int nova_batch_run(nova_client *cli, FILE *in, FILE *out, int concurrency, int backend);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stdio.h>
+#include "client.h"
+
+typedef struct nova_bench_opts
+{
+    int concurrency; /* max calls in flight */
+    long requests;   /* stop after requests calls, 0 for no limit */
+    int duration;    /* seconds, 0 for no limit */
+    int rate;        /* target calls per second, 0 runs closed loop */
+    int backend;     /* NOVA_ENGINE_EPOLL or NOVA_ENGINE_URING */
+    const char *hist_path; /* save the latency histogram for nova_hist_load, NULL to skip */
+} nova_bench_opts;
+
+/**
+ *  repeat one call, typed when cli->schema describes it, from a single precomputed frame and print throughput,
+ *  error counts and latency percentiles to out, at least one of requests and duration must be set
+ *
+ *  @return SW_OK when every call succeeded
+ */
+int nova_bench_run(nova_client *cli,
+                   const char *service, const char *method,
+                   const char *json_args, const char *json_attach,
+                   const nova_bench_opts *opts, FILE *out);
+
+#endif
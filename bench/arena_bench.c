@@ -0,0 +1,125 @@
+/*
+ * cJSON 解析加释放的吞吐: 同一批文档分别走
+ *   malloc  cJSON_Parse 后 cJSON_Delete, 每个节点一次 malloc/free
+ *   arena   nova_json_arena_begin 内 cJSON_Parse, 作用域结束一次收回, 不遍历树
+ *   delete  作用域内仍然 cJSON_Delete, 只省下 malloc/free 本身
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cJSON.h"
+#include "jsonarena.h"
+
+#define MIN_BYTES (64 * 1024 * 1024) /* 每种文档至少解析这么多字节 */
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* a list page like the ones generic services answer with, items objects of a few fields */
+static char *make_doc(int items)
+{
+    size_t cap = 256 + (size_t)items * 160;
+    char *doc = malloc(cap);
+    size_t len = 0;
+    int i;
+
+    len += sprintf(doc + len, "{\"code\":200,\"message\":\"ok\",\"data\":{\"total\":%d,\"list\":[", items);
+    for (i = 0; i < items; i++)
+    {
+        len += sprintf(doc + len, "%s{\"id\":%d,\"kdtId\":%d,\"title\":\"item %d\",\"price\":%d.%02d,"
+                                  "\"tags\":[\"new\",\"hot\"],\"soldOut\":%s}",
+                       i ? "," : "", 100000 + i, 42, i, i * 3, i % 100, i % 7 ? "false" : "true");
+    }
+    sprintf(doc + len, "]}}");
+    return doc;
+}
+
+static int parse_malloc(const char *doc)
+{
+    cJSON *root = cJSON_Parse(doc);
+    int ok = root != NULL;
+
+    cJSON_Delete(root);
+    return ok;
+}
+
+static int parse_arena(const char *doc)
+{
+    nova_json_mark mark = nova_json_arena_begin();
+    int ok = cJSON_Parse(doc) != NULL;
+
+    nova_json_arena_end(mark);
+    return ok;
+}
+
+static int parse_arena_delete(const char *doc)
+{
+    nova_json_mark mark = nova_json_arena_begin();
+    cJSON *root = cJSON_Parse(doc);
+    int ok = root != NULL;
+
+    cJSON_Delete(root);
+    nova_json_arena_end(mark);
+    return ok;
+}
+
+static double run(int (*fn)(const char *), const char *doc, size_t len)
+{
+    long rounds = MIN_BYTES / len + 1;
+    double start;
+    long r;
+
+    fn(doc);
+    start = now_ns();
+    for (r = 0; r < rounds; r++)
+    {
+        if (!fn(doc))
+        {
+            fprintf(stderr, "ERROR, fail to parse\n");
+            exit(1);
+        }
+    }
+    return (now_ns() - start) / rounds;
+}
+
+static void report(const char *name, double ns, size_t len, double base)
+{
+    printf("  %-8s %10.1f us/doc %8.1f MB/s  x%.2f\n", name, ns / 1e3, len * 1e3 / ns, base / ns);
+}
+
+int main()
+{
+    static const int items[] = {10, 500, 20000};
+    enum { DOCS = sizeof(items) / sizeof(items[0]) };
+    char *docs[DOCS];
+    size_t lens[DOCS];
+    double plain[DOCS];
+    int i;
+
+    for (i = 0; i < DOCS; i++)
+    {
+        docs[i] = make_doc(items[i]);
+        lens[i] = strlen(docs[i]);
+    }
+
+    // malloc 必须先跑: 钩子在第一个作用域装上后就不再卸下
+    for (i = 0; i < DOCS; i++)
+    {
+        plain[i] = run(parse_malloc, docs[i], lens[i]);
+    }
+    for (i = 0; i < DOCS; i++)
+    {
+        printf("arena: %d items, %zu bytes\n", items[i], lens[i]);
+        report("malloc", plain[i], lens[i], plain[i]);
+        report("arena", run(parse_arena, docs[i], lens[i]), lens[i], plain[i]);
+        report("delete", run(parse_arena_delete, docs[i], lens[i]), lens[i], plain[i]);
+        free(docs[i]);
+    }
+    return 0;
+}
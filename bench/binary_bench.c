@@ -0,0 +1,248 @@
+/*
+ * 定长整数读写的微基准: 在nova包头的各字段上比较
+ *   shift  逐字节移位拼装, BinaryData.c 内联化之前的实现
+ *   call   BinaryData.c 导出的函数, 不内联
+ *   inline binarydata.h 的内联版本, 代码里实际走的路径
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "binarydata.h"
+
+#define HEADERS 1024
+#define HEADER_SIZE 64
+#define ROUNDS 20000
+
+/* 包头定长字段的偏移, service 与 method 各占 4 字节长度加 8 字节内容 */
+#define OFF_MSG_SIZE 0
+#define OFF_MAGIC 4
+#define OFF_HEAD_SIZE 6
+#define OFF_VERSION 8
+#define OFF_IP 9
+#define OFF_PORT 13
+#define OFF_SEQ_NO 41
+
+static uchar frames[HEADERS][HEADER_SIZE];
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int32_t shift_i32(const uchar *p)
+{
+    return (int32_t)(((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]);
+}
+
+static uint16_t shift_u16(const uchar *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static int64_t shift_i64(const uchar *p)
+{
+    return (int64_t)(((uint64_t)(uint32_t)shift_i32(p) << 32) | (uint32_t)shift_i32(p + 4));
+}
+
+static void shift_w32(uchar *p, uint32_t v)
+{
+    p[0] = (uchar)(v >> 24);
+    p[1] = (uchar)(v >> 16);
+    p[2] = (uchar)(v >> 8);
+    p[3] = (uchar)v;
+}
+
+static void shift_w16(uchar *p, uint16_t v)
+{
+    p[0] = (uchar)(v >> 8);
+    p[1] = (uchar)v;
+}
+
+static void shift_w64(uchar *p, uint64_t v)
+{
+    shift_w32(p, (uint32_t)(v >> 32));
+    shift_w32(p + 4, (uint32_t)v);
+}
+
+static uint64_t decode_shift()
+{
+    uint64_t sum = 0;
+    int i;
+
+    for (i = 0; i < HEADERS; i++)
+    {
+        const uchar *p = frames[i];
+        sum += (uint32_t)shift_i32(p + OFF_MSG_SIZE);
+        sum += shift_u16(p + OFF_MAGIC);
+        sum += (uint16_t)shift_u16(p + OFF_HEAD_SIZE);
+        sum += p[OFF_VERSION];
+        sum += (uint32_t)shift_i32(p + OFF_IP);
+        sum += (uint32_t)shift_i32(p + OFF_PORT);
+        sum += (uint64_t)shift_i64(p + OFF_SEQ_NO);
+    }
+    return sum;
+}
+
+static uint64_t decode_call()
+{
+    uint64_t sum = 0;
+    int32_t msg_size;
+    uint16_t magic;
+    int16_t head_size;
+    char version;
+    uint32_t ip, port;
+    int64_t seq_no;
+    int i;
+
+    for (i = 0; i < HEADERS; i++)
+    {
+        const uchar *p = frames[i];
+        (swReadI32)(p + OFF_MSG_SIZE, &msg_size);
+        (swReadU16)(p + OFF_MAGIC, &magic);
+        (swReadI16)(p + OFF_HEAD_SIZE, &head_size);
+        (swReadByte)(p + OFF_VERSION, &version);
+        (swReadU32)(p + OFF_IP, &ip);
+        (swReadU32)(p + OFF_PORT, &port);
+        (swReadI64)(p + OFF_SEQ_NO, &seq_no);
+        sum += (uint64_t)(uint32_t)msg_size + magic + (uint16_t)head_size + (uchar)version + ip + port + (uint64_t)seq_no;
+    }
+    return sum;
+}
+
+static uint64_t decode_inline()
+{
+    uint64_t sum = 0;
+    int32_t msg_size;
+    uint16_t magic;
+    int16_t head_size;
+    char version;
+    uint32_t ip, port;
+    int64_t seq_no;
+    int i;
+
+    for (i = 0; i < HEADERS; i++)
+    {
+        const uchar *p = frames[i];
+        swReadI32(p + OFF_MSG_SIZE, &msg_size);
+        swReadU16(p + OFF_MAGIC, &magic);
+        swReadI16(p + OFF_HEAD_SIZE, &head_size);
+        swReadByte(p + OFF_VERSION, &version);
+        swReadU32(p + OFF_IP, &ip);
+        swReadU32(p + OFF_PORT, &port);
+        swReadI64(p + OFF_SEQ_NO, &seq_no);
+        sum += (uint64_t)(uint32_t)msg_size + magic + (uint16_t)head_size + (uchar)version + ip + port + (uint64_t)seq_no;
+    }
+    return sum;
+}
+
+static uint64_t encode_shift()
+{
+    int i;
+
+    for (i = 0; i < HEADERS; i++)
+    {
+        uchar *p = frames[i];
+        shift_w32(p + OFF_MSG_SIZE, 100 + i);
+        shift_w16(p + OFF_MAGIC, 0xdabc);
+        shift_w16(p + OFF_HEAD_SIZE, 90 + i);
+        p[OFF_VERSION] = 1;
+        shift_w32(p + OFF_IP, 0x7f000001 + i);
+        shift_w32(p + OFF_PORT, 8050);
+        shift_w64(p + OFF_SEQ_NO, (uint64_t)i << 33 | i);
+    }
+    return frames[HEADERS - 1][OFF_SEQ_NO + 7];
+}
+
+static uint64_t encode_call()
+{
+    int i;
+
+    for (i = 0; i < HEADERS; i++)
+    {
+        uchar *p = frames[i];
+        (swWriteI32)(p + OFF_MSG_SIZE, 100 + i);
+        (swWriteU16)(p + OFF_MAGIC, 0xdabc);
+        (swWriteI16)(p + OFF_HEAD_SIZE, 90 + i);
+        (swWriteByte)(p + OFF_VERSION, 1);
+        (swWriteU32)(p + OFF_IP, 0x7f000001 + i);
+        (swWriteU32)(p + OFF_PORT, 8050);
+        (swWriteI64)(p + OFF_SEQ_NO, (int64_t)((uint64_t)i << 33 | i));
+    }
+    return frames[HEADERS - 1][OFF_SEQ_NO + 7];
+}
+
+static uint64_t encode_inline()
+{
+    int i;
+
+    for (i = 0; i < HEADERS; i++)
+    {
+        uchar *p = frames[i];
+        swWriteI32(p + OFF_MSG_SIZE, 100 + i);
+        swWriteU16(p + OFF_MAGIC, 0xdabc);
+        swWriteI16(p + OFF_HEAD_SIZE, 90 + i);
+        swWriteByte(p + OFF_VERSION, 1);
+        swWriteU32(p + OFF_IP, 0x7f000001 + i);
+        swWriteU32(p + OFF_PORT, 8050);
+        swWriteI64(p + OFF_SEQ_NO, (int64_t)((uint64_t)i << 33 | i));
+    }
+    return frames[HEADERS - 1][OFF_SEQ_NO + 7];
+}
+
+static uint64_t run(const char *name, uint64_t (*fn)())
+{
+    uint64_t sum = 0;
+    double start;
+    int r;
+
+    fn();
+    start = now_ns();
+    for (r = 0; r < ROUNDS; r++)
+    {
+        sum += fn();
+    }
+    printf("  %-14s %6.2f ns/header\n", name, (now_ns() - start) / ((double)ROUNDS * HEADERS));
+    return sum;
+}
+
+int main()
+{
+    uint64_t shift, call, inl;
+    int i, j;
+
+    srand(1);
+    for (i = 0; i < HEADERS; i++)
+    {
+        for (j = 0; j < HEADER_SIZE; j++)
+        {
+            frames[i][j] = (uchar)rand();
+        }
+    }
+
+    printf("binarydata: %d nova headers x %d rounds\n", HEADERS, ROUNDS);
+    shift = run("decode shift", decode_shift);
+    call = run("decode call", decode_call);
+    inl = run("decode inline", decode_inline);
+    if (shift != call || call != inl)
+    {
+        fprintf(stderr, "ERROR, decoders disagree\n");
+        return 1;
+    }
+
+    run("encode shift", encode_shift);
+    shift = decode_inline();
+    run("encode call", encode_call);
+    call = decode_inline();
+    run("encode inline", encode_inline);
+    inl = decode_inline();
+    if (shift != call || call != inl)
+    {
+        fprintf(stderr, "ERROR, encoders disagree\n");
+        return 1;
+    }
+    return 0;
+}
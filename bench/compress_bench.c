@@ -0,0 +1,199 @@
+/*
+ * 压缩的CPU与省下的字节对比: 每种载荷给出压缩率, 压缩与解压耗时,
+ * 以及原文与压缩后在本机回环TCP上传输的耗时. 压缩+解压+发送压缩后数据
+ * 比直接发送原文还慢时, 回环上压缩就不划算
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "compress.h"
+#include "nova.h"
+
+#define CHUNK (64 * 1024)
+#define ROUNDS 200
+
+static double now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* 一条本机TCP连接, 两端都在本进程 */
+static int loopback(int *tx, int *rx)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int one = 1;
+    int lfd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (lfd < 0 || bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(lfd, 1) < 0 ||
+        getsockname(lfd, (struct sockaddr *)&addr, &len) < 0)
+    {
+        return SW_ERR;
+    }
+    *tx = socket(AF_INET, SOCK_STREAM, 0);
+    if (*tx < 0 || connect(*tx, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        return SW_ERR;
+    }
+    *rx = accept(lfd, NULL, NULL);
+    close(lfd);
+    setsockopt(*tx, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return *rx >= 0;
+}
+
+/* 分块发送再收回, 每块都小于socket缓冲区, 单线程不会阻塞 */
+static double transfer_us(int tx, int rx, const char *data, int32_t len)
+{
+    static char sink[CHUNK];
+    double start = now_us();
+    int32_t off, n, got;
+    ssize_t ret;
+
+    for (off = 0; off < len; off += n)
+    {
+        n = len - off < CHUNK ? len - off : CHUNK;
+        if (send(tx, data + off, n, 0) != n)
+        {
+            return -1;
+        }
+        for (got = 0; got < n; got += ret)
+        {
+            ret = recv(rx, sink, n - got, 0);
+            if (ret <= 0)
+            {
+                return -1;
+            }
+        }
+    }
+    return now_us() - start;
+}
+
+/* 与 GenericService 列表接口相似的回包 */
+static char *media_list(int items)
+{
+    char *json = malloc(items * 160 + 64);
+    int off = sprintf(json, "{\"list\": [");
+    int i;
+
+    for (i = 0; i < items; i++)
+    {
+        off += sprintf(json + off, "%s{\"id\": %d, \"title\": \"media %d\", \"url\": \"https://img.example.com/m/%d.jpg\", "
+                                   "\"categoryId\": 2, \"createdAt\": \"2026-01-01 00:00:00\"}",
+                       i ? ", " : "", i, i, i);
+    }
+    sprintf(json + off, "], \"total\": %d}", items);
+    return json;
+}
+
+/* 以数字为主的载荷, 重复少 */
+static char *digits(int count)
+{
+    char *json = malloc(count * 24 + 16);
+    int off = sprintf(json, "[");
+    int i;
+
+    srand(7);
+    for (i = 0; i < count; i++)
+    {
+        off += sprintf(json + off, "%s%d.%06d", i ? "," : "", rand() % 100000, rand() % 1000000);
+    }
+    sprintf(json + off, "]");
+    return json;
+}
+
+static void run(int tx, int rx, const char *name, char *json)
+{
+    int32_t len = strlen(json), raw_len;
+    nova_buf packed = {0};
+    double start, comp, decomp, raw_us = 1e18, packed_us = 1e18, t;
+    char *raw;
+    int r;
+
+    if (!nova_compress_payload(&packed, NOVA_COMPRESS_LZ4, json, len))
+    {
+        printf("  %-12s %8d B  incompressible\n", name, len);
+        free(json);
+        return;
+    }
+
+    start = now_us();
+    for (r = 0; r < ROUNDS; r++)
+    {
+        nova_compress_payload(&packed, NOVA_COMPRESS_LZ4, json, len);
+    }
+    comp = (now_us() - start) / ROUNDS;
+
+    start = now_us();
+    for (r = 0; r < ROUNDS; r++)
+    {
+        raw = nova_decompress_payload(NOVA_COMPRESS_LZ4, packed.data, packed.len, &raw_len);
+        if (raw == NULL || raw_len != len || memcmp(raw, json, len) != 0)
+        {
+            fprintf(stderr, "ERROR, %s does not round trip\n", name);
+            exit(1);
+        }
+        free(raw);
+    }
+    decomp = (now_us() - start) / ROUNDS;
+
+    for (r = 0; r < ROUNDS; r++)
+    {
+        t = transfer_us(tx, rx, json, len);
+        raw_us = t < raw_us ? t : raw_us;
+        t = transfer_us(tx, rx, packed.data, packed.len);
+        packed_us = t < packed_us ? t : packed_us;
+    }
+
+    printf("  %-12s %8d B -> %7d B  compress %7.1f us  decompress %6.1f us  loopback %7.1f us -> %6.1f us  %s\n",
+           name, len, packed.len, comp, decomp, raw_us, packed_us,
+           comp + decomp + packed_us < raw_us ? "pays" : "costs");
+    nova_buf_free(&packed);
+    free(json);
+}
+
+int main()
+{
+    char *args;
+    int tx, rx;
+
+#ifndef NOVA_HAVE_LZ4
+    puts("lz4 payloads: unsupported, built without liblz4");
+    return 0;
+#endif
+    if (!loopback(&tx, &rx))
+    {
+        perror("loopback");
+        return 1;
+    }
+
+    args = malloc(4200);
+    memset(args, 0, 4200);
+    strcpy(args, "{\"query\":{\"categoryId\":2,\"tags\":[");
+    while (strlen(args) < 4096)
+    {
+        strcat(args, "\"summer\",\"sale\",\"2026\",");
+    }
+    strcat(args, "\"end\"]}}");
+
+    printf("lz4 payloads, best of %d over 127.0.0.1\n", ROUNDS);
+    run(tx, rx, "args 4KB", args);
+    run(tx, rx, "list 20", media_list(20));
+    run(tx, rx, "list 500", media_list(500));
+    run(tx, rx, "digits", digits(4000));
+
+    close(tx);
+    close(rx);
+    return 0;
+}
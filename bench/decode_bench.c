@@ -0,0 +1,200 @@
+/*
+ * 回包解码的吞吐基准, 对照加边界检查前后
+ *   unchecked  e50fa28之前的 thrift_generic_unpack 二进制路径, 先读后查, 靠assert
+ *   checked    ThriftGeneric.c 现在的实现, 先检查长度再走直线快路径
+ * 另外给出 nova 包头视图解析与 nova_unpack_resp 整帧解码的单次耗时
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "client.h"
+
+#define BUF_OFS (const uchar *)buf + off
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* 只保留 GenericService 正常回包会走到的分支 */
+static int unchecked_generic_unpack(const char *buf, int buf_len, char **out_json_resp)
+{
+    int off = 0;
+    uint32_t ver1, tmp_len, seq;
+    char *tmp_str;
+    char field_type;
+    uint16_t field_id;
+
+    swReadU32(BUF_OFS, &ver1);
+    off += 4;
+    if ((ver1 & VER_MASK) != VER1 || (ver1 & 0xff) == T_EX)
+    {
+        return 0;
+    }
+
+    swReadU32(BUF_OFS, &tmp_len);
+    off += 4;
+    tmp_str = NULL;
+    if (!swReadBytes(BUF_OFS, buf_len - off, &tmp_str, (int)tmp_len))
+    {
+        return 0;
+    }
+    off += tmp_len;
+    if (tmp_len != GENERIC_METHOD_LEN || memcmp(tmp_str, GENERIC_METHOD, GENERIC_METHOD_LEN) != 0)
+    {
+        free(tmp_str);
+        return 0;
+    }
+    free(tmp_str);
+
+    swReadU32(BUF_OFS, &seq);
+    off += 4;
+    swReadByte(BUF_OFS, &field_type);
+    off += 1;
+    if (field_type != TYPE_STRING)
+    {
+        return 0;
+    }
+    swReadU16(BUF_OFS, &field_id);
+    off += 2;
+
+    swReadU32(BUF_OFS, &tmp_len);
+    off += 4;
+    if (tmp_len > (uint32_t)(buf_len - off))
+    {
+        return 0;
+    }
+    tmp_str = malloc(tmp_len + 1);
+    if (tmp_str == NULL)
+    {
+        return 0;
+    }
+    memcpy(tmp_str, BUF_OFS, tmp_len);
+    tmp_str[tmp_len] = 0;
+    *out_json_resp = tmp_str;
+    return tmp_len;
+}
+
+/* GenericService.invoke 的二进制回包, json 为 len 个 'a' */
+static void generic_reply(nova_buf *body, int32_t len)
+{
+    thrift_writer w;
+    char *json = malloc(len);
+
+    memset(json, 'a', len);
+    body->len = 0;
+    thrift_writer_init(&w, body, THRIFT_BINARY);
+    thrift_write_message_begin(&w, GENERIC_METHOD, GENERIC_METHOD_LEN, T_REPLY, 7);
+    thrift_write_struct_begin(&w);
+    thrift_write_field_begin(&w, TYPE_STRING, 0);
+    thrift_write_string(&w, json, len);
+    thrift_write_struct_end(&w);
+    free(json);
+}
+
+static double run_unpack(int (*unpack)(const char *, int, char **), const nova_buf *body, long n)
+{
+    double start, best = 1e18;
+    char *json;
+    long i;
+    int r;
+
+    for (r = 0; r < 5; r++)
+    {
+        start = now_ns();
+        for (i = 0; i < n; i++)
+        {
+            if (!unpack(body->data, body->len, &json))
+            {
+                fprintf(stderr, "ERROR, unpack failed\n");
+                exit(1);
+            }
+            free(json);
+        }
+        if (now_ns() - start < best)
+        {
+            best = now_ns() - start;
+        }
+    }
+    return best / n;
+}
+
+/* 回包帧: 业务服务名与一个小附件, 包体为 body */
+static void reply_frame(nova_buf *frame, const nova_buf *body)
+{
+    static const char attach[] = "{\"trace\":\"0af1\"}";
+    swNova_Header hdr;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = NOVA_MAGIC;
+    hdr.version = 1;
+    hdr.service_name = "com.youzan.material.general.service.MediaService";
+    hdr.service_len = strlen(hdr.service_name);
+    hdr.method_name = "getMediaList";
+    hdr.method_len = strlen(hdr.method_name);
+    hdr.seq_no = 7;
+    hdr.attach_len = sizeof(attach) - 1;
+    hdr.head_size = NOVA_HEADER_COMMON_LEN + hdr.service_len + hdr.method_len + hdr.attach_len;
+
+    nova_buf_reserve(frame, hdr.head_size + body->len);
+    swNova_pack_head(&hdr, body->len, frame->data);
+    memcpy(frame->data + hdr.head_size - hdr.attach_len, attach, hdr.attach_len);
+    memcpy(frame->data + hdr.head_size, body->data, body->len);
+    frame->len = hdr.head_size + body->len;
+}
+
+int main()
+{
+    static const int32_t sizes[] = {64, 1024, 1 << 20};
+    nova_buf body = {0}, frame = {0};
+    swNova_HeaderView view;
+    nova_resp resp;
+    int64_t seq_no;
+    volatile long sink = 0;
+    double unchecked, checked, start;
+    long n, i;
+    int s;
+
+    printf("generic reply decode, best of 5\n");
+    for (s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++)
+    {
+        generic_reply(&body, sizes[s]);
+        n = sizes[s] > 100000 ? 2000 : 1000000;
+        unchecked = run_unpack(unchecked_generic_unpack, &body, n);
+        checked = run_unpack(thrift_generic_unpack, &body, n);
+        printf("  json %7d B  unchecked %9.1f ns  checked %9.1f ns  %+5.1f%%\n",
+               sizes[s], unchecked, checked, (checked / unchecked - 1) * 100);
+    }
+
+    generic_reply(&body, 1024);
+    reply_frame(&frame, &body);
+    n = 10000000;
+    start = now_ns();
+    for (i = 0; i < n; i++)
+    {
+        sink += swNova_unpack_view(frame.data, frame.len, &view) + view.attach_len;
+    }
+    printf("  nova header view       %9.1f ns\n", (now_ns() - start) / n);
+
+    n = 1000000;
+    start = now_ns();
+    for (i = 0; i < n; i++)
+    {
+        if (!nova_unpack_resp(frame.data, frame.len, NULL, 0, &seq_no, &resp))
+        {
+            fprintf(stderr, "ERROR, nova_unpack_resp failed\n");
+            return 1;
+        }
+        sink += resp.json_len;
+        nova_resp_free(&resp);
+    }
+    printf("  nova_unpack_resp 1KB   %9.1f ns\n", (now_ns() - start) / n);
+
+    nova_buf_free(&body);
+    nova_buf_free(&frame);
+    return sink == 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * 宽对象的成员查找: 同一个对象上比较
+ *   scan     沿子节点链表逐个 tolower 比较, 即未加索引时 get_object_item 的做法
+ *   index    cJSON_GetObjectItem, 走过 CJSON_INDEX_THRESHOLD 个成员后建立哈希索引
+ *   replace  cJSON_ReplaceItemInObject, 与 scan 找到后 cJSON_ReplaceItemViaPointer 对比,
+ *            两者都要分配新节点并释放旧节点
+ * 阈值以下的对象不建索引, 两列都是线性查找
+ */
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cJSON.h"
+
+#define MIN_LOOKUPS (4 * 1024 * 1024) /* 每种对象至少查找这么多次 */
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* an object of members named like the fields of a flattened request, field0..fieldN-1 */
+static cJSON *make_object(int members, char ***names)
+{
+    size_t cap = 16 + (size_t)members * 32;
+    char *doc = malloc(cap);
+    size_t len = 0;
+    cJSON *object;
+    int i;
+
+    // cJSON_AddItemToObject 每次都要走到链表尾部, 宽对象用解析来建
+    *names = malloc(members * sizeof(char *));
+    len += sprintf(doc + len, "{");
+    for (i = 0; i < members; i++)
+    {
+        (*names)[i] = malloc(16);
+        sprintf((*names)[i], "field%d", i);
+        len += sprintf(doc + len, "%s\"%s\":%d", i ? "," : "", (*names)[i], i);
+    }
+    sprintf(doc + len, "}");
+    object = cJSON_Parse(doc);
+    free(doc);
+    return object;
+}
+
+static int scan_strcmp(const char *a, const char *b)
+{
+    for (; tolower((unsigned char)*a) == tolower((unsigned char)*b); a++, b++)
+    {
+        if (*a == '\0')
+        {
+            return 0;
+        }
+    }
+    return tolower((unsigned char)*a) - tolower((unsigned char)*b);
+}
+
+static cJSON *scan(const cJSON *object, const char *name)
+{
+    cJSON *item = object->child;
+
+    while (item != NULL && scan_strcmp(name, item->string) != 0)
+    {
+        item = item->next;
+    }
+    return item;
+}
+
+/* ns per lookup over all the members in turn, so the scans average half the object */
+static double run_lookup(cJSON *(*fn)(const cJSON *, const char *), cJSON *object, char **names, int members)
+{
+    long rounds = MIN_LOOKUPS / members + 1;
+    double start;
+    long r;
+    int i;
+
+    fn(object, names[members - 1]);
+    start = now_ns();
+    for (r = 0; r < rounds; r++)
+    {
+        for (i = 0; i < members; i++)
+        {
+            if (fn(object, names[i]) == NULL)
+            {
+                fprintf(stderr, "ERROR, member %s not found\n", names[i]);
+                exit(1);
+            }
+        }
+    }
+    return (now_ns() - start) / ((double)rounds * members);
+}
+
+static cJSON *get(const cJSON *object, const char *name)
+{
+    return cJSON_GetObjectItem(object, name);
+}
+
+static void replace_scan(cJSON *object, const char *name, cJSON *item)
+{
+    // 与 cJSON_ReplaceItemInObject 一样, 新成员带着自己的名字副本
+    item->string = strdup(name);
+    cJSON_ReplaceItemViaPointer(object, scan(object, name), item);
+}
+
+static void replace(cJSON *object, const char *name, cJSON *item)
+{
+    cJSON_ReplaceItemInObject(object, name, item);
+}
+
+static double run_replace(void (*fn)(cJSON *, const char *, cJSON *), cJSON *object, char **names, int members)
+{
+    long rounds = MIN_LOOKUPS / 4 / members + 1;
+    double start;
+    long r;
+    int i;
+
+    start = now_ns();
+    for (r = 0; r < rounds; r++)
+    {
+        for (i = 0; i < members; i++)
+        {
+            fn(object, names[i], cJSON_CreateNumber(r));
+        }
+    }
+    return (now_ns() - start) / ((double)rounds * members);
+}
+
+int main()
+{
+    static const int sizes[] = {8, CJSON_INDEX_THRESHOLD - 1, 64, 512, 4096};
+    char **names;
+    cJSON *object;
+    double linear;
+    double ns;
+    int s, i;
+
+    for (s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++)
+    {
+        object = make_object(sizes[s], &names);
+        if (object == NULL)
+        {
+            fprintf(stderr, "ERROR, fail to build the object\n");
+            return 1;
+        }
+        printf("index: %d members, threshold %d\n", sizes[s], CJSON_INDEX_THRESHOLD);
+        linear = run_lookup(scan, object, names, sizes[s]);
+        ns = run_lookup(get, object, names, sizes[s]);
+        printf("  lookup   scan %8.1f ns  index %6.1f ns  x%.2f\n", linear, ns, linear / ns);
+        linear = run_replace(replace_scan, object, names, sizes[s]);
+        ns = run_replace(replace, object, names, sizes[s]);
+        printf("  replace  scan %8.1f ns  index %6.1f ns  x%.2f\n", linear, ns, linear / ns);
+        cJSON_Delete(object);
+        for (i = 0; i < sizes[s]; i++)
+        {
+            free(names[i]);
+        }
+        free(names);
+    }
+    return 0;
+}
@@ -19,6 +19,7 @@ extern "C"
 #endif
 
 #include <stdint.h>
+#include <string.h>
 
 #ifndef SW_ERR
 #define SW_ERR 0
@@ -126,6 +127,100 @@ int swWriteByte(uchar* data, char value);
 int swWriteString(uchar* data, const char* str, int len);
 int swWriteBytes(uchar* data, const char* str, int len);
 
+/*
+ * 定长整数的内联快速路径: 非对齐 load/store 加一次字节序翻转,
+ * 头部编解码只剩几条指令. 上面的函数符号仍然导出, 供按地址取用或旧代码链接,
+ * 定义 SW_BINARY_NO_INLINE 可以退回到函数调用
+ */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define sw_be16(x) (x)
+#define sw_be32(x) (x)
+#define sw_be64(x) (x)
+#elif defined(__GNUC__)
+#define sw_be16(x) __builtin_bswap16(x)
+#define sw_be32(x) __builtin_bswap32(x)
+#define sw_be64(x) __builtin_bswap64(x)
+#else
+/* 只用移位, 不依赖 byteswap.h 或上面的 bswap_* (定义了 htonll 的平台上没有它们) */
+#define sw_be16(x) ((uint16_t)(((uint16_t)(x) << 8) | ((uint16_t)(x) >> 8)))
+#define sw_be32(x) ((uint32_t)(((uint32_t)sw_be16((uint32_t)(x) & 0xFFFF) << 16) | sw_be16((uint32_t)(x) >> 16)))
+#define sw_be64(x) ((uint64_t)(((uint64_t)sw_be32((uint64_t)(x) & 0xFFFFFFFF) << 32) | sw_be32((uint64_t)(x) >> 32)))
+#endif
+
+#ifdef __GNUC__
+#define SW_INLINE static inline __attribute__((always_inline))
+#else
+#define SW_INLINE static inline
+#endif
+
+SW_INLINE uint16_t swLoadU16(const uchar* data)
+{
+    uint16_t v;
+    memcpy(&v, data, sizeof(v));
+    return sw_be16(v);
+}
+
+SW_INLINE uint32_t swLoadU32(const uchar* data)
+{
+    uint32_t v;
+    memcpy(&v, data, sizeof(v));
+    return sw_be32(v);
+}
+
+SW_INLINE uint64_t swLoadU64(const uchar* data)
+{
+    uint64_t v;
+    memcpy(&v, data, sizeof(v));
+    return sw_be64(v);
+}
+
+SW_INLINE void swStoreU16(uchar* data, uint16_t value)
+{
+    value = sw_be16(value);
+    memcpy(data, &value, sizeof(value));
+}
+
+SW_INLINE void swStoreU32(uchar* data, uint32_t value)
+{
+    value = sw_be32(value);
+    memcpy(data, &value, sizeof(value));
+}
+
+SW_INLINE void swStoreU64(uchar* data, uint64_t value)
+{
+    value = sw_be64(value);
+    memcpy(data, &value, sizeof(value));
+}
+
+SW_INLINE int swInlineReadI64(const uchar* data, int64_t *value) { *value = (int64_t)swLoadU64(data); return SW_OK; }
+SW_INLINE int swInlineReadI32(const uchar* data, int32_t *value) { *value = (int32_t)swLoadU32(data); return SW_OK; }
+SW_INLINE int swInlineReadU32(const uchar* data, uint32_t *value) { *value = swLoadU32(data); return SW_OK; }
+SW_INLINE int swInlineReadI16(const uchar* data, int16_t *value) { *value = (int16_t)swLoadU16(data); return SW_OK; }
+SW_INLINE int swInlineReadU16(const uchar* data, uint16_t *value) { *value = swLoadU16(data); return SW_OK; }
+SW_INLINE int swInlineReadByte(const uchar* data, char *value) { *value = (char)data[0]; return SW_OK; }
+
+SW_INLINE int swInlineWriteI64(uchar* data, int64_t value) { swStoreU64(data, (uint64_t)value); return SW_OK; }
+SW_INLINE int swInlineWriteI32(uchar* data, int32_t value) { swStoreU32(data, (uint32_t)value); return SW_OK; }
+SW_INLINE int swInlineWriteU32(uchar* data, uint32_t value) { swStoreU32(data, value); return SW_OK; }
+SW_INLINE int swInlineWriteI16(uchar* data, int16_t value) { swStoreU16(data, (uint16_t)value); return SW_OK; }
+SW_INLINE int swInlineWriteU16(uchar* data, uint16_t value) { swStoreU16(data, value); return SW_OK; }
+SW_INLINE int swInlineWriteByte(uchar* data, char value) { data[0] = (uchar)value; return SW_OK; }
+
+#ifndef SW_BINARY_NO_INLINE
+#define swReadI64(data, value) swInlineReadI64(data, value)
+#define swReadI32(data, value) swInlineReadI32(data, value)
+#define swReadU32(data, value) swInlineReadU32(data, value)
+#define swReadI16(data, value) swInlineReadI16(data, value)
+#define swReadU16(data, value) swInlineReadU16(data, value)
+#define swReadByte(data, value) swInlineReadByte(data, value)
+#define swWriteI64(data, value) swInlineWriteI64(data, value)
+#define swWriteI32(data, value) swInlineWriteI32(data, value)
+#define swWriteU32(data, value) swInlineWriteU32(data, value)
+#define swWriteI16(data, value) swInlineWriteI16(data, value)
+#define swWriteU16(data, value) swInlineWriteU16(data, value)
+#define swWriteByte(data, value) swInlineWriteByte(data, value)
+#endif
+
 #ifdef __cplusplus
 }
 #endif
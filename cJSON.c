@@ -36,12 +36,38 @@
 #include <ctype.h>
 #include <locale.h>
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define CJSON_SIMD 1
+#endif
+
+/* keeps the member walk of get_object_item as tight as with a single caller */
+#if defined(__GNUC__)
+#define CJSON_INLINE __inline__ __attribute__((always_inline))
+#else
+#define CJSON_INLINE
+#endif
+
+/* the member indexes are kept per thread, like the allocators behind the hooks */
+#if defined(__GNUC__)
+#define CJSON_THREAD_LOCAL __thread
+#else
+#define CJSON_THREAD_LOCAL
+#endif
+
+/* print_number formats with 64 bit integers, and checks round trips with double arithmetic that has no excess precision */
+#if defined(ULLONG_MAX) && defined(FLT_EVAL_METHOD) && (FLT_EVAL_METHOD == 0)
+#define CJSON_FAST_NUMBERS 1
+#endif
+
 #ifdef __GNUC__
 #pragma GCC visibility pop
 #endif
 
 #include "cJSON.h"
 
+typedef struct cJSON_index cJSON_index;
+
 /* define our own boolean type */
 #define true ((cJSON_bool)1)
 #define false ((cJSON_bool)0)
@@ -71,7 +97,7 @@ CJSON_PUBLIC(const char*) cJSON_Version(void)
 }
 
 /* Case insensitive string comparison, doesn't consider two NULL pointers equal though */
-static int case_insensitive_strcmp(const unsigned char *string1, const unsigned char *string2)
+static CJSON_INLINE int case_insensitive_strcmp(const unsigned char *string1, const unsigned char *string2)
 {
     if ((string1 == NULL) || (string2 == NULL))
     {
@@ -166,6 +192,8 @@ static cJSON *cJSON_New_Item(const internal_hooks * const hooks)
     return node;
 }
 
+static void index_drop(const cJSON * const object);
+
 /* Delete a cJSON structure. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
 {
@@ -185,6 +213,11 @@ CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
         {
             global_hooks.deallocate(item->string);
         }
+        /* only objects get indexes */
+        if ((item->type & 0xFF) == cJSON_Object)
+        {
+            index_drop(item);
+        }
         global_hooks.deallocate(item);
         item = next;
     }
@@ -423,6 +456,445 @@ static void update_offset(printbuffer * const buffer)
     buffer->offset += strlen((const char*)buffer_pointer);
 }
 
+#ifdef CJSON_FAST_NUMBERS
+/*
+ * print_number without printf. "%1.15g" and "%1.17g" give the double correctly rounded to 15 and 17
+ * significant digits, which is what Grisu's counted mode (Loitsch 2010, FastDtoa with a precision in
+ * double-conversion) computes in 64 bit integers. It gives up on the rare double whose rounding its
+ * error bound leaves open, exact ties among them, and those still go through printf.
+ */
+typedef struct
+{
+    unsigned long long f;
+    int e;
+} diy_fp;
+
+typedef struct
+{
+    unsigned long long significand;
+    short binary_exponent;
+    short decimal_exponent;
+} cached_power;
+
+/* 10^k rounded to 64 bits for k = -348, -340, ..., 340: 10^k ~ significand * 2^binary_exponent */
+static const cached_power cached_powers[] =
+{
+    {0xfa8fd5a0081c0288ULL, -1220, -348},
+    {0xbaaee17fa23ebf76ULL, -1193, -340},
+    {0x8b16fb203055ac76ULL, -1166, -332},
+    {0xcf42894a5dce35eaULL, -1140, -324},
+    {0x9a6bb0aa55653b2dULL, -1113, -316},
+    {0xe61acf033d1a45dfULL, -1087, -308},
+    {0xab70fe17c79ac6caULL, -1060, -300},
+    {0xff77b1fcbebcdc4fULL, -1034, -292},
+    {0xbe5691ef416bd60cULL, -1007, -284},
+    {0x8dd01fad907ffc3cULL, -980, -276},
+    {0xd3515c2831559a83ULL, -954, -268},
+    {0x9d71ac8fada6c9b5ULL, -927, -260},
+    {0xea9c227723ee8bcbULL, -901, -252},
+    {0xaecc49914078536dULL, -874, -244},
+    {0x823c12795db6ce57ULL, -847, -236},
+    {0xc21094364dfb5637ULL, -821, -228},
+    {0x9096ea6f3848984fULL, -794, -220},
+    {0xd77485cb25823ac7ULL, -768, -212},
+    {0xa086cfcd97bf97f4ULL, -741, -204},
+    {0xef340a98172aace5ULL, -715, -196},
+    {0xb23867fb2a35b28eULL, -688, -188},
+    {0x84c8d4dfd2c63f3bULL, -661, -180},
+    {0xc5dd44271ad3cdbaULL, -635, -172},
+    {0x936b9fcebb25c996ULL, -608, -164},
+    {0xdbac6c247d62a584ULL, -582, -156},
+    {0xa3ab66580d5fdaf6ULL, -555, -148},
+    {0xf3e2f893dec3f126ULL, -529, -140},
+    {0xb5b5ada8aaff80b8ULL, -502, -132},
+    {0x87625f056c7c4a8bULL, -475, -124},
+    {0xc9bcff6034c13053ULL, -449, -116},
+    {0x964e858c91ba2655ULL, -422, -108},
+    {0xdff9772470297ebdULL, -396, -100},
+    {0xa6dfbd9fb8e5b88fULL, -369, -92},
+    {0xf8a95fcf88747d94ULL, -343, -84},
+    {0xb94470938fa89bcfULL, -316, -76},
+    {0x8a08f0f8bf0f156bULL, -289, -68},
+    {0xcdb02555653131b6ULL, -263, -60},
+    {0x993fe2c6d07b7facULL, -236, -52},
+    {0xe45c10c42a2b3b06ULL, -210, -44},
+    {0xaa242499697392d3ULL, -183, -36},
+    {0xfd87b5f28300ca0eULL, -157, -28},
+    {0xbce5086492111aebULL, -130, -20},
+    {0x8cbccc096f5088ccULL, -103, -12},
+    {0xd1b71758e219652cULL, -77, -4},
+    {0x9c40000000000000ULL, -50, 4},
+    {0xe8d4a51000000000ULL, -24, 12},
+    {0xad78ebc5ac620000ULL, 3, 20},
+    {0x813f3978f8940984ULL, 30, 28},
+    {0xc097ce7bc90715b3ULL, 56, 36},
+    {0x8f7e32ce7bea5c70ULL, 83, 44},
+    {0xd5d238a4abe98068ULL, 109, 52},
+    {0x9f4f2726179a2245ULL, 136, 60},
+    {0xed63a231d4c4fb27ULL, 162, 68},
+    {0xb0de65388cc8ada8ULL, 189, 76},
+    {0x83c7088e1aab65dbULL, 216, 84},
+    {0xc45d1df942711d9aULL, 242, 92},
+    {0x924d692ca61be758ULL, 269, 100},
+    {0xda01ee641a708deaULL, 295, 108},
+    {0xa26da3999aef774aULL, 322, 116},
+    {0xf209787bb47d6b85ULL, 348, 124},
+    {0xb454e4a179dd1877ULL, 375, 132},
+    {0x865b86925b9bc5c2ULL, 402, 140},
+    {0xc83553c5c8965d3dULL, 428, 148},
+    {0x952ab45cfa97a0b3ULL, 455, 156},
+    {0xde469fbd99a05fe3ULL, 481, 164},
+    {0xa59bc234db398c25ULL, 508, 172},
+    {0xf6c69a72a3989f5cULL, 534, 180},
+    {0xb7dcbf5354e9beceULL, 561, 188},
+    {0x88fcf317f22241e2ULL, 588, 196},
+    {0xcc20ce9bd35c78a5ULL, 614, 204},
+    {0x98165af37b2153dfULL, 641, 212},
+    {0xe2a0b5dc971f303aULL, 667, 220},
+    {0xa8d9d1535ce3b396ULL, 694, 228},
+    {0xfb9b7cd9a4a7443cULL, 720, 236},
+    {0xbb764c4ca7a44410ULL, 747, 244},
+    {0x8bab8eefb6409c1aULL, 774, 252},
+    {0xd01fef10a657842cULL, 800, 260},
+    {0x9b10a4e5e9913129ULL, 827, 268},
+    {0xe7109bfba19c0c9dULL, 853, 276},
+    {0xac2820d9623bf429ULL, 880, 284},
+    {0x80444b5e7aa7cf85ULL, 907, 292},
+    {0xbf21e44003acdd2dULL, 933, 300},
+    {0x8e679c2f5e44ff8fULL, 960, 308},
+    {0xd433179d9c8cb841ULL, 986, 316},
+    {0x9e19db92b4e31ba9ULL, 1013, 324},
+    {0xeb96bf6ebadf77d9ULL, 1039, 332},
+    {0xaf87023b9bf0ee6bULL, 1066, 340}
+};
+
+/* exactly representable, for Clinger's fast path */
+static const double exact_powers_of_ten[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* x * y rounded to the upper 64 bits of the product */
+static diy_fp diy_fp_times(const diy_fp x, const diy_fp y)
+{
+    const unsigned long long mask = 0xFFFFFFFFULL;
+    unsigned long long a = x.f >> 32;
+    unsigned long long b = x.f & mask;
+    unsigned long long c = y.f >> 32;
+    unsigned long long d = y.f & mask;
+    unsigned long long middle = ((b * d) >> 32) + ((a * d) & mask) + ((b * c) & mask) + (1ULL << 31);
+    diy_fp product;
+
+    product.f = (a * c) + ((a * d) >> 32) + ((b * c) >> 32) + (middle >> 32);
+    product.e = x.e + y.e + 64;
+
+    return product;
+}
+
+/* the cached power that scales w into [2^-60, 2^-32) units, where the digits come out of 64 bits */
+static const cached_power *cached_power_for(const int w_exponent)
+{
+    int minimum = -60 - (w_exponent + 64);
+    /* binary exponents of neighbouring entries are 26 or 27 apart, start from an estimate */
+    size_t i = ((size_t)(minimum + 1220) * 1000) / 26575;
+
+    while (cached_powers[i].binary_exponent < minimum)
+    {
+        i++;
+    }
+    while ((i > 0) && (cached_powers[i - 1].binary_exponent >= minimum))
+    {
+        i--;
+    }
+
+    return &cached_powers[i];
+}
+
+/*
+ * The first precision significant digits of a positive finite number, correctly rounded,
+ * number ~ digits * 10^exponent. false when the error of the scaled number could change the rounding.
+ */
+static cJSON_bool double_digits(const double number, const int precision, unsigned char * const digits, int * const exponent)
+{
+    unsigned long long bits = 0;
+    const cached_power *power = NULL;
+    diy_fp w;
+    diy_fp scaled;
+    unsigned long long one = 0;
+    unsigned long long fractionals = 0;
+    unsigned long long rest = 0;
+    unsigned long long ten_kappa = 0;
+    unsigned long long divisor = 1;
+    unsigned long long error = 1; /* of scaled, in units of its last bit */
+    unsigned long long integrals = 0;
+    int kappa = 1;
+    int length = 0;
+    int i = 0;
+
+    memcpy(&bits, &number, sizeof(bits));
+    w.f = bits & 0xFFFFFFFFFFFFFULL;
+    w.e = (int)((bits >> 52) & 0x7FF);
+    if (w.e == 0)
+    {
+        /* subnormal */
+        w.e = -1074;
+    }
+    else
+    {
+        w.f |= 1ULL << 52;
+        w.e -= 1075;
+    }
+    while ((w.f & (1ULL << 63)) == 0)
+    {
+        w.f <<= 1;
+        w.e--;
+    }
+
+    power = cached_power_for(w.e);
+    scaled.f = power->significand;
+    scaled.e = power->binary_exponent;
+    scaled = diy_fp_times(w, scaled);
+
+    one = 1ULL << -scaled.e;
+    integrals = scaled.f >> -scaled.e;
+    fractionals = scaled.f & (one - 1);
+
+    /* integrals is at least 4 and below 2^32 */
+    while ((integrals / divisor) >= 10)
+    {
+        divisor *= 10;
+        kappa++;
+    }
+    while (kappa > 0)
+    {
+        digits[length++] = (unsigned char)('0' + (integrals / divisor));
+        integrals %= divisor;
+        kappa--;
+        if (length == precision)
+        {
+            break;
+        }
+        divisor /= 10;
+    }
+
+    if (length == precision)
+    {
+        rest = (integrals << -scaled.e) + fractionals;
+        ten_kappa = divisor << -scaled.e;
+    }
+    else
+    {
+        while ((length < precision) && (fractionals > error))
+        {
+            fractionals *= 10;
+            error *= 10;
+            digits[length++] = (unsigned char)('0' + (fractionals >> -scaled.e));
+            fractionals &= one - 1;
+            kappa--;
+        }
+        if (length < precision)
+        {
+            /* the number is the digits so far within 2 * error, e.g. 0.5, the rest are zeros if that stays below half the last unit */
+            for (rest = 4 * error, i = length; (i < precision) && (rest < one); i++)
+            {
+                rest *= 10;
+            }
+            if (rest >= one)
+            {
+                return false;
+            }
+            while (length < precision)
+            {
+                digits[length++] = '0';
+                kappa--;
+            }
+            *exponent = kappa - power->decimal_exponent;
+            return true;
+        }
+        rest = fractionals;
+        ten_kappa = one;
+    }
+
+    /* round half a unit of the last digit up or down only when rest +- error falls on the same side */
+    if ((error >= ten_kappa) || ((ten_kappa - error) <= error))
+    {
+        return false;
+    }
+    if (((ten_kappa - rest) > rest) && ((ten_kappa - (2 * rest)) >= (2 * error)))
+    {
+        /* rounds down */
+    }
+    else if ((rest > error) && ((ten_kappa - (rest - error)) <= (rest - error)))
+    {
+        for (i = length - 1; (i > 0) && (digits[i] == '9'); i--)
+        {
+            digits[i] = '0';
+        }
+        if (digits[i] == '9')
+        {
+            /* 99..9 went up to 10..0 */
+            digits[0] = '1';
+            kappa++;
+        }
+        else
+        {
+            digits[i]++;
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    *exponent = kappa - power->decimal_exponent;
+
+    return true;
+}
+
+/* whether digits * 10^exponent reads back as number, what the sscanf check of print_number tells */
+static cJSON_bool digits_round_trip(const double number, const unsigned char * const digits, const int length, const int exponent)
+{
+    unsigned long long mantissa = 0;
+    double value = 0;
+    char text[48];
+    int i = 0;
+
+    for (i = 0; i < length; i++)
+    {
+        mantissa = (mantissa * 10) + (unsigned long long)(digits[i] - '0');
+    }
+
+    /* an exact mantissa and power of ten, one correctly rounded operation is what strtod returns */
+    if ((mantissa < (1ULL << 53)) && (exponent >= -22) && (exponent <= 22))
+    {
+        value = (double)mantissa;
+        value = (exponent < 0) ? (value / exact_powers_of_ten[-exponent]) : (value * exact_powers_of_ten[exponent]);
+        return value == number;
+    }
+
+    /* no decimal point in it, so the locale does not matter */
+    sprintf(text, "%llue%d", mantissa, exponent);
+    return strtod(text, NULL) == number;
+}
+
+/* digits laid out like printf's %g with the given precision, the decimal exponent is the one of the first digit */
+static int format_digits(unsigned char * const output, const cJSON_bool negative, const unsigned char * const digits, int length, int exponent, const int precision)
+{
+    unsigned char *output_pointer = output;
+    int i = 0;
+
+    /* %g drops trailing zeros of the fraction */
+    while ((length > 1) && (digits[length - 1] == '0'))
+    {
+        length--;
+    }
+
+    if (negative)
+    {
+        *output_pointer++ = '-';
+    }
+
+    if ((exponent < -4) || (exponent >= precision))
+    {
+        *output_pointer++ = digits[0];
+        if (length > 1)
+        {
+            *output_pointer++ = '.';
+            memcpy(output_pointer, digits + 1, (size_t)(length - 1));
+            output_pointer += length - 1;
+        }
+        *output_pointer++ = 'e';
+        *output_pointer++ = (exponent < 0) ? '-' : '+';
+        if (exponent < 0)
+        {
+            exponent = -exponent;
+        }
+        if (exponent >= 100)
+        {
+            *output_pointer++ = (unsigned char)('0' + (exponent / 100));
+            exponent %= 100;
+        }
+        *output_pointer++ = (unsigned char)('0' + (exponent / 10));
+        *output_pointer++ = (unsigned char)('0' + (exponent % 10));
+    }
+    else if (exponent >= 0)
+    {
+        for (i = 0; i <= exponent; i++)
+        {
+            *output_pointer++ = (i < length) ? digits[i] : '0';
+        }
+        if (length > (exponent + 1))
+        {
+            *output_pointer++ = '.';
+            memcpy(output_pointer, digits + exponent + 1, (size_t)(length - exponent - 1));
+            output_pointer += length - exponent - 1;
+        }
+    }
+    else
+    {
+        *output_pointer++ = '0';
+        *output_pointer++ = '.';
+        for (i = -1; i > exponent; i--)
+        {
+            *output_pointer++ = '0';
+        }
+        memcpy(output_pointer, digits, (size_t)length);
+        output_pointer += length;
+    }
+    *output_pointer = '\0';
+
+    return (int)(output_pointer - output);
+}
+
+/* what the printf calls of print_number produce for a finite number, 0 when it is left to them and -1 when only "%1.17g" is */
+static int format_number(double number, unsigned char * const output)
+{
+    unsigned long long bits = 0;
+    unsigned long long integer = 0;
+    unsigned char digits[20];
+    cJSON_bool negative = false;
+    int exponent = 0;
+    int length = 0;
+
+    memcpy(&bits, &number, sizeof(bits));
+    negative = (bits >> 63) != 0;
+    if (negative)
+    {
+        number = -number;
+    }
+
+    /* integers with up to 15 digits, ids and timestamps mostly, print in full */
+    if ((number < 1e15) && (number == (double)(unsigned long long)number))
+    {
+        integer = (unsigned long long)number;
+        do
+        {
+            digits[sizeof(digits) - 1 - length] = (unsigned char)('0' + (integer % 10));
+            integer /= 10;
+            length++;
+        } while (integer != 0);
+
+        return format_digits(output, negative, digits + sizeof(digits) - length, length, length - 1, 15);
+    }
+
+    if (!double_digits(number, 15, digits, &exponent))
+    {
+        return 0;
+    }
+    if (digits_round_trip(number, digits, 15, exponent))
+    {
+        return format_digits(output, negative, digits, 15, exponent + 14, 15);
+    }
+
+    if (!double_digits(number, 17, digits, &exponent))
+    {
+        return -1;
+    }
+    return format_digits(output, negative, digits, 17, exponent + 16, 17);
+}
+#endif
+
 /* Render the number nicely from the given item into a string. */
 static cJSON_bool print_number(const cJSON * const item, printbuffer * const output_buffer)
 {
@@ -431,7 +903,7 @@ static cJSON_bool print_number(const cJSON * const item, printbuffer * const out
     int length = 0;
     size_t i = 0;
     unsigned char number_buffer[26]; /* temporary buffer to print the number into */
-    unsigned char decimal_point = get_decimal_point();
+    unsigned char decimal_point = 0;
     double test;
 
     if (output_buffer == NULL)
@@ -446,14 +918,37 @@ static cJSON_bool print_number(const cJSON * const item, printbuffer * const out
     }
     else
     {
-        /* Try 15 decimal places of precision to avoid nonsignificant nonzero digits */
-        length = sprintf((char*)number_buffer, "%1.15g", d);
-
-        /* Check whether the original double can be recovered */
-        if ((sscanf((char*)number_buffer, "%lg", &test) != 1) || ((double)test != d))
+#ifdef CJSON_FAST_NUMBERS
+        length = format_number(d, number_buffer);
+#endif
+        if (length <= 0)
         {
-            /* If not, print with 17 decimal places of precision */
-            length = sprintf((char*)number_buffer, "%1.17g", d);
+            if (length == 0)
+            {
+                /* Try 15 decimal places of precision to avoid nonsignificant nonzero digits */
+                length = sprintf((char*)number_buffer, "%1.15g", d);
+
+                /* Check whether the original double can be recovered */
+                if ((sscanf((char*)number_buffer, "%lg", &test) != 1) || ((double)test != d))
+                {
+                    length = -1;
+                }
+            }
+            if (length < 0)
+            {
+                /* If not, print with 17 decimal places of precision */
+                length = sprintf((char*)number_buffer, "%1.17g", d);
+            }
+
+            /* replace the locale dependent decimal point with '.' */
+            decimal_point = get_decimal_point();
+            for (i = 0; (length > 0) && (i < (size_t)length); i++)
+            {
+                if (number_buffer[i] == decimal_point)
+                {
+                    number_buffer[i] = '.';
+                }
+            }
         }
     }
 
@@ -470,19 +965,9 @@ static cJSON_bool print_number(const cJSON * const item, printbuffer * const out
         return false;
     }
 
-    /* copy the printed number to the output and replace locale
-     * dependent decimal point with '.' */
-    for (i = 0; i < ((size_t)length); i++)
-    {
-        if (number_buffer[i] == decimal_point)
-        {
-            output_pointer[i] = '.';
-            continue;
-        }
-
-        output_pointer[i] = number_buffer[i];
-    }
-    output_pointer[i] = '\0';
+    /* copy the printed number to the output */
+    memcpy(output_pointer, number_buffer, (size_t)length);
+    output_pointer[length] = '\0';
 
     output_buffer->offset += (size_t)length;
 
@@ -647,6 +1132,150 @@ fail:
     return 0;
 }
 
+/*
+ * Scanners for the hot loops of the parser, they never read past len.
+ * scan_string_special: index of the first '"' or '\\' in p[0, len), len when there is none
+ * scan_whitespace: index of the first byte above 32 in p[0, len), len when there is none
+ * On x86-64 they compare 16 bytes at a time with SSE2, or 32 with AVX2 when the cpu has it.
+ * Control characters are not special, strings keep accepting them as before.
+ */
+static size_t scan_string_special_scalar(const unsigned char *p, size_t len)
+{
+    size_t i = 0;
+    while ((i < len) && (p[i] != '\"') && (p[i] != '\\'))
+    {
+        i++;
+    }
+    return i;
+}
+
+static size_t scan_whitespace_scalar(const unsigned char *p, size_t len)
+{
+    size_t i = 0;
+    while ((i < len) && (p[i] <= 32))
+    {
+        i++;
+    }
+    return i;
+}
+
+#ifdef CJSON_SIMD
+static size_t scan_string_special_sse2(const unsigned char *p, size_t len)
+{
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    size_t i = 0;
+
+    for (; (i + 16) <= len; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(p + i));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0)
+        {
+            return i + (size_t)__builtin_ctz((unsigned int)mask);
+        }
+    }
+    return i + scan_string_special_scalar(p + i, len - i);
+}
+
+static size_t scan_whitespace_sse2(const unsigned char *p, size_t len)
+{
+    const __m128i space = _mm_set1_epi8(32);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; (i + 16) <= len; i += 16)
+    {
+        /* bytes above 32 survive the saturating subtraction */
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(p + i));
+        int mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(chunk, space), zero)) & 0xFFFF;
+        if (mask != 0)
+        {
+            return i + (size_t)__builtin_ctz((unsigned int)mask);
+        }
+    }
+    return i + scan_whitespace_scalar(p + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_string_special_avx2(const unsigned char *p, size_t len)
+{
+    const __m256i quote = _mm256_set1_epi8('\"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    size_t i = 0;
+
+    for (; (i + 32) <= len; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(p + i));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0)
+        {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+    /* not the sse2 scan, mixing legacy sse code into dirty avx state stalls */
+    return i + scan_string_special_scalar(p + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_whitespace_avx2(const unsigned char *p, size_t len)
+{
+    const __m256i space = _mm256_set1_epi8(32);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; (i + 32) <= len; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(p + i));
+        unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_subs_epu8(chunk, space), zero));
+        if (mask != 0)
+        {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+    return i + scan_whitespace_scalar(p + i, len - i);
+}
+
+/* the first call picks the widest implementation the cpu runs, later calls go straight to it */
+static size_t scan_string_special_resolve(const unsigned char *p, size_t len);
+static size_t scan_whitespace_resolve(const unsigned char *p, size_t len);
+static size_t (*scan_string_special)(const unsigned char *p, size_t len) = scan_string_special_resolve;
+static size_t (*scan_whitespace)(const unsigned char *p, size_t len) = scan_whitespace_resolve;
+
+static void scan_resolve(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        scan_string_special = scan_string_special_avx2;
+        scan_whitespace = scan_whitespace_avx2;
+    }
+    else
+    {
+        scan_string_special = scan_string_special_sse2;
+        scan_whitespace = scan_whitespace_sse2;
+    }
+}
+
+static size_t scan_string_special_resolve(const unsigned char *p, size_t len)
+{
+    scan_resolve();
+    return scan_string_special(p, len);
+}
+
+static size_t scan_whitespace_resolve(const unsigned char *p, size_t len)
+{
+    scan_resolve();
+    return scan_whitespace(p, len);
+}
+#else
+#define scan_string_special scan_string_special_scalar
+#define scan_whitespace scan_whitespace_scalar
+#endif
+
+/* most keys, values and indents are short, the byte loops hand over to the vector scan after this many bytes */
+#define SCAN_SHORT 16
+
 /* Parse the input text into an unescaped cinput, and populate item. */
 static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
 {
@@ -654,6 +1283,7 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     const unsigned char *input_end = buffer_at_offset(input_buffer) + 1;
     unsigned char *output_pointer = NULL;
     unsigned char *output = NULL;
+    size_t scalar_run = 0;
 
     /* not a string */
     if (buffer_at_offset(input_buffer)[0] != '\"')
@@ -679,6 +1309,13 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
                 input_end++;
             }
             input_end++;
+
+            /* a long string, jump to its next quote or escape */
+            if (++scalar_run == SCAN_SHORT)
+            {
+                input_end += scan_string_special(input_end, input_buffer->length - (size_t)(input_end - input_buffer->content));
+                scalar_run = 0;
+            }
         }
         if (((size_t)(input_end - input_buffer->content) >= input_buffer->length) || (*input_end != '\"'))
         {
@@ -692,15 +1329,34 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
         {
             goto fail; /* allocation failure */
         }
+
+        output_pointer = output;
+        /* without escapes the literal is the string */
+        if (skipped_bytes == 0)
+        {
+            memcpy(output_pointer, input_pointer, (size_t)(input_end - input_pointer));
+            output_pointer += input_end - input_pointer;
+            input_pointer = input_end;
+        }
     }
 
-    output_pointer = output;
     /* loop through the string literal */
+    scalar_run = 0;
     while (input_pointer < input_end)
     {
         if (*input_pointer != '\\')
         {
             *output_pointer++ = *input_pointer++;
+
+            /* a long run, copied whole up to the next escape */
+            if (++scalar_run == SCAN_SHORT)
+            {
+                size_t run = scan_string_special(input_pointer, (size_t)(input_end - input_pointer));
+                memcpy(output_pointer, input_pointer, run);
+                output_pointer += run;
+                input_pointer += run;
+                scalar_run = 0;
+            }
         }
         /* escape sequence */
         else
@@ -915,6 +1571,8 @@ static cJSON_bool print_object(const cJSON * const item, printbuffer * const out
 /* Utility to jump whitespace and cr/lf */
 static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
 {
+    size_t skipped = 0;
+
     if ((buffer == NULL) || (buffer->content == NULL))
     {
         return NULL;
@@ -923,6 +1581,13 @@ static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
     while (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] <= 32))
     {
        buffer->offset++;
+
+       /* deep indentation, the vector scan finds its end */
+       if (++skipped == SCAN_SHORT)
+       {
+           buffer->offset += scan_whitespace(buffer_at_offset(buffer), buffer->length - buffer->offset);
+           break;
+       }
     }
 
     if (buffer->offset == buffer->length)
@@ -1711,21 +2376,349 @@ CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index)
     return get_array_item(array, (size_t)index);
 }
 
+/*
+ * Member index of wide objects: open addressing with linear probing over a case folded hash of the names.
+ * Members are inserted in list order and names that compare equal share a hash, so the first match
+ * on a probe path is also the first in the list, which is the member a linear lookup returns.
+ */
+typedef struct index_slot
+{
+    cJSON *item;
+    unsigned int hash;
+} index_slot;
+
+struct cJSON_index
+{
+    size_t mask; /* slots - 1, a power of two at least twice the members */
+    size_t count;
+    index_slot *slots;
+    const cJSON *owner; /* the key in the table of the thread */
+    size_t serial; /* creation order, see cJSON_IndexMark */
+    struct cJSON_index *prev; /* live indexes of the thread, newest first */
+    struct cJSON_index *next;
+};
+
+/*
+ * The indexes of the thread by object address, so struct cJSON keeps the layout of upstream.
+ * Open addressing with linear probing, at most half full. The slots come from malloc, not the hooks,
+ * as hooks that free in bulk would take the table with them; it is freed again once empty.
+ */
+typedef struct index_table
+{
+    cJSON_index **slots;
+    size_t mask;
+    size_t count;
+} index_table;
+
+static CJSON_THREAD_LOCAL index_table object_indexes = { NULL, 0, 0 };
+static CJSON_THREAD_LOCAL cJSON_index *live_indexes = NULL;
+static CJSON_THREAD_LOCAL size_t index_serial = 0;
+
+#define INDEX_MIN_SLOTS 64
+#define INDEX_TABLE_MIN_SLOTS 16
+
+static size_t hash_object(const cJSON * const object)
+{
+    /* nodes sit a few dozen bytes apart, fold the higher bits into the ones the mask keeps */
+    size_t hash = (size_t)object >> 4;
+    hash ^= hash >> 16;
+    hash *= 0x45d9f3bU;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/* the slot holding the index of object, or the empty slot ending its probe path */
+static cJSON_index **index_slot_of(const cJSON * const object)
+{
+    size_t i = hash_object(object) & object_indexes.mask;
+
+    while ((object_indexes.slots[i] != NULL) && (object_indexes.slots[i]->owner != object))
+    {
+        i = (i + 1) & object_indexes.mask;
+    }
+    return &object_indexes.slots[i];
+}
+
+static cJSON_index *index_of(const cJSON * const object)
+{
+    /* threads that never indexed an object don't probe at all */
+    if (object_indexes.count == 0)
+    {
+        return NULL;
+    }
+    return *index_slot_of(object);
+}
+
+static cJSON_bool index_table_add(cJSON_index * const index)
+{
+    index_table old = object_indexes;
+    size_t slots = INDEX_TABLE_MIN_SLOTS;
+    size_t i = 0;
+
+    if (((object_indexes.count + 1) * 2) > (object_indexes.mask + 1))
+    {
+        while (slots < ((object_indexes.count + 1) * 2))
+        {
+            slots <<= 1;
+        }
+        object_indexes.slots = (cJSON_index**)calloc(slots, sizeof(cJSON_index*));
+        if (object_indexes.slots == NULL)
+        {
+            object_indexes = old;
+            return false;
+        }
+        object_indexes.mask = slots - 1;
+        for (i = 0; (old.slots != NULL) && (i <= old.mask); i++)
+        {
+            if (old.slots[i] != NULL)
+            {
+                *index_slot_of(old.slots[i]->owner) = old.slots[i];
+            }
+        }
+        free(old.slots);
+    }
+
+    *index_slot_of(index->owner) = index;
+    object_indexes.count++;
+    return true;
+}
+
+static void index_table_remove(cJSON_index **slot)
+{
+    size_t i = (size_t)(slot - object_indexes.slots);
+    size_t j = i;
+    size_t home = 0;
+
+    if (--object_indexes.count == 0)
+    {
+        free(object_indexes.slots);
+        object_indexes.slots = NULL;
+        object_indexes.mask = 0;
+        return;
+    }
+
+    /* shift the rest of the cluster back so no probe path runs into the hole */
+    for (j = (j + 1) & object_indexes.mask; object_indexes.slots[j] != NULL; j = (j + 1) & object_indexes.mask)
+    {
+        home = hash_object(object_indexes.slots[j]->owner) & object_indexes.mask;
+        /* an entry whose home lies cyclically in (i, j] stays */
+        if ((i <= j) ? ((i < home) && (home <= j)) : ((i < home) || (home <= j)))
+        {
+            continue;
+        }
+        object_indexes.slots[i] = object_indexes.slots[j];
+        i = j;
+    }
+    object_indexes.slots[i] = NULL;
+}
+
+static unsigned int hash_name(const unsigned char *name)
+{
+    /* FNV-1a over the same folding case_insensitive_strcmp compares with */
+    unsigned int hash = 2166136261U;
+    for (; *name != '\0'; name++)
+    {
+        hash ^= (unsigned int)tolower(*name);
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+static void index_put(cJSON_index *index, cJSON *item)
+{
+    unsigned int hash = hash_name((const unsigned char*)item->string);
+    size_t i = hash & index->mask;
+
+    while (index->slots[i].item != NULL)
+    {
+        i = (i + 1) & index->mask;
+    }
+    index->slots[i].item = item;
+    index->slots[i].hash = hash;
+    index->count++;
+}
+
+/* NULL when out of memory, lookups then keep walking the list */
+static cJSON_index *index_create(const cJSON * const object)
+{
+    cJSON_index *index = NULL;
+    cJSON *child = NULL;
+    size_t members = 0;
+    size_t slots = INDEX_MIN_SLOTS;
+
+    for (child = object->child; child != NULL; child = child->next)
+    {
+        members++;
+    }
+    while (slots < (members * 2))
+    {
+        slots <<= 1;
+    }
+
+    index = (cJSON_index*)global_hooks.allocate(sizeof(cJSON_index) + (slots * sizeof(index_slot)));
+    if (index == NULL)
+    {
+        return NULL;
+    }
+    index->owner = object;
+    if (!index_table_add(index))
+    {
+        global_hooks.deallocate(index);
+        return NULL;
+    }
+    index->mask = slots - 1;
+    index->count = 0;
+    index->slots = (index_slot*)(index + 1);
+    memset(index->slots, '\0', slots * sizeof(index_slot));
+    index->serial = ++index_serial;
+    index->prev = NULL;
+    index->next = live_indexes;
+    if (live_indexes != NULL)
+    {
+        live_indexes->prev = index;
+    }
+    live_indexes = index;
+
+    for (child = object->child; child != NULL; child = child->next)
+    {
+        if (child->string != NULL)
+        {
+            index_put(index, child);
+        }
+    }
+
+    return index;
+}
+
+static void index_drop(const cJSON * const object)
+{
+    cJSON_index **slot = NULL;
+    cJSON_index *index = NULL;
+
+    if (object_indexes.count == 0)
+    {
+        return;
+    }
+    slot = index_slot_of(object);
+    index = *slot;
+    if (index == NULL)
+    {
+        return;
+    }
+    if (index->prev != NULL)
+    {
+        index->prev->next = index->next;
+    }
+    else
+    {
+        live_indexes = index->next;
+    }
+    if (index->next != NULL)
+    {
+        index->next->prev = index->prev;
+    }
+    index_table_remove(slot);
+    global_hooks.deallocate(index);
+}
+
+CJSON_PUBLIC(size_t) cJSON_IndexMark(void)
+{
+    return index_serial;
+}
+
+CJSON_PUBLIC(void) cJSON_DropIndexes(size_t mark)
+{
+    /* the list is in creation order, newest first */
+    while ((live_indexes != NULL) && (live_indexes->serial > mark))
+    {
+        index_drop(live_indexes->owner);
+    }
+}
+
+/* item was appended to the members of object */
+static void index_append(const cJSON * const object, cJSON_index * const index, cJSON * const item)
+{
+    if (((index->count + 1) * 2) > (index->mask + 1))
+    {
+        /* grow, the new index takes in item with the rest */
+        index_drop(object);
+        index_create(object);
+        return;
+    }
+    if (item->string != NULL)
+    {
+        index_put(index, item);
+    }
+}
+
+/* replacement took the place of item in the members of object */
+static void index_replace(const cJSON * const object, cJSON_index * const index, const cJSON * const item, cJSON * const replacement)
+{
+    size_t i = 0;
+
+    /* a member under another name would move on the probe paths */
+    if ((item->string == NULL) || (case_insensitive_strcmp((const unsigned char*)item->string, (const unsigned char*)replacement->string) != 0))
+    {
+        index_drop(object);
+        return;
+    }
+
+    for (i = hash_name((const unsigned char*)item->string) & index->mask; index->slots[i].item != NULL; i = (i + 1) & index->mask)
+    {
+        if (index->slots[i].item == item)
+        {
+            index->slots[i].item = replacement;
+            return;
+        }
+    }
+}
+
+static cJSON *index_get(const cJSON_index * const index, const char * const name, const cJSON_bool case_sensitive)
+{
+    unsigned int hash = hash_name((const unsigned char*)name);
+    size_t i = 0;
+    cJSON *item = NULL;
+
+    for (i = hash & index->mask; index->slots[i].item != NULL; i = (i + 1) & index->mask)
+    {
+        if (index->slots[i].hash != hash)
+        {
+            continue;
+        }
+        item = index->slots[i].item;
+        if (case_sensitive ? (strcmp(name, item->string) == 0) : (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)item->string) == 0))
+        {
+            return item;
+        }
+    }
+
+    return NULL;
+}
+
 static cJSON *get_object_item(const cJSON * const object, const char * const name, const cJSON_bool case_sensitive)
 {
     cJSON *current_element = NULL;
+    const cJSON_index *index = NULL;
+    size_t walked = 0;
 
     if ((object == NULL) || (name == NULL))
     {
         return NULL;
     }
 
+    index = index_of(object);
+    if (index != NULL)
+    {
+        return index_get(index, name, case_sensitive);
+    }
+
     current_element = object->child;
     if (case_sensitive)
     {
         while ((current_element != NULL) && (strcmp(name, current_element->string) != 0))
         {
             current_element = current_element->next;
+            walked++;
         }
     }
     else
@@ -1733,9 +2726,16 @@ static cJSON *get_object_item(const cJSON * const object, const char * const nam
         while ((current_element != NULL) && (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)(current_element->string)) != 0))
         {
             current_element = current_element->next;
+            walked++;
         }
     }
 
+    /* a wide object, the next lookups go through an index */
+    if ((walked >= CJSON_INDEX_THRESHOLD) && cJSON_IsObject(object) && !(object->type & cJSON_IsReference))
+    {
+        index_create(object);
+    }
+
     return current_element;
 }
 
@@ -1787,6 +2787,7 @@ static cJSON *create_reference(const cJSON *item, const internal_hooks * const h
 CJSON_PUBLIC(void) cJSON_AddItemToArray(cJSON *array, cJSON *item)
 {
     cJSON *child = NULL;
+    cJSON_index *index = NULL;
 
     if ((item == NULL) || (array == NULL))
     {
@@ -1809,6 +2810,12 @@ CJSON_PUBLIC(void) cJSON_AddItemToArray(cJSON *array, cJSON *item)
         }
         suffix_object(child, item);
     }
+
+    index = index_of(array);
+    if (index != NULL)
+    {
+        index_append(array, index, item);
+    }
 }
 
 CJSON_PUBLIC(void) cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item)
@@ -1896,6 +2903,7 @@ CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON * const it
     /* make sure the detached item doesn't point anywhere anymore */
     item->prev = NULL;
     item->next = NULL;
+    index_drop(parent);
 
     return item;
 }
@@ -1967,10 +2975,13 @@ CJSON_PUBLIC(void) cJSON_InsertItemInArray(cJSON *array, int which, cJSON *newit
     {
         newitem->prev->next = newitem;
     }
+    index_drop(array);
 }
 
 CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON * const item, cJSON * replacement)
 {
+    cJSON_index *index = NULL;
+
     if ((parent == NULL) || (replacement == NULL) || (item == NULL))
     {
         return false;
@@ -1996,6 +3007,11 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON
     {
         parent->child = replacement;
     }
+    index = index_of(parent);
+    if (index != NULL)
+    {
+        index_replace(parent, index, item, replacement);
+    }
 
     item->next = NULL;
     item->prev = NULL;
@@ -129,12 +129,26 @@ then using the CJSON_API_VISIBILITY flag to "export" the same symbols the way CJ
 #define CJSON_NESTING_LIMIT 1000
 #endif
 
+/* An object gets a hash index of its members once a lookup had to walk past this many of them.
+ * It is kept up to date by the cJSON functions that add, replace and remove members. The indexes live in
+ * a table of the thread that built them, keyed by the object's address, so an indexed tree has to be
+ * deleted on that thread. */
+#ifndef CJSON_INDEX_THRESHOLD
+#define CJSON_INDEX_THRESHOLD 32
+#endif
+
 /* returns the version of cJSON as a string */
 CJSON_PUBLIC(const char*) cJSON_Version(void);
 
 /* Supply malloc, realloc and free functions to cJSON */
 CJSON_PUBLIC(void) cJSON_InitHooks(cJSON_Hooks* hooks);
 
+/* Member indexes are allocated through the hooks when a lookup builds them, also on trees allocated before.
+ * Hooks that free in bulk take a mark first and drop the indexes the calling thread built since then
+ * before releasing their memory; the objects keep working and index themselves again when needed. */
+CJSON_PUBLIC(size_t) cJSON_IndexMark(void);
+CJSON_PUBLIC(void) cJSON_DropIndexes(size_t mark);
+
 /* Memory Management: the caller is always responsible to free the results from all variants of cJSON_Parse (with cJSON_Delete) and cJSON_Print (with stdlib free, cJSON_Hooks.free_fn, or cJSON_free as appropriate). The exception is cJSON_PrintPreallocated, where the caller has full responsibility of the buffer. */
 /* Supply a block of JSON, and this returns a cJSON object you can interrogate. */
 CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value);
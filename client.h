@@ -0,0 +1,148 @@
+#ifndef _CLIENT_H_
+#define _CLIENT_H_
+
+#include <stdint.h>
+#include <sys/time.h>
+#include "connpool.h"
+#include "cJSON.h"
+#include "nova.h"
+#include "thriftgeneric.h"
+#include "thriftschema.h"
+#include "decoder.h"
+#include "compress.h"
+
+typedef struct nova_client
+{
+    const char *host;
+    int port;
+    struct timeval timeout;
+    int debug;
+    nova_pool *pool;
+    int64_t seq_no; /* last nova seq_no issued */
+    nova_decoder dec;  /* reused by blocking invokes */
+    nova_buf send_buf; /* frames of blocking invokes that are not sent as slices */
+    const thrift_schema *schema; /* methods it describes are called natively, the rest through GenericService */
+    int protocol;                /* THRIFT_BINARY or THRIFT_COMPACT, for calls whose method does not pin one */
+    nova_compressor compress;    /* generic payloads, off until compress.codec is set */
+} nova_client;
+
+typedef struct nova_resp
+{
+    char *json; /* generic service response, NUL terminated */
+    int json_len;
+    int exception; /* the server answered with a TApplicationException, json describes it */
+    char *attach; /* nova attachment, NUL terminated, NULL when empty */
+    int attach_len;
+} nova_resp;
+
+nova_client *nova_client_create(const char *host, int port, struct timeval timeout);
+void nova_client_destroy(nova_client *cli);
+
+/**
+ *  invoke service.method over a pooled connection, typed when cli->schema describes it,
+ *  otherwise through GenericService
+ *
+ *  @return SW_OK on success, resp must be released by nova_resp_free
+ */
+int nova_client_invoke(nova_client *cli,
+                       const char *service, const char *method,
+                       const char *json_args, const char *json_attach,
+                       nova_resp *resp);
+
+void nova_resp_free(nova_resp *resp);
+
+/* split "service.method" at the last dot, both parts are malloced */
+int nova_split_method(const char *full, char **service, char **method);
+
+/* generic call arguments are a flat kv object, nested values are packed as json strings */
+char *nova_generic_args(cJSON *root);
+
+#define NOVA_FRAME_IOV (2 + GENERIC_IOV) /* nova header, attachment, thrift slices */
+
+/* one GenericService.invoke frame as slices, strings are referenced, not copied */
+typedef struct nova_frame_iov
+{
+    struct iovec iov[NOVA_FRAME_IOV];
+    int iovcnt;
+    int32_t len; /* whole frame */
+    char head[NOVA_HEADER_COMMON_LEN + GENERIC_SERVICE_LEN + GENERIC_METHOD_LEN];
+    char body[GENERIC_COMMON_LEN];
+} nova_frame_iov;
+
+/* frame stays valid as long as the strings it points to */
+int nova_pack_call_iov(const char *service, const char *method,
+                       const char *json_args, const char *json_attach,
+                       int64_t seq_no, nova_frame_iov *frame);
+
+/* exact size of one GenericService.invoke frame */
+int32_t nova_frame_len(int32_t service_len, int32_t method_len, int32_t args_len, int32_t attach_len);
+
+/**
+ *  encode one GenericService.invoke frame straight into out in a single pass,
+ *  nova seq_no and thrift seq both carry seq_no
+ *
+ *  @param out  at least nova_frame_len bytes
+ *
+ *  @return bytes written, 0 when the attachment does not fit a nova header
+ */
+int32_t nova_encode_call(char *out, int64_t seq_no,
+                         const char *service, int32_t service_len,
+                         const char *method, int32_t method_len,
+                         const char *json_args, int32_t args_len,
+                         const char *json_attach, int32_t attach_len);
+
+/* the schema entry of service.method, NULL when it goes through GenericService */
+const thrift_method *nova_client_method(nova_client *cli, const char *service, const char *method);
+
+/* append one frame calling m natively, args are encoded as its thrift argument struct */
+int nova_encode_typed_buf(nova_buf *out, const thrift_method *m, int proto, int64_t seq_no,
+                          const char *json_args, const char *json_attach);
+
+/* the protocol a call to m goes out in, m may be NULL for generic calls */
+int nova_client_protocol(nova_client *cli, const thrift_method *m);
+
+/* append one frame for service.method, typed when cli->schema describes it, generic otherwise.
+   generic arguments are compressed here when cli->compress is on */
+int nova_client_encode(nova_client *cli, nova_buf *out, int64_t seq_no,
+                       const char *service, const char *method,
+                       const char *json_args, const char *json_attach);
+
+#define NOVA_SEQ_OFFSET (4 + 2 + 2 + 1 + 4 + 4 + 4 + GENERIC_SERVICE_LEN + 4 + GENERIC_METHOD_LEN) /* in generic frames */
+#define THRIFT_SEQ_OFFSET (4 + 4 + GENERIC_METHOD_LEN)                                           /* from the thrift body */
+
+/* rewrite both seq_no fields of a generic or typed frame */
+int nova_frame_set_seq(char *frame, int32_t frame_len, int64_t seq_no);
+
+/* invariant bytes of every generic frame sharing one attachment, serialized once */
+typedef struct nova_frame_tpl
+{
+    char *attach;      /* the attachment baked into head */
+    char *head;        /* nova header and thrift prefix, up to the service length */
+    int32_t head_len;
+    int32_t head_size; /* nova head_size, where the thrift body starts */
+} nova_frame_tpl;
+
+int nova_frame_tpl_init(nova_frame_tpl *tpl, const char *json_attach);
+void nova_frame_tpl_free(nova_frame_tpl *tpl);
+
+/* exact size of a frame written by nova_frame_tpl_write */
+int32_t nova_frame_tpl_len(const nova_frame_tpl *tpl, int32_t service_len, int32_t method_len, int32_t args_len);
+
+/* copy the template into out and patch msg_size, both seq_no and the variable fields, return the frame length */
+int32_t nova_frame_tpl_write(const nova_frame_tpl *tpl, char *out, int64_t seq_no,
+                             const char *service, int32_t service_len,
+                             const char *method, int32_t method_len,
+                             const char *json_args, int32_t args_len);
+
+/**
+ *  decode a received frame into resp
+ *
+ *  @param schema  decodes replies of typed calls, may be NULL
+ *  @param seq_no  seq_no of the frame, -1 when the nova header is unreadable
+ *
+ *  @return SW_OK when resp holds a response, an exception reply is one too
+ */
+int nova_unpack_resp(const char *recv_buf, int32_t recv_msg_size, const thrift_schema *schema,
+                     int debug, int64_t *seq_no, nova_resp *resp);
+
+#endif
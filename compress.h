@@ -0,0 +1,71 @@
+#ifndef _COMPRESS_H_
+#define _COMPRESS_H_
+
+#include <stdint.h>
+#include "decoder.h"
+
+/*
+ * opt-in compression of generic call payloads, negotiated through the nova attachment
+ *
+ * a client that reads compressed replies adds "accept_compress":"lz4" to every attachment,
+ * a payload that went out compressed is flagged by "compress":"lz4" in the attachment of its frame.
+ * requests go out compressed only once a reply attachment carried either of them, older servers never see one.
+ * the json string of GenericService then carries a 4 byte big endian raw length followed by one LZ4 block,
+ * written and read by liblz4
+ */
+
+/* liblz4 is optional, without its header payloads are neither compressed nor inflated and -z is refused */
+#if defined(__has_include)
+#if __has_include(<lz4.h>)
+#define NOVA_HAVE_LZ4 1
+#endif
+#endif
+
+#define NOVA_COMPRESS_NONE 0
+#define NOVA_COMPRESS_LZ4 1
+
+#define NOVA_COMPRESS_MIN 1024 /* default threshold, smaller payloads rarely pay for the cpu */
+#define NOVA_COMPRESS_HEAD 4   /* raw length in front of the block */
+
+#define NOVA_ATTACH_COMPRESS "compress"      /* codec of the payload in this frame */
+#define NOVA_ATTACH_ACCEPT "accept_compress" /* codec the sender can read */
+
+/* replace the contents of out with the compressed payload, SW_ERR when it would not be smaller than data */
+int nova_compress_payload(nova_buf *out, int codec, const char *data, int32_t len);
+
+/* malloced and NUL terminated, NULL when the payload is malformed */
+char *nova_decompress_payload(int codec, const char *data, int32_t len, int32_t *out_len);
+
+/* the codec a frame attachment flags its payload with, NOVA_COMPRESS_NONE when there is none, -1 when it is unknown */
+int nova_attach_codec(const char *attach, int32_t attach_len);
+
+/* the codec a reply attachment shows its sender reads, by accept_compress or a compressed payload, NOVA_COMPRESS_NONE otherwise */
+int nova_attach_accepts(const char *attach, int32_t attach_len);
+
+/* compression settings of a client, a zeroed one sends everything as it is */
+typedef struct nova_compressor
+{
+    int codec;        /* NOVA_COMPRESS_* */
+    int32_t min_size; /* payloads below it go out as they are */
+    int accepted;     /* a reply showed the server reads codec, until then payloads only offer it */
+    nova_buf buf;     /* payload of the last compressed call */
+    char *attach_src; /* attachment the two below are derived from */
+    char *attach[2];  /* attach_src advertising the codec, for plain and compressed payloads */
+} nova_compressor;
+
+/* note the attachment of a reply, compression starts once one shows the server reads the codec */
+void nova_compressor_learn(nova_compressor *c, const char *attach, int32_t attach_len);
+
+/**
+ *  compress the arguments of one generic call when the server accepts it and they are large enough and shrink
+ *
+ *  @param args    replaced by the compressed payload, valid until the next call
+ *  @param attach  replaced by the negotiating attachment, valid until the attachment changes
+ *
+ *  @return SW_ERR when the attachment is not a JSON object
+ */
+int nova_compressor_apply(nova_compressor *c, const char **args, int32_t *args_len, const char **attach);
+
+void nova_compressor_free(nova_compressor *c);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef _CONN_POOL_H_
+#define _CONN_POOL_H_
+
+#include <stdint.h>
+#include <sys/time.h>
+#include "resolver.h"
+
+#define POOL_MAX_IDLE_PER_HOST 16
+#define POOL_IDLE_TIMEOUT_MS 60000
+#define CONNECT_ATTEMPT_DELAY_MS 250 /* Happy Eyeballs stagger between addresses */
+
+typedef struct nova_conn
+{
+    int fd;
+    struct nova_pool_host *host;
+    int64_t last_used; /* monotonic ms */
+    struct nova_conn *next;
+} nova_conn;
+
+/* keep-alive connections of one (host, port), most recently used first */
+typedef struct nova_pool_host
+{
+    char *host;
+    int port;
+    nova_conn *idle;
+    int idle_count;
+    struct nova_pool_host *next;
+} nova_pool_host;
+
+typedef struct nova_pool
+{
+    nova_pool_host *hosts;
+    int max_idle;        /* idle connections kept per host */
+    int64_t idle_timeout; /* ms */
+    struct timeval timeout; /* connect, send and recv */
+    nova_dns dns;
+} nova_pool;
+
+int64_t nova_now_ms();
+int64_t nova_now_us();
+
+/**
+ *  resolve host through dns (NULL skips the cache) and race connects to its addresses,
+ *  resolution and connect together are bounded by timeout
+ *
+ *  @return a blocking socket with timeout applied to send and recv, -1 on failure
+ */
+int socket_connect(nova_dns *dns, const char *host, int port, const struct timeval *timeout);
+
+/* start a non-blocking connect to addr, *connected is set when it completed right away, -1 leaves errno in *err */
+int nova_connect_start(const nova_addr *addr, int *connected, int *err);
+
+/* options every connected socket gets: no delay, keepalive, and timeout on send and recv */
+void nova_connect_ready(int fd, const struct timeval *timeout);
+
+nova_pool *nova_pool_create(int max_idle, int64_t idle_timeout, struct timeval timeout);
+void nova_pool_destroy(nova_pool *pool);
+
+/* reuse a healthy idle connection of (host, port) or open a new one, NULL on failure */
+nova_conn *nova_pool_acquire(nova_pool *pool, const char *host, int port);
+
+/* a healthy idle connection of (host, port), NULL when there is none, nothing is connected */
+nova_conn *nova_pool_idle(nova_pool *pool, const char *host, int port);
+
+/* a conn of (host, port) owning fd, for sockets connected by the caller, released like acquired ones */
+nova_conn *nova_pool_wrap(nova_pool *pool, const char *host, int port, int fd);
+
+/* give conn back to the pool, a conn not reusable (broken, out of sync) is closed */
+void nova_pool_release(nova_pool *pool, nova_conn *conn, int reusable);
+
+/* close idle connections unused for longer than idle_timeout, return the number closed */
+int nova_pool_evict(nova_pool *pool);
+
+/* an idle conn is healthy when the peer has neither closed it nor sent unsolicited bytes */
+int nova_conn_alive(nova_conn *conn);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef _DECODER_H_
+#define _DECODER_H_
+
+#include <stdint.h>
+
+#define RECV_BUF_SIZE 8192                    /* initial receive buffer, grown on demand */
+#define NOVA_MAX_FRAME_SIZE (64 * 1024 * 1024) /* refuse larger msg_size as a corrupt stream */
+#define NOVA_FRAME_PREFIX 8                   /* msg_size, magic and head_size, checked before the body */
+
+/* growable byte buffer, kept across calls so steady state receives never allocate */
+typedef struct nova_buf
+{
+    char *data;
+    int32_t len;
+    int32_t cap;
+} nova_buf;
+
+/* make room for need bytes in total, growing geometrically */
+int nova_buf_reserve(nova_buf *buf, int32_t need);
+void nova_buf_free(nova_buf *buf);
+
+#define NOVA_DECODE_MORE 0   /* chunk used up, no whole frame left in it */
+#define NOVA_DECODE_FRAME 1  /* one frame returned, feed the rest of the chunk again */
+#define NOVA_DECODE_ERROR -1 /* corrupt stream, sticky until nova_decoder_reset */
+
+/**
+ *  incremental nova frame decoder, fed byte chunks as they arrive
+ *
+ *  a frame lying whole inside a chunk is returned in place, only frames split
+ *  across chunks are gathered in buf. a zeroed decoder is ready to use
+ */
+typedef struct nova_decoder
+{
+    nova_buf buf;     /* the split frame gathered so far */
+    int32_t msg_size; /* of the split frame, 0 until its prefix is checked */
+    int emitted;      /* buf holds the frame returned by the last call */
+    int failed;
+} nova_decoder;
+
+/**
+ *  consume *data up to the end of the next whole frame
+ *
+ *  @param data,len   the chunk, advanced past what was consumed
+ *  @param frame      valid until the next call, points into the chunk or into dec->buf
+ *
+ *  @return NOVA_DECODE_FRAME, NOVA_DECODE_MORE or NOVA_DECODE_ERROR
+ */
+int nova_decoder_feed(nova_decoder *dec, const char **data, int32_t *len, const char **frame, int32_t *frame_len);
+
+/**
+ *  let the caller read straight into the decoder, never past the current prefix or frame,
+ *  so nothing of the next frame is consumed. call nova_decoder_commit with what was written,
+ *  then nova_decoder_feed with an empty chunk
+ *
+ *  @return NULL when the buffer cannot grow
+ */
+char *nova_decoder_space(nova_decoder *dec, int32_t *room);
+void nova_decoder_commit(nova_decoder *dec, int32_t n);
+
+/* bytes of a split frame still needed, 0 when no frame is split or its size is unknown yet */
+int32_t nova_decoder_pending(const nova_decoder *dec);
+
+/* drop any partial frame and the error, the buffer is kept */
+void nova_decoder_reset(nova_decoder *dec);
+void nova_decoder_free(nova_decoder *dec);
+
+/* a split frame is buffered, the stream is not at a frame boundary */
+static inline int nova_decoder_partial(const nova_decoder *dec)
+{
+    return dec->buf.len > 0 && !dec->emitted;
+}
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef _ENGINE_H_
+#define _ENGINE_H_
+
+#include <stdint.h>
+#include "client.h"
+#include "inflight.h"
+#include "uring.h"
+
+#define NOVA_ENGINE_EPOLL 0
+#define NOVA_ENGINE_URING 1
+
+#define NOVA_ENGINE_RECV_CHUNK (64 * 1024) /* epoll reads land here and are decoded in place */
+
+#define NOVA_REQ_OK 1
+#define NOVA_REQ_ERR 0
+#define NOVA_REQ_TIMEOUT -3
+#define NOVA_REQ_EXCEPTION -4 /* answered with a TApplicationException */
+
+typedef struct nova_engine nova_engine;
+typedef struct nova_req nova_req;
+
+/**
+ *  completion callback, called exactly once per submitted request
+ *
+ *  @param status NOVA_REQ_OK, NOVA_REQ_EXCEPTION, NOVA_REQ_ERR or NOVA_REQ_TIMEOUT
+ *  @param resp   valid when status is NOVA_REQ_OK or NOVA_REQ_EXCEPTION, released after the callback returns,
+ *                steal its fields (and NULL them) to keep them
+ */
+typedef void (*nova_req_cb)(nova_engine *eng, int status, nova_resp *resp, void *udata);
+
+typedef struct nova_engine_conn
+{
+    nova_conn *conn;
+    int idx;
+    int inflight;
+    int abandoned;  /* timed out requests whose replies may still arrive */
+    int want_write; /* EPOLLOUT registered */
+    int dirty;      /* on the flush list */
+    struct nova_engine_conn *next_dirty;
+
+    /* a new connection is connected by the loop, frames queue up in out_buf until it is */
+    int connecting;
+    int addr_next;            /* the address of eng->addrs tried after the current attempt */
+    int64_t connect_deadline; /* monotonic ms, the attempt gives way to the next address */
+    nova_addr addr;           /* io_uring only: read by the kernel until the connect completes */
+
+    /* frames queued by submit */
+    char *out_buf;
+    int out_len;
+    int out_off;
+    int out_cap;
+
+    /* io_uring only: frames owned by the kernel until the send completes */
+    char *send_buf;
+    int send_len;
+    int send_off;
+    int send_cap;
+    int sending;
+    int recv_armed;
+    int ring_ops;       /* submitted operations not finished yet */
+    int closing;        /* waiting for ring_ops to drain before release */
+    int close_reusable;
+
+    nova_decoder dec; /* keeps a reply split across reads */
+} nova_engine_conn;
+
+struct nova_req
+{
+    int64_t seq_no;
+    int64_t deadline; /* monotonic ms */
+    nova_engine_conn *ec;
+    nova_req_cb cb;
+    void *udata;
+    struct nova_req *prev; /* deadline ordered list */
+    struct nova_req *next;
+};
+
+typedef struct nova_engine_stats
+{
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t failed;
+    uint64_t timeouts;
+    uint64_t exceptions;
+    uint64_t syscalls; /* epoll_wait, epoll_ctl, send, recv or io_uring_enter */
+} nova_engine_stats;
+
+struct nova_engine
+{
+    nova_client *cli;
+    int backend;
+    int epfd;
+#ifdef NOVA_HAVE_URING
+    nova_uring ring;
+    int multishot; /* cleared when the kernel rejects multishot recv */
+#endif
+    int64_t timeout; /* ms, per request and per connect */
+
+    nova_engine_conn *conns;
+    int conn_count;
+    int next_conn;
+    nova_engine_conn *dirty;
+    int connecting; /* conns with a connect in progress */
+    nova_addr addrs[NOVA_DNS_MAX_ADDRS]; /* of cli->host, resolved once by nova_engine_create */
+    int addr_count;
+
+    nova_inflight inflight;
+    nova_req *oldest; /* deadlines are monotonic, requests time out from the head */
+    nova_req *newest;
+    nova_req *free_reqs;
+
+    nova_engine_stats stats;
+    nova_frame_tpl tpl; /* rebuilt when the attachment changes */
+    nova_buf typed_buf; /* typed, compact and compressed frames are encoded here before they are queued */
+    char *recv_chunk;   /* epoll only, shared by every conn since it is drained before the next read */
+    void *data; /* owner context, untouched by the engine */
+};
+
+/**
+ *  drive conn_count connections of cli->pool from one thread, requests time out after cli->timeout.
+ *  cli->host is resolved here, before any nova_engine_poll, so new connections never wait for DNS
+ *
+ *  @param backend NOVA_ENGINE_EPOLL or NOVA_ENGINE_URING, io_uring falls back to epoll
+ *                 when the kernel does not support it, check eng->backend
+ */
+nova_engine *nova_engine_create(nova_client *cli, int conn_count, int backend);
+
+/* idle connections go back to cli->pool, in-flight requests fail */
+void nova_engine_destroy(nova_engine *eng);
+
+/* queue one generic call, the frame is flushed by the next nova_engine_poll */
+int nova_engine_submit(nova_engine *eng,
+                       const char *service, const char *method,
+                       const char *json_args, const char *json_attach,
+                       nova_req_cb cb, void *udata);
+
+/* queue a frame built by nova_client_encode, it is patched in place with the next seq_no so it can be reused */
+int nova_engine_submit_frame(nova_engine *eng, char *frame, int32_t frame_len, nova_req_cb cb, void *udata);
+
+/* run one loop iteration waiting at most timeout_ms, return the number of completed requests */
+int nova_engine_poll(nova_engine *eng, int timeout_ms);
+
+static inline int nova_engine_inflight(nova_engine *eng)
+{
+    return (int)eng->inflight.size;
+}
+
+#endif
@@ -0,0 +1,326 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "fuzz.h"
+
+/*
+ * stand-in for the libFuzzer main where clang is not around
+ *
+ *   target FILE...              run each file once, AFL calls it as target @@
+ *   target                      run stdin once
+ *   target -runs=N [-seed=S]    N random mutations of the seeds of the target and of FILE...
+ *   target -write_seeds=DIR     dump the seeds as a starting corpus
+ *   -close_fd_mask=M            as in libFuzzer, 1 closes stdout and 2 stderr of the target,
+ *                               sanitizer reports still get through
+ *
+ * a crash is left to the sanitizers, the mutated input that caused it is saved to crash-input
+ */
+
+int LLVMFuzzerInitialize(int *argc, char ***argv) __attribute__((weak));
+void __sanitizer_set_death_callback(void (*callback)(void)) __attribute__((weak));
+void __sanitizer_set_report_fd(void *fd) __attribute__((weak));
+
+#define MAX_INPUT (1 << 20)
+
+static int read_file(FILE *fp, nova_buf *out)
+{
+    size_t n;
+
+    out->len = 0;
+    for (;;)
+    {
+        if (!nova_buf_reserve(out, out->len + 4096))
+        {
+            return SW_ERR;
+        }
+        n = fread(out->data + out->len, 1, 4096, fp);
+        out->len += n;
+        if (n < 4096)
+        {
+            return ferror(fp) ? SW_ERR : SW_OK;
+        }
+    }
+}
+
+static void save(const char *path, const nova_buf *input)
+{
+    FILE *fp = fopen(path, "wb");
+
+    if (fp == NULL)
+    {
+        perror(path);
+        return;
+    }
+    fwrite(input->data, 1, input->len, fp);
+    fclose(fp);
+}
+
+static nova_buf *current; /* the mutated input under test */
+
+static void save_current()
+{
+    if (current)
+    {
+        save("crash-input", current);
+        current = NULL;
+    }
+}
+
+static void on_abort(int sig)
+{
+    save_current();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static int report_fd = 2; /* stderr as it was before close_fds */
+
+/* the decoders report bad input on stdout and stderr, a long run would drown in it */
+static void close_fds(int mask)
+{
+    int null = open("/dev/null", O_WRONLY);
+    int err = dup(2);
+
+    if (null < 0 || err < 0)
+    {
+        return;
+    }
+    if (__sanitizer_set_report_fd)
+    {
+        __sanitizer_set_report_fd((void *)(intptr_t)err);
+    }
+    fflush(NULL);
+    if (mask & 1)
+    {
+        dup2(null, 1);
+    }
+    if (mask & 2)
+    {
+        dup2(null, 2);
+    }
+    report_fd = err;
+    close(null);
+}
+
+static uint32_t rnd(uint32_t n)
+{
+    return n ? (uint32_t)random() % n : 0;
+}
+
+/* lengths and counts are what the decoders trust, so they get the interesting values */
+static void mutate(nova_buf *in, const nova_buf *seeds, int nseeds)
+{
+    static const int32_t interesting[] = {0, 1, -1, 0x7f, 0x80, 0xff, 0x7fff, 0x8000, 0xffff,
+                                          0x7fffffff, (int32_t)0x80000000, 37, 93, 4096};
+    int32_t pos, len, v;
+    const nova_buf *other;
+
+    pos = rnd(in->len);
+    switch (rnd(8))
+    {
+    case 0:
+        if (in->len)
+        {
+            in->data[pos] ^= 1 << rnd(8);
+        }
+        break;
+    case 1:
+        if (in->len)
+        {
+            in->data[pos] = (char)rnd(256);
+        }
+        break;
+    case 2:
+        if (in->len >= 4)
+        {
+            v = interesting[rnd(sizeof(interesting) / sizeof(interesting[0]))];
+            pos = rnd(in->len - 3);
+            if (rnd(2))
+            {
+                in->data[pos] = v >> 24;
+                in->data[pos + 1] = v >> 16;
+                in->data[pos + 2] = v >> 8;
+                in->data[pos + 3] = v;
+            }
+            else
+            {
+                memcpy(in->data + pos, &v, 4);
+            }
+        }
+        break;
+    case 3:
+        in->len = rnd(in->len + 1);
+        break;
+    case 4:
+        len = rnd(in->len - pos + 1);
+        memmove(in->data + pos, in->data + pos + len, in->len - pos - len);
+        in->len -= len;
+        break;
+    case 5:
+        len = 1 + rnd(16);
+        if (in->len + len <= MAX_INPUT && nova_buf_reserve(in, in->len + len))
+        {
+            memmove(in->data + pos + len, in->data + pos, in->len - pos);
+            in->len += len;
+            while (len--)
+            {
+                in->data[pos + len] = (char)rnd(256);
+            }
+        }
+        break;
+    case 6:
+        /* duplicate a slice, deep nesting and repeated fields come out of this */
+        len = rnd(in->len - pos + 1);
+        if (len && in->len + len <= MAX_INPUT && nova_buf_reserve(in, in->len + len))
+        {
+            memmove(in->data + pos + len, in->data + pos, in->len - pos);
+            in->len += len;
+        }
+        break;
+    default:
+        /* splice the tail of another seed */
+        other = &seeds[rnd(nseeds)];
+        len = rnd(other->len + 1);
+        if (pos + len <= MAX_INPUT && nova_buf_reserve(in, pos + len))
+        {
+            memcpy(in->data + pos, other->data + other->len - len, len);
+            in->len = pos + len;
+        }
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    nova_buf seeds[FUZZ_MAX_SEEDS + 64];
+    nova_buf input = {0};
+    const char *write_seeds = NULL;
+    char path[4096];
+    long runs = -1, run;
+    unsigned seed = 1;
+    int fd_mask = 0;
+    int nseeds, nfiles = 0, i, k;
+    FILE *fp;
+
+    if (LLVMFuzzerInitialize)
+    {
+        LLVMFuzzerInitialize(&argc, &argv);
+    }
+
+    memset(seeds, 0, sizeof(seeds));
+    nseeds = fuzz_seeds(seeds, FUZZ_MAX_SEEDS);
+    for (i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "-runs=", 6) == 0)
+        {
+            runs = atol(argv[i] + 6);
+            continue;
+        }
+        if (strncmp(argv[i], "-seed=", 6) == 0)
+        {
+            seed = (unsigned)atol(argv[i] + 6);
+            continue;
+        }
+        if (strncmp(argv[i], "-close_fd_mask=", 15) == 0)
+        {
+            fd_mask = atoi(argv[i] + 15);
+            continue;
+        }
+        if (strncmp(argv[i], "-write_seeds=", 13) == 0)
+        {
+            write_seeds = argv[i] + 13;
+            continue;
+        }
+        if (argv[i][0] == '-')
+        {
+            fprintf(stderr, "ERROR, unknown option %s\n", argv[i]);
+            return 1;
+        }
+
+        fp = fopen(argv[i], "rb");
+        if (fp == NULL || !read_file(fp, &input))
+        {
+            perror(argv[i]);
+            return 1;
+        }
+        fclose(fp);
+        nfiles++;
+        if (runs < 0)
+        {
+            LLVMFuzzerTestOneInput((const uint8_t *)input.data, input.len);
+        }
+        else if (nseeds < (int)(sizeof(seeds) / sizeof(seeds[0])))
+        {
+            nova_buf_reserve(&seeds[nseeds], input.len);
+            memcpy(seeds[nseeds].data, input.data, input.len);
+            seeds[nseeds++].len = input.len;
+        }
+    }
+
+    if (fd_mask)
+    {
+        close_fds(fd_mask);
+    }
+    if (write_seeds)
+    {
+        for (i = 0; i < nseeds; i++)
+        {
+            snprintf(path, sizeof(path), "%s/seed-%d", write_seeds, i);
+            save(path, &seeds[i]);
+        }
+        printf("wrote %d seeds to %s\n", nseeds, write_seeds);
+    }
+    else if (runs < 0 && nfiles == 0)
+    {
+        if (!read_file(stdin, &input))
+        {
+            perror("stdin");
+            return 1;
+        }
+        LLVMFuzzerTestOneInput((const uint8_t *)input.data, input.len);
+    }
+    else if (runs >= 0)
+    {
+        srandom(seed);
+        signal(SIGABRT, on_abort);
+        signal(SIGSEGV, on_abort);
+        if (__sanitizer_set_death_callback)
+        {
+            __sanitizer_set_death_callback(save_current);
+        }
+        for (i = 0; i < nseeds; i++)
+        {
+            LLVMFuzzerTestOneInput((const uint8_t *)seeds[i].data, seeds[i].len);
+        }
+        for (run = 0; run < runs && nseeds > 0; run++)
+        {
+            const nova_buf *from = &seeds[rnd(nseeds)];
+
+            if (!nova_buf_reserve(&input, from->len + 1))
+            {
+                return 1;
+            }
+            memcpy(input.data, from->data, from->len);
+            input.len = from->len;
+            for (k = 1 + rnd(6); k > 0; k--)
+            {
+                mutate(&input, seeds, nseeds);
+            }
+            current = &input;
+            LLVMFuzzerTestOneInput((const uint8_t *)input.data, input.len);
+            current = NULL;
+        }
+        dprintf(report_fd, "%ld runs over %d seeds, seed=%u\n", run, nseeds, seed);
+    }
+
+    for (i = 0; i < nseeds; i++)
+    {
+        nova_buf_free(&seeds[i]);
+    }
+    nova_buf_free(&input);
+    return 0;
+}
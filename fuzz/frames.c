@@ -0,0 +1,76 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "fuzz.h"
+#include "thriftprotocol.h"
+#include "thriftgeneric.h"
+
+void fuzz_generic_reply(nova_buf *body, int proto, int32_t seq, const char *json, int32_t json_len)
+{
+    thrift_writer w;
+
+    body->len = 0;
+    thrift_writer_init(&w, body, proto);
+    thrift_write_message_begin(&w, GENERIC_METHOD, GENERIC_METHOD_LEN, T_REPLY, seq);
+    thrift_write_struct_begin(&w);
+    thrift_write_field_begin(&w, TYPE_STRING, 0);
+    thrift_write_string(&w, json, json_len);
+    thrift_write_struct_end(&w);
+}
+
+void fuzz_exception_reply(nova_buf *body, int proto, const char *method, int32_t seq, int type, const char *message)
+{
+    thrift_writer w;
+
+    body->len = 0;
+    thrift_writer_init(&w, body, proto);
+    thrift_write_message_begin(&w, method, strlen(method), T_EX, seq);
+    thrift_write_struct_begin(&w);
+    thrift_write_field_begin(&w, TYPE_STRING, 1);
+    thrift_write_string(&w, message, strlen(message));
+    thrift_write_field_begin(&w, TYPE_I32, 2);
+    thrift_write_i32(&w, type);
+    thrift_write_struct_end(&w);
+}
+
+int fuzz_frame(nova_buf *out, const char *service, const char *method, const char *attach,
+               int64_t seq_no, const nova_buf *body)
+{
+    swNova_Header hdr;
+    int32_t head_len;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = NOVA_MAGIC;
+    hdr.version = 1;
+    hdr.service_name = (char *)service;
+    hdr.service_len = strlen(service);
+    hdr.method_name = (char *)method;
+    hdr.method_len = strlen(method);
+    hdr.attach = (char *)attach;
+    hdr.attach_len = strlen(attach);
+    hdr.seq_no = seq_no;
+    hdr.head_size = NOVA_HEADER_COMMON_LEN + hdr.service_len + hdr.method_len + hdr.attach_len;
+
+    out->len = 0;
+    if (!nova_buf_reserve(out, hdr.head_size + body->len))
+    {
+        return SW_ERR;
+    }
+    head_len = swNova_pack_head(&hdr, body->len, out->data);
+    memcpy(out->data + head_len, attach, hdr.attach_len);
+    memcpy(out->data + hdr.head_size, body->data, body->len);
+    out->len = hdr.head_size + body->len;
+    return SW_OK;
+}
+
+char *fuzz_copy(const uint8_t *data, size_t size)
+{
+    char *copy = malloc(size ? size : 1);
+
+    if (copy == NULL)
+    {
+        abort();
+    }
+    memcpy(copy, data, size);
+    return copy;
+}
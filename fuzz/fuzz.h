@@ -0,0 +1,33 @@
+#ifndef _FUZZ_H_
+#define _FUZZ_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "client.h"
+
+/*
+ * decoder fuzz targets: each fuzz/<name>_fuzz.c is a libFuzzer target (LLVMFuzzerTestOneInput) that also
+ * builds its own seed frames with the encoders of the tree. linked with fuzz/driver.c instead of
+ * -fsanitize=fuzzer it replays files (AFL runs it with @@) or mutates the seeds by itself
+ */
+
+#define FUZZ_MAX_SEEDS 32
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/* append the seed inputs of the target to seeds, return how many */
+int fuzz_seeds(nova_buf *seeds, int max);
+
+/* thrift bodies of a GenericService.invoke reply carrying json and of a TApplicationException */
+void fuzz_generic_reply(nova_buf *body, int proto, int32_t seq, const char *json, int32_t json_len);
+void fuzz_exception_reply(nova_buf *body, int proto, const char *method, int32_t seq, int type, const char *message);
+
+/* a whole nova frame around body */
+int fuzz_frame(nova_buf *out, const char *service, const char *method, const char *attach,
+               int64_t seq_no, const nova_buf *body);
+
+/* a copy of data in a buffer of its own, so ASan catches reads past the end */
+char *fuzz_copy(const uint8_t *data, size_t size);
+
+#endif
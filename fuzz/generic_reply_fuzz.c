@@ -0,0 +1,43 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "fuzz.h"
+
+/* thrift bodies of GenericService replies, binary and compact */
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    char *buf = fuzz_copy(data, size);
+    char *json = NULL;
+
+    if (thrift_generic_unpack(buf, size, &json))
+    {
+        free(json);
+    }
+    json = NULL;
+    if (thrift_exception_unpack(buf, size, &json))
+    {
+        free(json);
+    }
+    free(buf);
+    return 0;
+}
+
+int fuzz_seeds(nova_buf *seeds, int max)
+{
+    static const char *jsons[] = {"{\"ok\":true}", "[1,2.5,\"\\u4e2d\"]", "", "null"};
+    int proto, i, n = 0;
+
+    for (proto = THRIFT_BINARY; proto <= THRIFT_COMPACT; proto++)
+    {
+        for (i = 0; i < (int)(sizeof(jsons) / sizeof(jsons[0])) && n < max; i++)
+        {
+            fuzz_generic_reply(&seeds[n++], proto, i, jsons[i], strlen(jsons[i]));
+        }
+        if (n < max)
+        {
+            fuzz_exception_reply(&seeds[n++], proto, GENERIC_METHOD, 7, THRIFT_EX_UNKNOWN_METHOD, "no such method");
+        }
+    }
+    return n;
+}
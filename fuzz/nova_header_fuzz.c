@@ -0,0 +1,62 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "fuzz.h"
+
+/* swNova_unpack needs the header only, swNova_unpack_view the whole packet, otherwise they agree on every field */
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    swNova_HeaderView view;
+    swNova_Header header;
+    char *buf = fuzz_copy(data, size);
+    int ok_view, ok_copy;
+
+    ok_view = swNova_unpack_view(buf, size, &view);
+    memset(&header, 0, sizeof(header));
+    ok_copy = swNova_unpack(buf, size, &header);
+    if (ok_view != (ok_copy && header.msg_size <= (int32_t)size))
+    {
+        abort();
+    }
+    if (ok_view)
+    {
+        if (view.msg_size != header.msg_size || view.magic != header.magic || view.head_size != header.head_size
+            || view.version != header.version || view.ip != header.ip || view.port != header.port
+            || view.seq_no != header.seq_no || view.service_len != header.service_len
+            || view.method_len != header.method_len || view.attach_len != header.attach_len
+            || memcmp(view.service_name, header.service_name, view.service_len)
+            || memcmp(view.method_name, header.method_name, view.method_len)
+            || memcmp(view.attach, header.attach, view.attach_len))
+        {
+            abort();
+        }
+    }
+    free(header.service_name);
+    free(header.method_name);
+    free(header.attach);
+    free(buf);
+    return 0;
+}
+
+int fuzz_seeds(nova_buf *seeds, int max)
+{
+    nova_buf body = {0};
+    int n = 0;
+
+    fuzz_generic_reply(&body, THRIFT_BINARY, 1, "{\"ok\":true}", 11);
+    if (n < max)
+    {
+        fuzz_frame(&seeds[n++], GENERIC_SERVICE, GENERIC_METHOD, "", 1, &body);
+    }
+    if (n < max)
+    {
+        fuzz_frame(&seeds[n++], "com.test.Media", "echoStr", "{\"trace\":\"a\"}", 0x7fffffff01LL, &body);
+    }
+    if (n < max)
+    {
+        fuzz_frame(&seeds[n++], "s", "m", "", 0, &body);
+    }
+    nova_buf_free(&body);
+    return n;
+}
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fuzz.h"
+
+/* whole reply frames through nova_unpack_resp: generic, typed, exception and compressed replies */
+
+static const char media_schema[] =
+    "{\"structs\": {"
+    "  \"Query\": [{\"id\": 1, \"name\": \"categoryId\", \"type\": \"i32\"},"
+    "            {\"id\": 2, \"name\": \"tags\", \"type\": {\"list\": \"string\"}},"
+    "            {\"id\": 3, \"name\": \"props\", \"type\": {\"map\": [\"string\", \"double\"]}},"
+    "            {\"id\": 4, \"name\": \"byId\", \"type\": {\"map\": [\"i32\", \"Query\"]}}],"
+    "  \"NotFound\": [{\"id\": 1, \"name\": \"message\", \"type\": \"string\"}]},"
+    " \"services\": {\"com.test.Media\": {"
+    "  \"echo\": {\"args\": [{\"id\": 1, \"name\": \"query\", \"type\": \"Query\"}], \"result\": \"Query\"},"
+    "  \"echoStr\": {\"args\": [{\"id\": 1, \"name\": \"s\", \"type\": \"string\"}], \"result\": \"string\","
+    "              \"protocol\": \"compact\"},"
+    "  \"fail\": {\"args\": [{\"id\": 1, \"name\": \"s\", \"type\": \"string\"}], \"result\": \"string\","
+    "           \"throws\": [{\"id\": 1, \"name\": \"notFound\", \"type\": \"NotFound\"}]}}}}";
+
+static thrift_schema *schema;
+
+/* the schema loader only reads files */
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    char path[] = "/tmp/nova_fuzz_schema_XXXXXX";
+    int fd = mkstemp(path);
+
+    (void)argc;
+    (void)argv;
+    if (fd < 0 || write(fd, media_schema, sizeof(media_schema) - 1) != (ssize_t)(sizeof(media_schema) - 1))
+    {
+        perror("schema");
+        exit(1);
+    }
+    close(fd);
+    schema = thrift_schema_load(path);
+    unlink(path);
+    if (schema == NULL)
+    {
+        exit(1);
+    }
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    char *buf = fuzz_copy(data, size);
+    int64_t seq_no;
+    nova_resp resp;
+
+    if (nova_unpack_resp(buf, size, schema, 0, &seq_no, &resp))
+    {
+        nova_resp_free(&resp);
+    }
+    free(buf);
+    return 0;
+}
+
+static void typed_reply(nova_buf *body, int proto, const char *method, int32_t seq, int16_t field, const char *str)
+{
+    thrift_writer w;
+
+    body->len = 0;
+    thrift_writer_init(&w, body, proto);
+    thrift_write_message_begin(&w, method, strlen(method), T_REPLY, seq);
+    thrift_write_struct_begin(&w);
+    thrift_write_field_begin(&w, field ? TYPE_STRUCT : TYPE_STRING, field);
+    if (field)
+    {
+        /* NotFound */
+        thrift_write_struct_begin(&w);
+        thrift_write_field_begin(&w, TYPE_STRING, 1);
+        thrift_write_string(&w, str, strlen(str));
+        thrift_write_struct_end(&w);
+    }
+    else
+    {
+        thrift_write_string(&w, str, strlen(str));
+    }
+    thrift_write_struct_end(&w);
+}
+
+static void query_reply(nova_buf *body, int32_t seq)
+{
+    thrift_writer w;
+
+    body->len = 0;
+    thrift_writer_init(&w, body, THRIFT_BINARY);
+    thrift_write_message_begin(&w, "echo", 4, T_REPLY, seq);
+    thrift_write_struct_begin(&w);
+    thrift_write_field_begin(&w, TYPE_STRUCT, 0);
+    thrift_write_struct_begin(&w);
+    thrift_write_field_begin(&w, TYPE_I32, 1);
+    thrift_write_i32(&w, 42);
+    thrift_write_field_begin(&w, TYPE_LIST, 2);
+    thrift_write_list_begin(&w, TYPE_STRING, 2);
+    thrift_write_string(&w, "a", 1);
+    thrift_write_string(&w, "b\"c", 3);
+    thrift_write_field_begin(&w, TYPE_MAP, 3);
+    thrift_write_map_begin(&w, TYPE_STRING, TYPE_DOUBLE, 1);
+    thrift_write_string(&w, "w", 1);
+    thrift_write_double(&w, 0.1);
+    thrift_write_field_begin(&w, TYPE_MAP, 4);
+    thrift_write_map_begin(&w, TYPE_I32, TYPE_STRUCT, 1);
+    thrift_write_i32(&w, 7);
+    thrift_write_struct_begin(&w);
+    thrift_write_struct_end(&w);
+    thrift_write_struct_end(&w);
+    thrift_write_struct_end(&w);
+}
+
+int fuzz_seeds(nova_buf *seeds, int max)
+{
+    static const char big[] = "{\"items\":[\"aaaaaaaaaaaaaaaa\",\"aaaaaaaaaaaaaaaa\",\"aaaaaaaaaaaaaaaa\","
+                              "\"aaaaaaaaaaaaaaaa\",\"aaaaaaaaaaaaaaaa\",\"aaaaaaaaaaaaaaaa\"]}";
+    nova_buf body = {0}, packed = {0};
+    int n = 0;
+
+#define SEED(service, method, attach, seq) \
+    if (n < max) fuzz_frame(&seeds[n++], service, method, attach, seq, &body)
+
+    fuzz_generic_reply(&body, THRIFT_BINARY, 1, "{\"ok\":true}", 11);
+    SEED(GENERIC_SERVICE, GENERIC_METHOD, "{\"trace\":\"x\"}", 1);
+    fuzz_generic_reply(&body, THRIFT_COMPACT, 2, "[1,2]", 5);
+    SEED(GENERIC_SERVICE, GENERIC_METHOD, "", 2);
+    fuzz_exception_reply(&body, THRIFT_BINARY, GENERIC_METHOD, 3, THRIFT_EX_UNKNOWN, "boom");
+    SEED(GENERIC_SERVICE, GENERIC_METHOD, "", 3);
+
+    typed_reply(&body, THRIFT_COMPACT, "echoStr", 4, 0, "hi");
+    SEED("com.test.Media", "echoStr", "", 4);
+    typed_reply(&body, THRIFT_BINARY, "fail", 5, 1, "missing");
+    SEED("com.test.Media", "fail", "", 5);
+    query_reply(&body, 6);
+    SEED("com.test.Media", "echo", "", 6);
+
+    if (nova_compress_payload(&packed, NOVA_COMPRESS_LZ4, big, sizeof(big) - 1))
+    {
+        fuzz_generic_reply(&body, THRIFT_BINARY, 7, packed.data, packed.len);
+        SEED(GENERIC_SERVICE, GENERIC_METHOD, "{\"" NOVA_ATTACH_COMPRESS "\":\"lz4\"}", 7);
+    }
+#undef SEED
+
+    nova_buf_free(&packed);
+    nova_buf_free(&body);
+    return n;
+}
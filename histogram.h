@@ -0,0 +1,48 @@
+#ifndef _HISTOGRAM_H_
+#define _HISTOGRAM_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * log-linear latency histogram in the spirit of HdrHistogram:
+ * values below 2^NOVA_HIST_SUB_BITS are exact, above that every power of two is split
+ * into 2^(NOVA_HIST_SUB_BITS-1) linear buckets, so each value keeps 3 significant digits
+ */
+#define NOVA_HIST_SUB_BITS 11
+#define NOVA_HIST_HALF_COUNT (1 << (NOVA_HIST_SUB_BITS - 1))
+#define NOVA_HIST_BUCKETS 26 /* values up to 2^36-1, about 19 hours in us */
+#define NOVA_HIST_LEN ((NOVA_HIST_BUCKETS + 1) * NOVA_HIST_HALF_COUNT)
+#define NOVA_HIST_MAX_VALUE (((int64_t)1 << (NOVA_HIST_SUB_BITS + NOVA_HIST_BUCKETS - 1)) - 1)
+
+typedef struct nova_histogram
+{
+    uint64_t count;
+    int64_t min;
+    int64_t max;
+    double sum;
+    uint64_t counts[NOVA_HIST_LEN];
+} nova_histogram;
+
+nova_histogram *nova_hist_create();
+void nova_hist_destroy(nova_histogram *hist);
+void nova_hist_reset(nova_histogram *hist);
+
+/* O(1), negative values count as 0 and values above NOVA_HIST_MAX_VALUE are clamped */
+void nova_hist_record(nova_histogram *hist, int64_t value);
+
+/* highest value equivalent to the p-th percentile, p in [0, 100] */
+int64_t nova_hist_percentile(const nova_histogram *hist, double p);
+
+void nova_hist_merge(nova_histogram *dst, const nova_histogram *src);
+
+/* print min/mean/p50/p90/p99/p99.9/max, values are us and printed as ms */
+void nova_hist_print(const nova_histogram *hist, FILE *out);
+
+/* compact file: magic then varint encoded totals and (index gap, count) pairs of non-empty buckets */
+int nova_hist_save(const nova_histogram *hist, const char *path);
+
+/* merge the histogram stored at path into hist */
+int nova_hist_load(nova_histogram *hist, const char *path);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _INFLIGHT_H_
+#define _INFLIGHT_H_
+
+#include <stdint.h>
+
+/* in-flight requests keyed by nova seq_no, open addressing with linear probing */
+typedef struct nova_inflight_entry
+{
+    int64_t seq_no;
+    void *data; /* NULL marks an empty slot */
+} nova_inflight_entry;
+
+typedef struct nova_inflight
+{
+    nova_inflight_entry *slots;
+    uint32_t mask;
+    uint32_t size;
+} nova_inflight;
+
+int nova_inflight_init(nova_inflight *table, uint32_t hint);
+void nova_inflight_free(nova_inflight *table);
+
+/* data must not be NULL, return SW_ERR when seq_no is already in flight */
+int nova_inflight_put(nova_inflight *table, int64_t seq_no, void *data);
+
+/* remove and return the request of seq_no, NULL if unknown */
+void *nova_inflight_take(nova_inflight *table, int64_t seq_no);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef _JSON_ARENA_H_
+#define _JSON_ARENA_H_
+
+#include <stddef.h>
+
+/*
+ * bump allocator behind the cJSON hooks: between nova_json_arena_begin and nova_json_arena_end every
+ * cJSON allocation of the calling thread is carved from a per-thread arena and cJSON frees are no-ops,
+ * the end gives the whole scope back at once. outside a scope cJSON allocates with malloc as before
+ *
+ * nothing cJSON allocates in a scope may outlive it, results are copied out with malloc (strdup)
+ * before the end. pointers from malloc may still be released with cJSON_free or cJSON_Delete inside a scope.
+ * member indexes a lookup built in the scope are dropped by its end, trees from outside are rebuilt on demand
+ * a thread that cannot reserve address space for its arena allocates with malloc, scopes then do not reclaim
+ * the trees they abandon
+ */
+
+/* address space reserved per thread, less when refused. allocations past it fall back to malloc */
+#define NOVA_JSON_ARENA_RESERVE (sizeof(size_t) > 4 ? (size_t)4 << 30 : (size_t)256 << 20)
+#define NOVA_JSON_CHUNK (64 * 1024)                /* first pages made writable, the writable part doubles from there */
+#define NOVA_JSON_ARENA_KEEP (1024 * 1024)         /* writable pages kept for the next scope once the outermost ends */
+
+typedef struct nova_json_mark
+{
+    size_t used;
+    size_t indexes; /* cJSON_IndexMark at the begin */
+} nova_json_mark;
+
+/* scopes nest, the mark is handed back to the matching end */
+nova_json_mark nova_json_arena_begin();
+void nova_json_arena_end(nova_json_mark mark);
+
+#endif
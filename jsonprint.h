@@ -0,0 +1,27 @@
+#ifndef _JSON_PRINT_H_
+#define _JSON_PRINT_H_
+
+#include <stdio.h>
+
+/*
+ * streaming JSON printer for responses: the text is tokenized in place, no cJSON tree and no
+ * second copy is built. it accepts what cJSON_Parse accepts and prints like cJSON_Print, except
+ * that numbers are copied as they are written, so i64 values keep every digit and 1.50 stays 1.50
+ */
+
+#define NOVA_JSON_OUT_BUF (64 * 1024)
+
+/**
+ *  check that json is an object and find some of its top level members in one pass
+ *
+ *  @param names   matched case insensitively like cJSON_GetObjectItem, the first member wins
+ *  @param values  values[i] points at the value of names[i] inside json, NULL when absent
+ *
+ *  @return SW_ERR when json is not a valid object
+ */
+int nova_json_members(const char *json, const char **names, const char **values, int n);
+
+/* pretty print the valid JSON value at value, buffered, without a trailing newline */
+void nova_json_print(FILE *out, const char *value);
+
+#endif
@@ -44,13 +44,6 @@ extern "C" {
 #define sw_free free
 #endif
 
-#define CHECK_PACK               \
-    if (off > header->head_size) \
-    {                            \
-        swWarn("unpack error,"); \
-        return SW_ERR;           \
-    }
-
 typedef struct swNova_Header
 {
     int32_t msg_size;
@@ -68,22 +61,48 @@ typedef struct swNova_Header
     char *attach;
 } swNova_Header;
 
+/* swNova_Header without copies, strings point into the frame and are not NUL terminated */
+typedef struct swNova_HeaderView
+{
+    int32_t msg_size;
+    uint16_t magic;
+    int16_t head_size;
+    int8_t version;
+    uint32_t ip;
+    uint32_t port;
+    int32_t service_len;
+    const char *service_name;
+    int32_t method_len;
+    const char *method_name;
+    int64_t seq_no;
+    int32_t attach_len;
+    const char *attach;
+} swNova_HeaderView;
+
 swNova_Header *createNovaHeader();
 void deleteNovaHeader(swNova_Header *header);
 /**
- *  从二进制中解析出nova包头中主要数据
+ *  从二进制中解析出nova包头中主要数据, 先做与swNova_unpack_view相同的边界检查再拷贝
  *
- *  @param data   二进制数据
+ *  @param data   二进制数据, 至少包含完整包头
  *  @param length 二进制数据长度
- *  @param sname  读取的服务名
- *  @param mname  读取的方法名
- *  @param seq_no 读取的seq_no
- *  @param hsize  nova包头长度
+ *  @param header 输出, 字符串以0结尾, 由deleteNovaHeader释放
  *
- *  @return 成功返回0，出错返回其他
+ *  @return 成功返回SW_OK
  */
 int swNova_unpack(char *data, int length, swNova_Header *header);
 
+/**
+ *  零拷贝解析nova包头, 一次遍历完成全部边界检查, 不分配内存
+ *
+ *  @param data   完整的nova包
+ *  @param length 数据长度
+ *  @param view   输出, 字符串指向data内部, 生命周期与data相同
+ *
+ *  @return 成功返回SW_OK
+ */
+int swNova_unpack_view(const char *data, int length, swNova_HeaderView *view);
+
 /**
  *  打包数据
  *
@@ -97,6 +116,17 @@ int swNova_unpack(char *data, int length, swNova_Header *header);
  */
 int swNova_pack(swNova_Header *header, char *body, int len, char **data, int32_t *length);
 
+/**
+ *  打包包头定长部分, 附件内容与包体由调用方拼接, 用于writev/sendmsg
+ *
+ *  @param header   包头, head_size需已包含附件长度
+ *  @param body_len 包体长度
+ *  @param data     输出, 至少head_size - attach_len字节
+ *
+ *  @return 写入长度
+ */
+int swNova_pack_head(swNova_Header *header, int body_len, char *data);
+
 /**
  *  获取nova包长
  *
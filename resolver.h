@@ -0,0 +1,54 @@
+#ifndef _RESOLVER_H_
+#define _RESOLVER_H_
+
+#include <stdint.h>
+#include <sys/socket.h>
+
+#define NOVA_DNS_TTL_MS 30000
+#define NOVA_DNS_NEGATIVE_TTL_MS 1000 /* failed lookups are retried after this */
+#define NOVA_DNS_MAX_ADDRS 8
+
+typedef struct nova_addr
+{
+    struct sockaddr_storage sa;
+    socklen_t len;
+} nova_addr;
+
+typedef struct nova_dns_entry
+{
+    char *host;
+    nova_addr *addrs; /* port 0, families interleaved */
+    int count;        /* 0 caches a failed lookup */
+    int64_t expires;  /* monotonic ms */
+    struct nova_dns_entry *next;
+} nova_dns_entry;
+
+/*
+ * getaddrinfo gives no record TTL, entries live for a fixed ttl instead,
+ * not thread safe, one cache per pool
+ */
+typedef struct nova_dns
+{
+    nova_dns_entry *entries;
+    int64_t ttl; /* ms */
+} nova_dns;
+
+void nova_dns_init(nova_dns *dns, int64_t ttl);
+void nova_dns_free(nova_dns *dns);
+
+/**
+ *  resolve host with getaddrinfo, served from dns until the entry expires
+ *
+ *  @param dns        NULL skips the cache
+ *  @param addrs      filled with up to max addresses carrying port, in Happy Eyeballs order:
+ *                    the resolver's preferred family first, then alternating families
+ *  @param timeout_ms bounds a lookup missing the cache, <0 waits for the resolver
+ *
+ *  @return number of addresses, 0 when host does not resolve in time
+ */
+int nova_dns_resolve(nova_dns *dns, const char *host, int port, nova_addr *addrs, int max, int timeout_ms);
+
+/* forget host, the next resolve asks the resolver again */
+void nova_dns_invalidate(nova_dns *dns, const char *host);
+
+#endif
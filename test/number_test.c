@@ -0,0 +1,144 @@
+/*
+ * cJSON 数字输出的差分测试: format_number 的快路径与原来的 printf 路径逐个比较
+ *   printf 路径  先 %1.15g, 读回不相等再 %1.17g
+ * 覆盖随机位模式, 价格/坐标/整数等常见值, 二进制小数(舍入的平局), 次正规数, 2 的幂,
+ * 各个 10 的幂附近, 以及 1e15/1e16/1e17 两侧 15/16/17 位有效数字的边界
+ *
+ * 用法: number_test [随机轮数=300000] [种子]
+ */
+#include "../cJSON.c"
+
+#ifndef CJSON_FAST_NUMBERS
+int main(void)
+{
+    puts("numbers: CJSON_FAST_NUMBERS is off, print_number only uses printf");
+    return 0;
+}
+#else
+
+static unsigned long long rnd_state = 88172645463325252ULL;
+static long total, fallbacks, printf17, bad;
+
+/* xorshift64, 结果可复现 */
+static unsigned long long rnd(void)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 7;
+    rnd_state ^= rnd_state << 17;
+    return rnd_state;
+}
+
+static double from_bits(unsigned long long bits)
+{
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+/* print_number 引入快路径之前的输出 */
+static void printf_path(double d, char *out)
+{
+    double test = 0;
+
+    sprintf(out, "%1.15g", d);
+    if (sscanf(out, "%lg", &test) != 1 || test != d)
+    {
+        sprintf(out, "%1.17g", d);
+    }
+}
+
+static void check(double d)
+{
+    char want[64];
+    unsigned char got[64];
+    int len;
+
+    /* nan 与 inf 由 print_number 输出 null, 不经过 format_number */
+    if (d * 0 != 0)
+    {
+        return;
+    }
+    total++;
+    printf_path(d, want);
+    len = format_number(d, got);
+    if (len == 0)
+    {
+        /* 退回完整的 printf 路径 */
+        fallbacks++;
+        return;
+    }
+    if (len < 0)
+    {
+        /* 只跳过 %1.15g 那一步 */
+        printf17++;
+        len = sprintf((char *)got, "%1.17g", d);
+    }
+    if (strcmp(want, (char *)got) != 0 || len != (int)strlen(want))
+    {
+        if (bad < 20)
+        {
+            printf("ERROR, %a printf %s got %s\n", d, want, (char *)got);
+        }
+        bad++;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    long rounds = argc > 1 ? atol(argv[1]) : 300000;
+    long i;
+    int k;
+    char text[40];
+    double d;
+
+    if (argc > 2)
+    {
+        rnd_state += (unsigned long long)atol(argv[2]);
+    }
+
+    for (i = 0; i < rounds; i++)
+    {
+        check(from_bits(rnd()));
+        d = (double)(rnd() % 100000000) / 100;
+        check(d);
+        check(-d);
+        check((double)(rnd() % 1000000000) / 1e6);
+        check((double)(rnd() >> (rnd() % 64)));
+        check((double)(rnd() % (1ULL << 53)) * ((rnd() & 1) ? 0.5 : 0.125));
+        check((double)(rnd() % 1000000000000000000ULL) * 1e-18 * pow(10, (int)(rnd() % 23)));
+        check((double)(rnd() % 100000) * 1e-5);
+        check(from_bits(rnd() & 0x000FFFFFFFFFFFFFULL));
+        check(from_bits(rnd() & 0x7FF0000000000000ULL));
+    }
+
+    for (k = -330; k <= 310; k++)
+    {
+        sprintf(text, "1e%d", k);
+        check(strtod(text, NULL));
+        sprintf(text, "9.99999999999999e%d", k);
+        check(strtod(text, NULL));
+        sprintf(text, "9.999999999999999e%d", k);
+        check(strtod(text, NULL));
+        check(nextafter(strtod(text, NULL), 0));
+    }
+    for (i = -2000; i < 2000; i++)
+    {
+        check(1e15 + i);
+        check(1e16 + i * 2);
+        check(1e17 + i * 16);
+        check(i * 0.1);
+        check(i * 0.01);
+        check(i / 3.0);
+    }
+    check(0.0);
+    check(-0.0);
+    check(DBL_MAX);
+    check(DBL_MIN);
+    check(5e-324);
+    check(-5e-324);
+
+    printf("numbers: %ld checked, %ld through printf, %ld through %%1.17g, %ld wrong\n", total, fallbacks, printf17, bad);
+    return bad != 0;
+}
+
+#endif
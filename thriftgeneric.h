@@ -1,23 +1,15 @@
 #ifndef _THRIFT_GENERIC_H_
 #define _THRIFT_GENERIC_H_
 
+#include <sys/uio.h>
+#include "thriftprotocol.h"
+
 #define GENERIC_SERVICE "com.youzan.nova.framework.generic.service.GenericService"
 #define GENERIC_SERVICE_LEN 56
 #define GENERIC_METHOD "invoke"
 #define GENERIC_METHOD_LEN 6
 #define GENERIC_COMMON_LEN 44
-
-#define VER_MASK 0xffff0000
-#define VER1 0x80010000
-
-#define T_CALL 1
-#define T_REPLY 2
-#define T_EX 3
-
-#define TYPE_STRUCT 12
-#define TYPE_STRING 11
-
-#define FIELD_STOP 0
+#define GENERIC_IOV 7 /* prefix, service, field, method, field, args, stops */
 
 int thrift_generic_pack(int seq,
          const char *service_name, int service_name_len,
@@ -25,6 +17,40 @@ int thrift_generic_pack(int seq,
          const char *json_args, int json_args_len,
          char **out_buf);
 
+/* write into buf, at least GENERIC_COMMON_LEN plus the three string lengths, return bytes written */
+int thrift_generic_pack_into(int seq,
+         const char *service_name, int service_name_len,
+         const char *method_name, int method_name_len,
+         const char *json_args, int json_args_len,
+         char *buf);
+
+/**
+ *  same encoding as thrift_generic_pack without copying the strings,
+ *  fills GENERIC_IOV slices pointing into scratch (GENERIC_COMMON_LEN bytes) and the arguments
+ *
+ *  @return body length
+ */
+int thrift_generic_pack_iov(int seq,
+         const char *service_name, int service_name_len,
+         const char *method_name, int method_name_len,
+         const char *json_args, int json_args_len,
+         char *scratch, struct iovec *iov);
+
+/* same call through a thrift_writer, in whichever protocol it writes */
+int thrift_generic_write(thrift_writer *w, int seq,
+         const char *service_name, int service_name_len,
+         const char *method_name, int method_name_len,
+         const char *json_args, int json_args_len);
+
+/* replies in either protocol, compact ones are told apart by their first byte. garbage is rejected, never read past */
 int thrift_generic_unpack(const char *buf, int buf_len, char **out_json_resp);
 
+/**
+ *  decode a T_EX reply, of generic and typed calls alike, as
+ *  {"exception":{"type":6,"name":"INTERNAL_ERROR","message":"..."}}
+ *
+ *  @return length of out_json, 0 on failure
+ */
+int thrift_exception_unpack(const char *buf, int buf_len, char **out_json);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,143 @@
+#ifndef _THRIFT_PROTOCOL_H_
+#define _THRIFT_PROTOCOL_H_
+
+#include <stdint.h>
+#include "decoder.h"
+
+#define VER_MASK 0xffff0000
+#define VER1 0x80010000
+
+#define T_CALL 1
+#define T_REPLY 2
+#define T_EX 3
+#define T_ONEWAY 4
+
+#define FIELD_STOP 0
+#define TYPE_BOOL 2
+#define TYPE_BYTE 3
+#define TYPE_DOUBLE 4
+#define TYPE_I16 6
+#define TYPE_I32 8
+#define TYPE_I64 10
+#define TYPE_STRING 11
+#define TYPE_STRUCT 12
+#define TYPE_MAP 13
+#define TYPE_SET 14
+#define TYPE_LIST 15
+
+#define THRIFT_MAX_DEPTH 64 /* nested structs and containers, deeper input is rejected */
+
+#define THRIFT_BINARY 0
+#define THRIFT_COMPACT 1
+#define THRIFT_COMPACT_ID 0x82     /* first byte of every compact message */
+#define THRIFT_COMPACT_SEQ_OFFSET 2 /* compact seq sits right after the id and version bytes */
+
+/*
+ * compact protocol state: field ids are written as deltas from the previous field of the same struct,
+ * so every struct saves the id of its parent, and a bool field carries its value in the field header
+ */
+typedef struct thrift_compact_state
+{
+    int16_t last_id;
+    int16_t bool_id;
+    int bool_pending;
+    int bool_value;
+    int depth;
+    int16_t ids[THRIFT_MAX_DEPTH + 1];
+} thrift_compact_state;
+
+/* writer appending to out in proto, the first failure sticks in error */
+typedef struct thrift_writer
+{
+    nova_buf *out;
+    int proto; /* THRIFT_BINARY or THRIFT_COMPACT */
+    int error;
+    thrift_compact_state cs;
+} thrift_writer;
+
+void thrift_writer_init(thrift_writer *w, nova_buf *out, int proto);
+
+/* the compact seq is always a 5 byte varint so thrift_message_set_seq can patch it in place */
+void thrift_write_message_begin(thrift_writer *w, const char *name, int32_t name_len, int type, int32_t seq);
+void thrift_write_struct_begin(thrift_writer *w);
+/* writes the field stop */
+void thrift_write_struct_end(thrift_writer *w);
+void thrift_write_field_begin(thrift_writer *w, int type, int16_t id);
+void thrift_write_list_begin(thrift_writer *w, int elem_type, int32_t size);
+void thrift_write_map_begin(thrift_writer *w, int key_type, int val_type, int32_t size);
+void thrift_write_bool(thrift_writer *w, int value);
+void thrift_write_byte(thrift_writer *w, int8_t value);
+void thrift_write_i16(thrift_writer *w, int16_t value);
+void thrift_write_i32(thrift_writer *w, int32_t value);
+void thrift_write_i64(thrift_writer *w, int64_t value);
+void thrift_write_double(thrift_writer *w, double value);
+void thrift_write_string(thrift_writer *w, const char *str, int32_t len);
+
+/* reader over one buffer, every read is bounds checked and the first failure sticks in error */
+typedef struct thrift_reader
+{
+    const char *buf;
+    int32_t len;
+    int32_t off;
+    int proto;
+    int error;
+    thrift_compact_state cs;
+} thrift_reader;
+
+/* the protocol is told from the first byte of the message, replies come back in the protocol of the call */
+void thrift_reader_init(thrift_reader *r, const char *buf, int32_t len);
+
+/* name points into the buffer */
+int thrift_read_message_begin(thrift_reader *r, const char **name, int32_t *name_len, int *type, int32_t *seq);
+int thrift_read_struct_begin(thrift_reader *r);
+int thrift_read_struct_end(thrift_reader *r);
+/* type is FIELD_STOP at the end of a struct */
+int thrift_read_field_begin(thrift_reader *r, int *type, int16_t *id);
+int thrift_read_list_begin(thrift_reader *r, int *elem_type, int32_t *size);
+int thrift_read_map_begin(thrift_reader *r, int *key_type, int *val_type, int32_t *size);
+int thrift_read_bool(thrift_reader *r, int *value);
+int thrift_read_byte(thrift_reader *r, int8_t *value);
+int thrift_read_i16(thrift_reader *r, int16_t *value);
+int thrift_read_i32(thrift_reader *r, int32_t *value);
+int thrift_read_i64(thrift_reader *r, int64_t *value);
+int thrift_read_double(thrift_reader *r, double *value);
+/* str points into the buffer */
+int thrift_read_string(thrift_reader *r, const char **str, int32_t *len);
+
+/* skip one value of type, nested at most THRIFT_MAX_DEPTH deep */
+int thrift_skip(thrift_reader *r, int type, int depth);
+
+/* rewrite the seq of an encoded message of either protocol */
+int thrift_message_set_seq(char *buf, int32_t len, int32_t seq);
+
+/* T_CALL, T_REPLY, T_EX or T_ONEWAY of an encoded message, peeked without reading it, -1 when unreadable */
+int thrift_message_type(const char *buf, int32_t len);
+
+/* TApplicationException.type */
+#define THRIFT_EX_UNKNOWN 0
+#define THRIFT_EX_UNKNOWN_METHOD 1
+#define THRIFT_EX_INVALID_MESSAGE_TYPE 2
+#define THRIFT_EX_WRONG_METHOD_NAME 3
+#define THRIFT_EX_BAD_SEQUENCE_ID 4
+#define THRIFT_EX_MISSING_RESULT 5
+#define THRIFT_EX_INTERNAL_ERROR 6
+#define THRIFT_EX_PROTOCOL_ERROR 7
+#define THRIFT_EX_INVALID_TRANSFORM 8
+#define THRIFT_EX_INVALID_PROTOCOL 9
+#define THRIFT_EX_UNSUPPORTED_CLIENT_TYPE 10
+
+/* the body of a T_EX message */
+typedef struct thrift_app_exception
+{
+    const char *message; /* points into the buffer, NULL when absent */
+    int32_t message_len;
+    int32_t type; /* THRIFT_EX_*, THRIFT_EX_UNKNOWN when absent */
+} thrift_app_exception;
+
+/* read the TApplicationException struct following the message header, unknown fields are skipped */
+int thrift_read_app_exception(thrift_reader *r, thrift_app_exception *ex);
+
+/* "UNKNOWN_METHOD" and so on, "UNKNOWN" for types out of range */
+const char *thrift_app_exception_name(int32_t type);
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef _THRIFT_SCHEMA_H_
+#define _THRIFT_SCHEMA_H_
+
+#include <stdint.h>
+#include "thriftprotocol.h"
+
+/*
+ * typed calls described by a precompiled JSON schema, so arguments are encoded as the
+ * method's own thrift structs instead of a JSON string for GenericService to reflect on
+ *
+ * {
+ *   "structs": {
+ *     "Query": [{"id": 1, "name": "categoryId", "type": "i32"},
+ *               {"id": 2, "name": "tags", "type": {"list": "string"}, "required": true}],
+ *     "NotFound": [{"id": 1, "name": "message", "type": "string"}]
+ *   },
+ *   "services": {
+ *     "com.youzan.material.general.service.MediaService": {
+ *       "getMediaList": {"args": [{"id": 1, "name": "query", "type": "Query"}],
+ *                        "result": {"list": "Media"},
+ *                        "throws": [{"id": 1, "name": "notFound", "type": "NotFound"}]}
+ *     }
+ *   }
+ * }
+ *
+ * types are bool, byte, i16, i32, i64, double, string, binary, a struct name,
+ * {"list": T}, {"set": T} or {"map": [K, V]}, a missing result means void.
+ * a method may pin "protocol": "binary" or "compact", otherwise it follows the client
+ */
+
+typedef struct thrift_struct thrift_struct;
+
+typedef struct thrift_type
+{
+    int ttype;                 /* TYPE_* */
+    const thrift_struct *sdef; /* TYPE_STRUCT, owned by the schema */
+    struct thrift_type *key;   /* TYPE_MAP */
+    struct thrift_type *elem;  /* list and set elements, map values */
+} thrift_type;
+
+typedef struct thrift_field
+{
+    int16_t id;
+    int required;
+    char *name;
+    thrift_type *type;
+} thrift_field;
+
+struct thrift_struct
+{
+    char *name;
+    thrift_field *fields;
+    int nfields;
+};
+
+typedef struct thrift_method
+{
+    char *service;
+    char *name;
+    thrift_struct args;
+    thrift_struct result; /* success as field 0 unless void, then the declared exceptions */
+    int protocol;         /* THRIFT_BINARY, THRIFT_COMPACT or -1 to follow the client */
+} thrift_method;
+
+typedef struct thrift_schema
+{
+    thrift_struct *structs;
+    int nstructs;
+    thrift_method *methods;
+    int nmethods;
+} thrift_schema;
+
+/* NULL when the file is unreadable or the schema is inconsistent, the reason goes to stderr */
+thrift_schema *thrift_schema_load(const char *path);
+void thrift_schema_free(thrift_schema *schema);
+
+const thrift_method *thrift_schema_find(const thrift_schema *schema,
+                                        const char *service, int32_t service_len,
+                                        const char *method, int32_t method_len);
+
+/**
+ *  write the T_CALL message of m
+ *
+ *  @param json_args  object keyed by argument name, or an array in argument order.
+ *                    nested values may also come as JSON strings, as packed by nova_generic_args
+ *
+ *  @return SW_ERR when the arguments do not match the schema
+ */
+int thrift_encode_call(thrift_writer *w, const thrift_method *m, int32_t seq, const char *json_args);
+
+/**
+ *  decode a reply of m as {"response":<success>} or {"error_response":{"<exception>":{...}}},
+ *  the shape GenericService answers with
+ *
+ *  @return length of out_json, 0 on failure
+ */
+int thrift_decode_reply(const thrift_method *m, const char *buf, int32_t len, char **out_json);
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef _URING_H_
+#define _URING_H_
+
+/*
+ * minimal io_uring over raw syscalls, just what the engine needs:
+ * batched submission, ext arg timeouts and one provided buffer ring
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+/*
+ * the engine needs provided buffer rings (5.19) and multishot recv (6.0), older uapi headers fall back to epoll.
+ * IORING_REGISTER_PBUF_RING is an enum constant, the multishot flag of the same or a later release stands for both
+ */
+#if defined(IORING_RECV_MULTISHOT)
+#define NOVA_HAVE_URING 1
+#endif
+#endif
+#endif
+
+#ifdef NOVA_HAVE_URING
+
+/* only hints, nova_uring_init retries without them when the kernel answers EINVAL */
+#ifndef IORING_SETUP_SINGLE_ISSUER
+#define IORING_SETUP_SINGLE_ISSUER 0
+#endif
+#ifndef IORING_SETUP_COOP_TASKRUN
+#define IORING_SETUP_COOP_TASKRUN 0
+#endif
+
+typedef struct nova_uring
+{
+    int fd;
+    unsigned features;
+
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned sq_local_tail; /* sqes handed out but not yet submitted */
+
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+
+    /* provided buffer ring, group 0 */
+    struct io_uring_buf_ring *br;
+    size_t br_size;
+    char *br_bufs;
+    unsigned br_entries;
+    unsigned br_buf_size;
+    uint16_t br_tail;
+} nova_uring;
+
+/* return SW_ERR when the kernel lacks io_uring or the features we rely on */
+int nova_uring_init(nova_uring *ring, unsigned entries);
+void nova_uring_exit(nova_uring *ring);
+
+/* register a ring of entries buffers of buf_size bytes each as buffer group 0 */
+int nova_uring_setup_buffers(nova_uring *ring, unsigned entries, unsigned buf_size);
+char *nova_uring_buffer(nova_uring *ring, unsigned bid);
+void nova_uring_recycle(nova_uring *ring, unsigned bid);
+
+/* NULL when the submission queue is full, call nova_uring_submit first */
+struct io_uring_sqe *nova_uring_get_sqe(nova_uring *ring);
+
+/**
+ *  submit queued sqes and wait for at least wait_nr completions
+ *
+ *  @param timeout_ms  <0 blocks, only used when wait_nr > 0
+ *
+ *  @return submitted sqes, -errno on failure (-ETIME on timeout)
+ */
+int nova_uring_submit(nova_uring *ring, unsigned wait_nr, int timeout_ms);
+
+static inline unsigned nova_uring_pending(nova_uring *ring)
+{
+    return ring->sq_local_tail - *ring->sq_tail;
+}
+
+/* NULL when the completion queue is empty, call nova_uring_cqe_seen when done */
+struct io_uring_cqe *nova_uring_peek_cqe(nova_uring *ring);
+void nova_uring_cqe_seen(nova_uring *ring);
+
+#endif
+
+#endif